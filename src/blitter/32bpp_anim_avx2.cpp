@@ -0,0 +1,103 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_anim_avx2.cpp Implementation of the 32 bpp blitter with an AVX2 palette animation. */
+
+#ifdef WITH_SSE
+
+#include "../stdafx.h"
+#include "../video/video_driver.hpp"
+#include "32bpp_anim_avx2.hpp"
+#include "32bpp_sse_func.hpp"
+#include <immintrin.h>
+
+#include "../safeguards.h"
+
+/** Instantiation of the 32bpp blitter with AVX2 palette animation factory. */
+static FBlitter_32bppAVX2_Anim iFBlitter_32bppAVX2_Anim;
+
+void Blitter_32bppAVX2_Anim::PaletteAnimate(const Palette &palette)
+{
+	assert(!_screen_disable_anim);
+
+	this->palette = palette;
+	/* If first_dirty is 0, it is for 8bpp indication to send the new
+	 *  palette. However, only the animation colours might possibly change.
+	 *  Especially when going between toyland and non-toyland. */
+	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
+
+	const uint16 *anim = this->anim_buf;
+	Colour *dst = (Colour *)_screen.dst_ptr;
+	const int *palette_data = (const int *)this->palette.palette;
+
+	bool screen_dirty = false;
+
+	/* Let's walk the anim buffer and try to find the pixels, 16 at a time */
+	const int width = this->anim_buf_width;
+	const int screen_pitch = _screen.pitch;
+	const int anim_pitch = this->anim_buf_pitch;
+	const __m256i anim_cmp = _mm256_set1_epi16(PALETTE_ANIM_START - 1);
+	const __m256i brightness_cmp = _mm256_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS);
+	const __m256i colour_mask = _mm256_set1_epi16(0xFF);
+	for (int y = this->anim_buf_height; y != 0 ; y--) {
+		Colour *next_dst_ln = dst + screen_pitch;
+		const uint16 *next_anim_ln = anim + anim_pitch;
+		int x = width;
+		for (; x >= 16; x -= 16) {
+			const __m256i data = _mm256_loadu_si256((const __m256i *) anim);
+			const __m256i colour_data = _mm256_and_si256(data, colour_mask);
+
+			/* test if any colour >= PALETTE_ANIM_START */
+			const __m256i animated = _mm256_cmpgt_epi16(colour_data, anim_cmp);
+			if (unlikely(!_mm256_testz_si256(animated, animated))) {
+				/* test if any animated pixel has an unexpected brightness */
+				const __m256i unexpected = _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_srli_epi16(data, 8), brightness_cmp), animated);
+				if (unlikely(!_mm256_testz_si256(unexpected, unexpected))) {
+					/* slow path: brightness has to be adjusted */
+					for (int z = 0; z < 16; z++) {
+						uint8 colour = GB(anim[z], 0, 8);
+						if (colour >= PALETTE_ANIM_START) dst[z] = AdjustBrightneSSE(LookupColourInPalette(colour), GB(anim[z], 8, 8));
+					}
+				} else {
+					/* fast path: look up the colours of 8 pixels at once, and only write the animated ones */
+					for (int half = 0; half < 2; half++) {
+						const __m128i colours = half == 0 ? _mm256_castsi256_si128(colour_data) : _mm256_extracti128_si256(colour_data, 1);
+						const __m128i mask = half == 0 ? _mm256_castsi256_si128(animated) : _mm256_extracti128_si256(animated, 1);
+						const __m256i lookup = _mm256_i32gather_epi32(palette_data, _mm256_cvtepu16_epi32(colours), 4);
+						_mm256_maskstore_epi32((int *) (dst + half * 8), _mm256_cvtepi16_epi32(mask), lookup);
+					}
+				}
+				screen_dirty = true;
+			}
+			anim += 16;
+			dst += 16;
+		}
+
+		/* The last pixels of the line */
+		for (; x > 0; x--) {
+			uint8 colour = GB(*anim, 0, 8);
+			if (colour >= PALETTE_ANIM_START) {
+				*dst = AdjustBrightneSSE(LookupColourInPalette(colour), GB(*anim, 8, 8));
+				screen_dirty = true;
+			}
+			anim++;
+			dst++;
+		}
+
+		dst = next_dst_ln;
+		anim = next_anim_ln;
+	}
+
+	if (screen_dirty) {
+		/* Make sure the backend redraws the whole screen */
+		VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	}
+}
+
+#endif /* WITH_SSE */
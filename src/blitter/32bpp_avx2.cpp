@@ -0,0 +1,314 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2.cpp Implementation of the AVX2 32 bpp blitter. */
+
+#ifdef WITH_SSE
+
+#include "../stdafx.h"
+#include "../zoom_func.h"
+#include "../settings_type.h"
+#include "32bpp_avx2.hpp"
+#include <immintrin.h>
+
+#include "../safeguards.h"
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2 iFBlitter_32bppAVX2;
+
+/** Copy the alpha word of each pixel into its rgb words and clear the alpha word itself. */
+#define ALPHA_CONTROL_MASK_256      _mm256_broadcastsi128_si256(ALPHA_CONTROL_MASK)
+/** Spread the brightness at the start of each quad word into the rgb words. */
+#define BRIGHTNESS_CONTROL_MASK_256 _mm256_setr_epi8(0, -1, 0, -1, 0, -1, -1, -1, 8, -1, 8, -1, 8, -1, -1, -1, 0, -1, 0, -1, 0, -1, -1, -1, 8, -1, 8, -1, 8, -1, -1, -1)
+/** Put the overbright of the first two pixels of each lane into their rgb words. */
+#define OVERBRIGHT_CONTROL_MASK_256 _mm256_broadcastsi128_si256(OVERBRIGHT_CONTROL_MASK)
+
+/**
+ * Get the mask to load or store the first pixels of a block of 8.
+ * @param count Number of pixels, at most 8.
+ * @return Mask with the sign bit set for the first \a count pixels.
+ */
+static inline __m256i PixelMask(int count)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Alpha blend 8 pixels onto the destination.
+ * rgb = a * (rgb - Crgb) / 256 + Crgb, with a increased by one when not zero.
+ */
+static inline __m256i AlphaBlendEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i low_bytes = _mm256_set1_epi16(0xFF);
+	__m256i result[2];
+	for (int i = 0; i < 2; i++) {
+		/* Expand each uint8 into an uint16; the low half has pixels 0, 1, 4 and 5, the high half the others. */
+		__m256i s = i == 0 ? _mm256_unpacklo_epi8(src, zero) : _mm256_unpackhi_epi8(src, zero);
+		__m256i d = i == 0 ? _mm256_unpacklo_epi8(dst, zero) : _mm256_unpackhi_epi8(dst, zero);
+
+		__m256i alpha = _mm256_srli_epi16(_mm256_cmpgt_epi16(s, zero), 15); // if (alpha > 0) a++;
+		alpha = _mm256_add_epi16(alpha, s);
+		alpha = _mm256_shuffle_epi8(alpha, distribution_mask);
+
+		s = _mm256_sub_epi16(s, d);        //    (r - Cr)
+		s = _mm256_mullo_epi16(s, alpha);  //  a*(r - Cr)
+		s = _mm256_srli_epi16(s, 8);       //  a*(r - Cr)/256
+		s = _mm256_add_epi16(s, d);        //  a*(r - Cr)/256 + Cr
+		result[i] = _mm256_and_si256(s, low_bytes); // Wipe the borrow of negative differences before packing.
+	}
+	return _mm256_packus_epi16(result[0], result[1]);
+}
+
+/**
+ * Darken 8 pixels.
+ * rgb = rgb * ((256/4) * 4 - (alpha/4)) / ((256/4) * 4)
+ */
+static inline __m256i DarkenEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i tr_nom_base = _mm256_set1_epi16(256);
+	__m256i result[2];
+	for (int i = 0; i < 2; i++) {
+		__m256i s = i == 0 ? _mm256_unpacklo_epi8(src, zero) : _mm256_unpackhi_epi8(src, zero);
+		__m256i d = i == 0 ? _mm256_unpacklo_epi8(dst, zero) : _mm256_unpackhi_epi8(dst, zero);
+		__m256i alpha = _mm256_shuffle_epi8(s, distribution_mask);
+		alpha = _mm256_srli_epi16(alpha, 2); // Reduce to 64 levels of shades so the max value fits in 16 bits.
+		__m256i nom = _mm256_sub_epi16(tr_nom_base, alpha);
+		d = _mm256_mullo_epi16(d, nom);
+		result[i] = _mm256_srli_epi16(d, 8);
+	}
+	return _mm256_packus_epi16(result[0], result[1]);
+}
+
+/**
+ * Adjust the brightness of 4 pixels, like AdjustBrightness() does for one.
+ * @param col The 4 pixels, one uint16 per channel.
+ * @param brightness The brightness of each pixel in the rgb channels and DEFAULT_BRIGHTNESS in the alpha channel.
+ * @return The 4 adjusted pixels, one uint16 per channel.
+ */
+static inline __m256i AdjustBrightnessOfFourPixels(__m256i col, __m256i brightness)
+{
+	const __m256i white = _mm256_set1_epi64x(0x000000FF00FF00FFULL);
+	col = _mm256_mullo_epi16(col, brightness);
+	__m256i col_ob = _mm256_srli_epi16(col, 8 + 7);
+	col = _mm256_srli_epi16(col, 7);
+
+	/* Sum overbright.
+	 * Maximum for each rgb is 508 => 9 bits. The highest bit tells if there is overbright.
+	 * -255 is changed in -256 so we just have to take the 8 lower bits into account.
+	 */
+	col = _mm256_and_si256(col, _mm256_set1_epi64x(0x00FF01FF01FF01FFULL));
+	col_ob = _mm256_mullo_epi16(col_ob, white);
+	col_ob = _mm256_and_si256(col_ob, col);
+	__m256i ob = _mm256_hadd_epi16(_mm256_hadd_epi16(col_ob, _mm256_setzero_si256()), _mm256_setzero_si256());
+
+	ob = _mm256_srli_epi16(ob, 1); // Reduce overbright strength.
+	ob = _mm256_shuffle_epi8(ob, OVERBRIGHT_CONTROL_MASK_256);
+	__m256i ret = _mm256_subs_epu16(white, col); //    (255 - rgb)
+	ret = _mm256_mullo_epi16(ret, ob);           // ob*(255 - rgb)
+	ret = _mm256_srli_epi16(ret, 8);             // ob*(255 - rgb)/256
+	return _mm256_add_epi16(ret, col);           // ob*(255 - rgb)/256 + rgb
+}
+
+/**
+ * Adjust the brightness of 8 pixels.
+ * @param from The pixels.
+ * @param mv The map values of the pixels.
+ * @return The adjusted pixels.
+ */
+static inline __m256i AdjustBrightnessOfEightPixels(__m256i from, __m128i mv)
+{
+	/* One quad word with (v, v, v, DEFAULT_BRIGHTNESS) per pixel, the alpha is kept by a*128/128. */
+	const __m128i v = _mm_srli_epi16(mv, 8);
+	const __m256i control = BRIGHTNESS_CONTROL_MASK_256;
+	const __m256i alpha_brightness = _mm256_set1_epi64x((uint64)Blitter_32bppBase::DEFAULT_BRIGHTNESS << 48);
+	__m256i bri_lo = _mm256_or_si256(_mm256_shuffle_epi8(_mm256_cvtepu16_epi64(v), control), alpha_brightness);
+	__m256i bri_hi = _mm256_or_si256(_mm256_shuffle_epi8(_mm256_cvtepu16_epi64(_mm_srli_si128(v, 8)), control), alpha_brightness);
+
+	__m256i lo = AdjustBrightnessOfFourPixels(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(from)), bri_lo);
+	__m256i hi = AdjustBrightnessOfFourPixels(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(from, 1)), bri_hi);
+
+	/* Packing works per lane, which results in pixels 0, 1, 4, 5, 2, 3, 6 and 7. */
+	return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+/**
+ * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
+ *
+ * @tparam mode blitter mode
+ * @param bp further blitting parameters
+ * @param zoom zoom level at which we are drawing
+ */
+IGNORE_UNINITIALIZED_WARNING_START
+template <BlitterMode mode, Blitter_32bppSSE_Base::ReadMode read_mode, bool translucent>
+inline void Blitter_32bppAVX2::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+{
+	const byte * const remap = bp->remap;
+	Colour *dst_line = (Colour *) bp->dst + bp->top * bp->pitch + bp->left;
+	int effective_width = bp->width;
+
+	/* Find where to start reading in the source sprite. */
+	const SpriteData * const sd = (const SpriteData *) bp->sprite;
+	const SpriteInfo * const si = &sd->infos[zoom];
+	const MapValue *src_mv_line = (const MapValue *) &sd->data[si->mv_offset] + bp->skip_top * si->sprite_width;
+	const Colour *src_rgba_line = (const Colour *) ((const byte *) &sd->data[si->sprite_offset] + bp->skip_top * si->sprite_line_size);
+
+	if (read_mode != RM_WITH_MARGIN) {
+		src_rgba_line += bp->skip_left;
+		src_mv_line += bp->skip_left;
+	}
+	const MapValue *src_mv = src_mv_line;
+
+	/* Load these variables into register before loop. */
+	const __m256i a_cm = ALPHA_CONTROL_MASK_256;
+	const __m128i mv_m_mask = _mm_set1_epi16(0x00FF);
+	const __m128i mv_v_default = _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS << 8);
+
+	for (int y = bp->height; y != 0; y--) {
+		Colour *dst = dst_line;
+		const Colour *src = src_rgba_line + META_LENGTH;
+		if (mode == BM_COLOUR_REMAP) src_mv = src_mv_line;
+
+		if (read_mode == RM_WITH_MARGIN) {
+			src += src_rgba_line[0].data;
+			dst += src_rgba_line[0].data;
+			if (mode == BM_COLOUR_REMAP) src_mv += src_rgba_line[0].data;
+			const int width_diff = si->sprite_width - bp->width;
+			effective_width = bp->width - (int) src_rgba_line[0].data;
+			const int delta_diff = (int) src_rgba_line[1].data - width_diff;
+			const int new_width = effective_width - delta_diff;
+			effective_width = delta_diff > 0 ? new_width : effective_width;
+			if (effective_width <= 0) goto next_line;
+		}
+
+		switch (mode) {
+			default: {
+				/* The last block of a line has less than 8 pixels; only those are read and written. */
+				for (int x = effective_width; x > 0; x -= 8) {
+					const __m256i mask = x >= 8 ? _mm256_set1_epi32(-1) : PixelMask(x);
+					const __m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+					if (!translucent) {
+						/* Alpha is either 0 or 255, so its highest bit tells whether to draw the pixel. */
+						_mm256_maskstore_epi32((int *) dst, _mm256_and_si256(srcABCD, mask), srcABCD);
+					} else {
+						const __m256i dstABCD = _mm256_maskload_epi32((const int *) dst, mask);
+						_mm256_maskstore_epi32((int *) dst, mask, AlphaBlendEightPixels(srcABCD, dstABCD, a_cm));
+					}
+					src += 8;
+					dst += 8;
+				}
+				break;
+			}
+
+			case BM_COLOUR_REMAP:
+				for (int x = effective_width; x > 0; x -= 8) {
+					const __m256i mask = x >= 8 ? _mm256_set1_epi32(-1) : PixelMask(x);
+					__m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+					const __m256i dstABCD = _mm256_maskload_epi32((const int *) dst, mask);
+
+					/* Do not read past the map values of the line; pad with pixels which are not remapped. */
+					ALIGN(16) MapValue mv[8];
+					if (x >= 8) {
+						_mm_store_si128((__m128i *) mv, _mm_loadu_si128((const __m128i *) src_mv));
+					} else {
+						for (int i = 0; i < 8; i++) {
+							mv[i].m = i < x ? src_mv[i].m : 0;
+							mv[i].v = i < x ? src_mv[i].v : Blitter_32bppBase::DEFAULT_BRIGHTNESS;
+						}
+					}
+					const __m128i mvX8 = _mm_load_si128((const __m128i *) mv);
+
+					/* Remap colours. */
+					if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(mvX8, mv_m_mask), _mm_setzero_si128())) != 0xFFFF) {
+						ALIGN(32) Colour remapped_src[8];
+						_mm256_store_si256((__m256i *) remapped_src, srcABCD);
+						for (int i = 0; i < 8; i++) {
+							/* Written so the compiler uses CMOV. */
+							const Colour srcm = remapped_src[i];
+							const uint m = mv[i].m;
+							const uint r = remap[m];
+							const Colour cmap = (this->LookupColourInPalette(r).data & 0x00FFFFFF) | (srcm.data & 0xFF000000);
+							const Colour c = r == 0 ? Colour(0) : cmap;
+							remapped_src[i] = m != 0 ? c : srcm;
+						}
+						srcABCD = _mm256_load_si256((const __m256i *) remapped_src);
+
+						if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_andnot_si128(mv_m_mask, mvX8), mv_v_default)) != 0xFFFF) {
+							srcABCD = AdjustBrightnessOfEightPixels(srcABCD, mvX8);
+						}
+					}
+
+					/* Blend colours. */
+					_mm256_maskstore_epi32((int *) dst, mask, AlphaBlendEightPixels(srcABCD, dstABCD, a_cm));
+					dst += 8;
+					src += 8;
+					src_mv += 8;
+				}
+				break;
+
+			case BM_TRANSPARENT:
+				/* Make the current colour a bit more black, so it looks like this image is transparent. */
+				for (int x = bp->width; x > 0; x -= 8) {
+					const __m256i mask = x >= 8 ? _mm256_set1_epi32(-1) : PixelMask(x);
+					const __m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+					const __m256i dstABCD = _mm256_maskload_epi32((const int *) dst, mask);
+					_mm256_maskstore_epi32((int *) dst, mask, DarkenEightPixels(srcABCD, dstABCD, a_cm));
+					src += 8;
+					dst += 8;
+				}
+				break;
+		}
+
+next_line:
+		if (mode == BM_COLOUR_REMAP) src_mv_line += si->sprite_width;
+		src_rgba_line = (const Colour*) ((const byte*) src_rgba_line + si->sprite_line_size);
+		dst_line += bp->pitch;
+	}
+}
+IGNORE_UNINITIALIZED_WARNING_STOP
+
+/**
+ * Draws a sprite to a (screen) buffer. Calls adequate templated function.
+ *
+ * @param bp further blitting parameters
+ * @param mode blitter mode
+ * @param zoom zoom level at which we are drawing
+ */
+void Blitter_32bppAVX2::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	switch (mode) {
+		default: {
+			if (bp->skip_left != 0 || bp->width <= MARGIN_NORMAL_THRESHOLD) {
+bm_normal:
+				Draw<BM_NORMAL, RM_WITH_SKIP, true>(bp, zoom);
+			} else if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_TRANSLUCENT) {
+				Draw<BM_NORMAL, RM_WITH_MARGIN, true>(bp, zoom);
+			} else {
+				Draw<BM_NORMAL, RM_WITH_MARGIN, false>(bp, zoom);
+			}
+			return;
+		}
+		case BM_COLOUR_REMAP:
+			if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_NO_REMAP) goto bm_normal;
+			if (bp->skip_left != 0 || bp->width <= MARGIN_REMAP_THRESHOLD) {
+				Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true>(bp, zoom);
+			} else {
+				Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true>(bp, zoom);
+			}
+			return;
+		case BM_TRANSPARENT: Draw<BM_TRANSPARENT, RM_NONE, true>(bp, zoom); return;
+
+		/* These are rare enough to not be worth their own specialisation. */
+		case BM_CRASH_REMAP:
+		case BM_BLACK_REMAP: Blitter_32bppSSE4::Draw(bp, mode, zoom); return;
+	}
+}
+
+#endif /* WITH_SSE */
@@ -258,6 +258,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	assert(cp != NULL);
 	assert(action == MTA_LOAD ||
 			(action == MTA_KEEP && this->action_counts[MTA_LOAD] == 0));
+	this->ApplyPendingAging();
 	this->AddToMeta(cp, action);
 
 	if (this->count == cp->count) {
@@ -377,18 +378,40 @@ void VehicleCargoList::AddToMeta(const CargoPacket *cp, MoveToAction action)
 }
 
 /**
- * Ages the all cargo in this list.
+ * Apply the aging recorded by AgeCargo to the packets and the days in transit
+ * cache. This has to be done before any packets are moved into or out of the
+ * list, so that all packets in the list are always behind by the same amount.
  */
-void VehicleCargoList::AgeCargo()
+void VehicleCargoList::ApplyPendingAging()
 {
+	if (this->pending_aging == 0) return;
+
 	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
 		CargoPacket *cp = *it;
 		/* If we're at the maximum, then we can't increase no more. */
-		if (cp->days_in_transit == 0xFF) continue;
+		uint days = min<uint>(cp->days_in_transit + this->pending_aging, 0xFF);
+		this->cargo_days_in_transit += (days - cp->days_in_transit) * cp->count;
+		cp->days_in_transit = days;
+	}
+	this->pending_aging = 0;
+}
+
+/**
+ * Returns average number of days in transit for a cargo entity, including
+ * aging which hasn't been applied to the packets yet.
+ * @return The before mentioned number.
+ */
+uint VehicleCargoList::DaysInTransit() const
+{
+	if (this->pending_aging == 0) return this->Parent::DaysInTransit();
+	if (this->count == 0) return 0;
 
-		cp->days_in_transit++;
-		this->cargo_days_in_transit += cp->count;
+	uint days_in_transit = 0;
+	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
+		const CargoPacket *cp = *it;
+		days_in_transit += min<uint>(cp->days_in_transit + this->pending_aging, 0xFF) * cp->count;
 	}
+	return days_in_transit / this->count;
 }
 
 /**
@@ -448,6 +471,7 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 {
 	this->AssertCountConsistency();
 	assert(this->action_counts[MTA_LOAD] == 0);
+	this->ApplyPendingAging();
 	this->action_counts[MTA_TRANSFER] = this->action_counts[MTA_DELIVER] = this->action_counts[MTA_KEEP] = 0;
 	Iterator it = this->packets.begin();
 	uint sum = 0;
@@ -586,7 +610,12 @@ uint VehicleCargoList::Reassign<VehicleCargoList::MTA_DELIVER, VehicleCargoList:
 		sum += cp->Count();
 		if (sum <= this->action_counts[MTA_TRANSFER]) continue;
 		if (sum > this->action_counts[MTA_TRANSFER] + max_move) {
-			CargoPacket *cp_split = cp->Split(sum - this->action_counts[MTA_TRANSFER] + max_move);
+			CargoPacket *cp_split = cp->Split(sum - this->action_counts[MTA_TRANSFER] - max_move);
+			if (cp_split == NULL) {
+				/* The pool is full; only reassign the packets before this one. */
+				max_move = sum - cp->Count() - this->action_counts[MTA_TRANSFER];
+				break;
+			}
 			sum -= cp_split->Count();
 			this->packets.insert(it, cp_split);
 		}
@@ -608,6 +637,7 @@ uint VehicleCargoList::Reassign<VehicleCargoList::MTA_DELIVER, VehicleCargoList:
 uint VehicleCargoList::Return(uint max_move, StationCargoList *dest, StationID next)
 {
 	max_move = min(this->action_counts[MTA_LOAD], max_move);
+	this->ApplyPendingAging();
 	this->PopCargo(CargoReturn(this, dest, max_move, next));
 	return max_move;
 }
@@ -621,6 +651,7 @@ uint VehicleCargoList::Return(uint max_move, StationCargoList *dest, StationID n
 uint VehicleCargoList::Shift(uint max_move, VehicleCargoList *dest)
 {
 	max_move = min(this->count, max_move);
+	this->ApplyPendingAging();
 	this->PopCargo(CargoShift(this, dest, max_move));
 	return max_move;
 }
@@ -636,6 +667,7 @@ uint VehicleCargoList::Shift(uint max_move, VehicleCargoList *dest)
 uint VehicleCargoList::Unload(uint max_move, StationCargoList *dest, CargoPayment *payment)
 {
 	uint moved = 0;
+	this->ApplyPendingAging();
 	if (this->action_counts[MTA_TRANSFER] > 0) {
 		uint move = min(this->action_counts[MTA_TRANSFER], max_move);
 		this->ShiftCargo(CargoTransfer(this, dest, move));
@@ -659,6 +691,7 @@ uint VehicleCargoList::Truncate(uint max_move)
 {
 	max_move = min(this->count, max_move);
 	if (max_move > this->ActionCount(MTA_KEEP)) this->KeepAll();
+	this->ApplyPendingAging();
 	this->PopCargo(CargoRemoval<VehicleCargoList>(this, max_move));
 	return max_move;
 }
@@ -674,6 +707,8 @@ uint VehicleCargoList::Truncate(uint max_move)
 uint VehicleCargoList::Reroute(uint max_move, VehicleCargoList *dest, StationID avoid, StationID avoid2, const GoodsEntry *ge)
 {
 	max_move = min(this->action_counts[MTA_TRANSFER], max_move);
+	this->ApplyPendingAging();
+	dest->ApplyPendingAging();
 	this->ShiftCargo(VehicleCargoReroute(this, dest, max_move, avoid, avoid2, ge));
 	return max_move;
 }
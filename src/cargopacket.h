@@ -287,6 +287,7 @@ protected:
 
 	Money feeder_share;                     ///< Cache for the feeder share.
 	uint action_counts[NUM_MOVE_TO_ACTION]; ///< Counts of cargo to be transfered, delivered, kept and loaded.
+	uint8 pending_aging;                    ///< Number of aging periods (up to 255) not yet applied to the packets and the days in transit cache.
 
 	template<class Taction>
 	void ShiftCargo(Taction action);
@@ -406,7 +407,19 @@ public:
 
 	void Append(CargoPacket *cp, MoveToAction action = MTA_KEEP);
 
-	void AgeCargo();
+	/**
+	 * Ages all cargo in this list. The aging is only recorded here and
+	 * applied to the packets once they are moved or looked at, so that
+	 * aging doesn't need to touch every packet.
+	 */
+	inline void AgeCargo()
+	{
+		if (this->pending_aging < UINT8_MAX) this->pending_aging++;
+	}
+
+	void ApplyPendingAging();
+
+	uint DaysInTransit() const;
 
 	void InvalidateCache();
 
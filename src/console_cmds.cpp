@@ -53,6 +53,7 @@
 #include "aircraft.h"
 #include "airport.h"
 #include "station_base.h"
+#include "spritecache.h"
 
 #include "safeguards.h"
 
@@ -3620,6 +3621,28 @@ DEF_CONSOLE_CMD(ConDumpCommandLog)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConSpriteCacheStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Debug: Show the statistics of the sprite cache. Usage: 'sprite_cache_stats [reset]'");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset") != 0) return false;
+		ResetSpriteCacheStats();
+		IConsolePrint(CC_DEFAULT, "Sprite cache statistics reset.");
+		return true;
+	}
+
+	char buffer[1024];
+	DumpSpriteCacheStats(buffer, lastof(buffer));
+	PrintLineByLine(buffer);
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConCheckCaches)
 {
 	if (argc == 0) {
@@ -3640,6 +3663,38 @@ DEF_CONSOLE_CMD(ConCheckCaches)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConBenchmarkMCF)
+{
+	if (argc == 0) {
+		IConsoleHelp("Debug: Benchmark the link graph path search on the link graphs of the current game. Usage: 'benchmark_mcf [<iterations>]'");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	uint iterations = (argc == 2) ? max(atoi(argv[1]), 1) : 1;
+	extern void BenchmarkMCFDijkstra(uint iterations);
+	BenchmarkMCFDijkstra(iterations);
+
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkSavegameFormats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Debug: Benchmark the savegame formats by saving the current game to memory with each of them. Usage: 'benchmark_savegame_formats [<level>]'");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	int level = (argc == 2) ? atoi(argv[1]) : -1;
+	extern void BenchmarkSavegameFormats(int level);
+	BenchmarkSavegameFormats(level);
+
+	return true;
+}
+
 /******************
  *  debug commands
  ******************/
@@ -3792,6 +3847,9 @@ void IConsoleStdLibRegister()
 	IConsoleDebugLibRegister();
 	IConsoleCmdRegister("dump_command_log", ConDumpCommandLog, nullptr, true);
 	IConsoleCmdRegister("check_caches", ConCheckCaches, nullptr, true);
+	IConsoleCmdRegister("sprite_cache_stats", ConSpriteCacheStats, nullptr, true);
+	IConsoleCmdRegister("benchmark_mcf", ConBenchmarkMCF, nullptr, true);
+	IConsoleCmdRegister("benchmark_savegame_formats", ConBenchmarkSavegameFormats, nullptr, true);
 
 	/* NewGRF development stuff */
 	IConsoleCmdRegister("reload_newgrfs",  ConNewGRFReload, ConHookNewGRFDeveloperTool);
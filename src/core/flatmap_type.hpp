@@ -0,0 +1,167 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file flatmap_type.hpp Map stored as a sorted vector of key/value pairs. */
+
+#ifndef FLATMAP_TYPE_HPP
+#define FLATMAP_TYPE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+/**
+ * Associative container with the interface of std::map, storing its items
+ * in a single sorted vector. Lookups are binary searches over contiguous
+ * memory and iteration is a linear scan, which makes it a lot faster than
+ * std::map for small to medium sized maps which are read much more often
+ * than they are modified. Inserting at the end is amortised O(1), anywhere
+ * else O(n).
+ *
+ * Unlike std::map, any insertion or erasure invalidates all iterators and
+ * pointers to items, and the key of an item is not const. Don't modify it.
+ * @tparam Tkey Key type.
+ * @tparam Tvalue Value type.
+ * @tparam Tcompare Comparator for keys.
+ */
+template <typename Tkey, typename Tvalue, typename Tcompare = std::less<Tkey> >
+class FlatMap {
+public:
+	typedef Tkey key_type;
+	typedef Tvalue mapped_type;
+	typedef std::pair<Tkey, Tvalue> value_type;
+	typedef std::vector<value_type> container_type;
+	typedef typename container_type::size_type size_type;
+	typedef typename container_type::iterator iterator;
+	typedef typename container_type::const_iterator const_iterator;
+	typedef typename container_type::reverse_iterator reverse_iterator;
+	typedef typename container_type::const_reverse_iterator const_reverse_iterator;
+
+private:
+	container_type items; ///< Items sorted by key.
+
+	/** Compare an item to a key, for use with the standard binary searches. */
+	struct KeyCompare {
+		Tcompare comp;
+		inline bool operator()(const value_type &item, const Tkey &key) const { return this->comp(item.first, key); }
+		inline bool operator()(const Tkey &key, const value_type &item) const { return this->comp(key, item.first); }
+		inline bool operator()(const value_type &a, const value_type &b) const { return this->comp(a.first, b.first); }
+	};
+
+	/**
+	 * Check if an item's key is equal to the given one.
+	 * @param it Item to check, may be end().
+	 * @param key Key to compare with.
+	 * @return If it points to an item with the given key.
+	 */
+	inline bool IsKey(const_iterator it, const Tkey &key) const
+	{
+		return it != this->items.end() && !Tcompare()(key, it->first);
+	}
+
+public:
+	inline iterator begin() { return this->items.begin(); }
+	inline iterator end() { return this->items.end(); }
+	inline const_iterator begin() const { return this->items.begin(); }
+	inline const_iterator end() const { return this->items.end(); }
+	inline reverse_iterator rbegin() { return this->items.rbegin(); }
+	inline reverse_iterator rend() { return this->items.rend(); }
+	inline const_reverse_iterator rbegin() const { return this->items.rbegin(); }
+	inline const_reverse_iterator rend() const { return this->items.rend(); }
+
+	inline size_type size() const { return this->items.size(); }
+	inline bool empty() const { return this->items.empty(); }
+	inline void clear() { this->items.clear(); }
+	inline void reserve(size_type n) { this->items.reserve(n); }
+	inline void swap(FlatMap &other) { this->items.swap(other.items); }
+
+	inline iterator lower_bound(const Tkey &key) { return std::lower_bound(this->items.begin(), this->items.end(), key, KeyCompare()); }
+	inline const_iterator lower_bound(const Tkey &key) const { return std::lower_bound(this->items.begin(), this->items.end(), key, KeyCompare()); }
+	inline iterator upper_bound(const Tkey &key) { return std::upper_bound(this->items.begin(), this->items.end(), key, KeyCompare()); }
+	inline const_iterator upper_bound(const Tkey &key) const { return std::upper_bound(this->items.begin(), this->items.end(), key, KeyCompare()); }
+
+	inline iterator find(const Tkey &key)
+	{
+		iterator it = this->lower_bound(key);
+		return this->IsKey(it, key) ? it : this->items.end();
+	}
+
+	inline const_iterator find(const Tkey &key) const
+	{
+		const_iterator it = this->lower_bound(key);
+		return this->IsKey(it, key) ? it : this->items.end();
+	}
+
+	inline size_type count(const Tkey &key) const { return this->find(key) != this->items.end() ? 1 : 0; }
+
+	/**
+	 * Insert an item if its key isn't in the map yet.
+	 * @param item Item to be inserted.
+	 * @return Iterator to the item with the key and whether it was inserted.
+	 */
+	std::pair<iterator, bool> insert(value_type item)
+	{
+		if (this->items.empty() || Tcompare()(this->items.back().first, item.first)) {
+			this->items.push_back(std::move(item));
+			return std::make_pair(this->items.end() - 1, true);
+		}
+		iterator it = this->lower_bound(item.first);
+		if (this->IsKey(it, item.first)) return std::make_pair(it, false);
+		return std::make_pair(this->items.insert(it, std::move(item)), true);
+	}
+
+	/**
+	 * Insert all items of a range whose keys aren't in the map yet.
+	 * @param first Begin of the range.
+	 * @param last End of the range.
+	 */
+	template <typename Titer>
+	void insert(Titer first, Titer last)
+	{
+		size_type old_size = this->items.size();
+		for (; first != last; ++first) {
+			const_iterator old_end = this->items.begin() + old_size;
+			const_iterator it = std::lower_bound(this->items.cbegin(), old_end, first->first, KeyCompare());
+			if (it == old_end || Tcompare()(first->first, it->first)) this->items.push_back(*first);
+		}
+		std::sort(this->items.begin() + old_size, this->items.end(), KeyCompare());
+		std::inplace_merge(this->items.begin(), this->items.begin() + old_size, this->items.end(), KeyCompare());
+	}
+
+	/**
+	 * Get the value for a key, inserting a default constructed one if the key
+	 * isn't in the map yet.
+	 * @param key Key to look up.
+	 * @return Value for the key.
+	 */
+	Tvalue &operator[](const Tkey &key)
+	{
+		if (this->items.empty() || Tcompare()(this->items.back().first, key)) {
+			this->items.emplace_back(key, Tvalue());
+			return this->items.back().second;
+		}
+		iterator it = this->lower_bound(key);
+		if (!this->IsKey(it, key)) it = this->items.insert(it, value_type(key, Tvalue()));
+		return it->second;
+	}
+
+	inline iterator erase(const_iterator it) { return this->items.erase(it); }
+	inline iterator erase(const_iterator first, const_iterator last) { return this->items.erase(first, last); }
+
+	size_type erase(const Tkey &key)
+	{
+		iterator it = this->find(key);
+		if (it == this->items.end()) return 0;
+		this->items.erase(it);
+		return 1;
+	}
+};
+
+#endif /* FLATMAP_TYPE_HPP */
@@ -106,8 +106,21 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	this->items++;
 
 	Titem *item;
-	if (Tcache && this->alloc_cache != NULL) {
-		assert(sizeof(Titem) == size);
+	if (Tcache && this->alloc_cache == NULL) {
+		/* Allocate a whole slab of items and put all but the first into the
+		 * cache, in ascending order so that subsequent allocations are
+		 * contiguous in memory. */
+		assert_compile(!Tcache || sizeof(Titem) >= sizeof(AllocCache));
+		byte *slab = MallocT<byte>(sizeof(Titem) * Tgrowth_step);
+		*this->alloc_slabs.Append() = slab;
+		for (size_t i = Tgrowth_step - 1; i > 0; i--) {
+			AllocCache *ac = (AllocCache *)(slab + i * sizeof(Titem));
+			ac->next = this->alloc_cache;
+			this->alloc_cache = ac;
+		}
+		item = (Titem *)slab;
+		if (Tzero) memset((void *)item, 0, sizeof(Titem));
+	} else if (Tcache) {
 		item = (Titem *)this->alloc_cache;
 		this->alloc_cache = this->alloc_cache->next;
 		if (Tzero) {
@@ -120,6 +133,7 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	} else {
 		item = (Titem *)MallocT<byte>(size);
 	}
+	assert(!Tcache || sizeof(Titem) == size);
 	this->data[index] = item;
 	item->index = (Tindex)(uint)index;
 	return item;
@@ -207,11 +221,10 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 	this->cleaning = false;
 
 	if (Tcache) {
-		while (this->alloc_cache != NULL) {
-			AllocCache *ac = this->alloc_cache;
-			this->alloc_cache = ac->next;
-			free(ac);
-		}
+		/* All items are in the cache now; their memory belongs to the slabs. */
+		this->alloc_cache = NULL;
+		for (uint i = 0; i < this->alloc_slabs.Length(); i++) free(this->alloc_slabs[i]);
+		this->alloc_slabs.Clear();
 	}
 }
 
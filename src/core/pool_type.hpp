@@ -75,7 +75,9 @@ private:
  * @tparam Tgrowth_step Size of growths; if the pool is full increase the size by this amount
  * @tparam Tmax_size    Maximum size of the pool
  * @tparam Tpool_type   Type of this pool
- * @tparam Tcache       Whether to perform 'alloc' caching, i.e. don't actually free/malloc just reuse the memory
+ * @tparam Tcache       Whether to perform 'alloc' caching, i.e. don't actually free/malloc just reuse the memory.
+ *                      The memory for the items is then also allocated in slabs of Tgrowth_step items, so
+ *                      that items allocated together end up next to each other in memory.
  * @tparam Tzero        Whether to zero the memory
  * @warning when Tcache is enabled *all* instances of this pool's item must be of the same size.
  */
@@ -310,6 +312,9 @@ private:
 	/** Cache of freed pointers */
 	AllocCache *alloc_cache;
 
+	/** Blocks of memory the items of a caching pool are allocated from. */
+	SmallVector<void *, 16> alloc_slabs;
+
 	void *AllocateItem(size_t size, size_t index);
 	void ResizeFor(size_t index);
 	size_t FindFirstFree();
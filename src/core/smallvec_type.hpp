@@ -92,6 +92,23 @@ public:
 		if (other.Length() > 0) MemCpyT<T>(this->Append(other.Length()), other.Begin(), other.Length());
 	}
 
+	/**
+	 * Exchange the items and the allocated memory with another vector.
+	 * @param other The other vector.
+	 */
+	inline void Swap(SmallVector &other)
+	{
+		T *data = this->data;
+		uint items = this->items;
+		uint capacity = this->capacity;
+		this->data = other.data;
+		this->items = other.items;
+		this->capacity = other.capacity;
+		other.data = data;
+		other.items = items;
+		other.capacity = capacity;
+	}
+
 	/**
 	 * Remove all items from the list.
 	 */
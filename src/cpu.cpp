@@ -93,7 +93,7 @@ uint64 ottd_rdtsc() {return 0;}
 #if defined(_MSC_VER)
 void ottd_cpuid(int info[4], int type)
 {
-	__cpuid(info, type);
+	__cpuidex(info, type, 0);
 }
 #elif defined(__x86_64__) || defined(__i386)
 void ottd_cpuid(int info[4], int type)
@@ -113,13 +113,13 @@ void ottd_cpuid(int info[4], int type)
 			/* It is safe to write "=r" for (info[1]) as in case that PIC is enabled for i386,
 			 * the compiler will not choose EBX as target register (but something else).
 			 */
-			: "a" (type)
+			: "a" (type), "2" (0)
 	);
 #else
 	__asm__ __volatile__ (
 			"cpuid           \n\t"
 			: "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3])
-			: "a" (type)
+			: "a" (type), "2" (0)
 	);
 #endif /* i386 PIC */
 }
@@ -140,3 +140,34 @@ bool HasCPUIDFlag(uint type, uint index, uint bit)
 	ottd_cpuid(cpu_info, type);
 	return HasBit(cpu_info[index], bit);
 }
+
+/**
+ * Get the extended control register with the state components the OS saves.
+ * @return The value of XCR0.
+ */
+#if defined(_MSC_VER) && _MSC_VER >= 1600
+static uint64 ottd_xgetbv()
+{
+	return _xgetbv(0);
+}
+#elif defined(__x86_64__) || defined(__i386)
+static uint64 ottd_xgetbv()
+{
+	uint32 low, high;
+	/* The opcode of xgetbv, as older assemblers do not know the instruction. */
+	__asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (low), "=d" (high) : "c" (0));
+	return ((uint64)high << 32) | low;
+}
+#else
+static uint64 ottd_xgetbv()
+{
+	return 0;
+}
+#endif
+
+bool HasOSAVXSupport()
+{
+	/* The CPU must support AVX and xgetbv, and the OS must save the SSE and AVX registers. */
+	if (!HasCPUIDFlag(1, 2, 27) || !HasCPUIDFlag(1, 2, 28)) return false;
+	return (ottd_xgetbv() & 0x6) == 0x6;
+}
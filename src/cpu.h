@@ -20,6 +20,7 @@ uint64 ottd_rdtsc();
 
 /**
  * Get the CPUID information from the CPU.
+ * For types with sub-leaves the first sub-leaf is retrieved.
  * @param info The retrieved info. All zeros on architectures without CPUID.
  * @param type The information this instruction should retrieve.
  */
@@ -34,4 +35,10 @@ void ottd_cpuid(int info[4], int type);
  */
 bool HasCPUIDFlag(uint type, uint index, uint bit);
 
+/**
+ * Check whether the CPU supports AVX and the OS saves the AVX registers on a context switch.
+ * @return True when AVX instructions can be used.
+ */
+bool HasOSAVXSupport();
+
 #endif /* CPU_H */
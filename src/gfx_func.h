@@ -237,7 +237,7 @@ static inline int RescaleFrom854x480(int value)
 	return min(value * _cur_resolution.width / 854, value * _cur_resolution.height / 480);
 }
 
-extern DrawPixelInfo *_cur_dpi;
+extern thread_local DrawPixelInfo *_cur_dpi;
 
 TextColour GetContrastColour(uint8 background, uint8 threshold = 128);
 
@@ -227,7 +227,8 @@ static void FixAllReservations()
  */
 bool CheckSharingChangePossible(VehicleType type)
 {
-	if (type != VEH_AIRCRAFT) YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	if (type == VEH_TRAIN) YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	if (type == VEH_ROAD) YapfNotifyRoadLayoutChange(INVALID_TILE);
 	/* Only do something when sharing is being disabled */
 	if (_settings_game.economy.infrastructure_sharing[type]) return true;
 
@@ -278,6 +279,7 @@ bool CheckSharingChangePossible(VehicleType type)
 void HandleSharingCompanyDeletion(Owner owner)
 {
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyRoadLayoutChange(INVALID_TILE);
 
 	Vehicle *v = NULL;
 	SCOPE_INFO_FMT([&v], "HandleSharingCompanyDeletion: veh: %s", scope_dumper().VehicleInfo(v));
@@ -32,9 +32,11 @@
 #include "company_func.h"
 #include "tunnelbridge_map.h"
 #include "pathfinder/npf/aystar.h"
+#include "pathfinder/water_regions.h"
 #include "saveload/saveload.h"
 #include "3rdparty/cpp-btree/btree_set.h"
 #include "scope_info.h"
+#include "network/network_sync_hash.h"
 #include <deque>
 
 #include "table/strings.h"
@@ -499,6 +501,7 @@ void DoClearSquare(TileIndex tile)
 	if (_tile_type_procs[GetTileType(tile)]->animate_tile_proc != NULL) DeleteAnimatedTile(tile);
 
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
+	InvalidateWaterRegion(tile);
 	MarkTileDirtyByTile(tile);
 }
 
@@ -753,11 +756,13 @@ void RunTileLoop()
 	/* Manually update tile 0 every 256 ticks - the LFSR never iterates over it itself.  */
 	if (_tick_counter % 256 == 0) {
 		_tile_type_procs[GetTileType(0)]->tile_loop_proc(0);
+		if (_sync_hash_active) SyncHashTile(0);
 		count--;
 	}
 
 	while (count--) {
 		_tile_type_procs[GetTileType(tile)]->tile_loop_proc(tile);
+		if (_sync_hash_active) SyncHashTile(tile);
 
 		/* Get the next tile in sequence using a Galois LFSR. */
 		tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
@@ -32,20 +32,26 @@ inline void LinkGraph::BaseNode::Init(TileIndex xy, StationID st, uint demand)
 	this->demand = demand;
 	this->station = st;
 	this->last_update = INVALID_DATE;
+	this->last_job_supply = 0;
+	this->last_job_demand = 0;
 }
 
 /**
  * Create an edge.
+ * @param dest_node Destination of the edge.
  */
-inline void LinkGraph::BaseEdge::Init()
+inline void LinkGraph::BaseEdge::Init(NodeID dest_node)
 {
 	this->capacity = 0;
 	this->usage = 0;
 	this->last_unrestricted_update = INVALID_DATE;
 	this->last_restricted_update = INVALID_DATE;
-	this->next_edge = INVALID_NODE;
+	this->last_job_capacity = 0;
+	this->dest_node = dest_node;
 }
 
+/* static */ const LinkGraph::BaseEdge LinkGraph::empty_edge = { 0, 0, INVALID_DATE, INVALID_DATE, 0, INVALID_NODE };
+
 /**
  * Shift all dates by given interval.
  * This is useful if the date has been modified with the cheat menu.
@@ -57,8 +63,7 @@ void LinkGraph::ShiftDates(int interval)
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		BaseNode &source = this->nodes[node1];
 		if (source.last_update != INVALID_DATE) source.last_update += interval;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		for (BaseEdge &edge : this->edges[node1]) {
 			if (edge.last_unrestricted_update != INVALID_DATE) edge.last_unrestricted_update += interval;
 			if (edge.last_restricted_update != INVALID_DATE) edge.last_restricted_update += interval;
 		}
@@ -70,8 +75,7 @@ void LinkGraph::Compress()
 	this->last_compression = (_date + this->last_compression) / 2;
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		this->nodes[node1].supply /= 2;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		for (BaseEdge &edge : this->edges[node1]) {
 			if (edge.capacity > 0) {
 				edge.capacity = max(1U, edge.capacity / 2);
 				edge.usage /= 2;
@@ -95,21 +99,17 @@ void LinkGraph::Merge(LinkGraph *other)
 		this->nodes[new_node].supply = LinkGraph::Scale(other->nodes[node1].supply, age, other_age);
 		st->goods[this->cargo].link_graph = this->index;
 		st->goods[this->cargo].node = new_node;
-		for (NodeID node2 = 0; node2 < node1; ++node2) {
-			BaseEdge &forward = this->edges[new_node][first + node2];
-			BaseEdge &backward = this->edges[first + node2][new_node];
-			forward = other->edges[node1][node2];
-			backward = other->edges[node2][node1];
-			forward.capacity = LinkGraph::Scale(forward.capacity, age, other_age);
-			forward.usage = LinkGraph::Scale(forward.usage, age, other_age);
-			if (forward.next_edge != INVALID_NODE) forward.next_edge += first;
-			backward.capacity = LinkGraph::Scale(backward.capacity, age, other_age);
-			backward.usage = LinkGraph::Scale(backward.usage, age, other_age);
-			if (backward.next_edge != INVALID_NODE) backward.next_edge += first;
+
+		/* All IDs of the other graph are shifted by the same offset, so the
+		 * edges stay sorted by destination. */
+		EdgeVector &new_edges = this->edges[new_node];
+		new_edges = std::move(other->edges[node1]);
+		for (BaseEdge &edge : new_edges) {
+			edge.capacity = LinkGraph::Scale(edge.capacity, age, other_age);
+			edge.usage = LinkGraph::Scale(edge.usage, age, other_age);
+			edge.last_job_capacity = 0; // The merged graph hasn't been calculated as a whole, yet.
+			edge.dest_node += first;
 		}
-		BaseEdge &new_start = this->edges[new_node][new_node];
-		new_start = other->edges[node1][node1];
-		if (new_start.next_edge != INVALID_NODE) new_start.next_edge += first;
 	}
 	delete other;
 }
@@ -125,32 +125,79 @@ void LinkGraph::RemoveNode(NodeID id)
 	NodeID last_node = this->Size() - 1;
 	for (NodeID i = 0; i <= last_node; ++i) {
 		(*this)[i].RemoveEdge(id);
-		BaseEdge *node_edges = this->edges[i];
-		NodeID prev = i;
-		NodeID next = node_edges[i].next_edge;
-		while (next != INVALID_NODE) {
-			if (next == last_node) {
-				node_edges[prev].next_edge = id;
-				break;
-			}
-			prev = next;
-			next = node_edges[prev].next_edge;
+		EdgeVector &node_edges = this->edges[i];
+		/* The last node has the highest ID, so an edge to it is always the
+		 * last one in the list. Move it to its new sorted position. */
+		if (id != last_node && !node_edges.empty() && node_edges.back().dest_node == last_node) {
+			BaseEdge edge = node_edges.back();
+			node_edges.pop_back();
+			edge.dest_node = id;
+			node_edges.insert(node_edges.begin() + (*this)[i].FindEdge(id), edge);
 		}
-		node_edges[id] = node_edges[last_node];
 	}
 	Station::Get(this->nodes[last_node].station)->goods[this->cargo].node = id;
 	this->nodes.Erase(this->nodes.Get(id));
-	this->edges.EraseColumn(id);
-	/* Not doing EraseRow here, as having the extra invalid row doesn't hurt
-	 * and removing it would trigger a lot of memmove. The data has already
-	 * been copied around in the loop above. */
+	if (id != last_node) this->edges[id] = std::move(this->edges[last_node]);
+	this->edges.pop_back();
+}
+
+/**
+ * Estimate how much the link graph has changed since the last job was
+ * spawned for it, by comparing the current monthly supplies and capacities to
+ * the ones recorded then. Nodes and edges which have been added count with
+ * their full value, removed ones with the value they had back then. A change
+ * of acceptance at any node counts as a complete change.
+ * @return Change in percent, 100 if the graph was never calculated.
+ */
+uint LinkGraph::GetChangeSinceLastJob() const
+{
+	uint64 current_total = 0;
+	uint64 remaining_total = 0;
+	uint64 diff = 0;
+	for (NodeID node = 0; node < this->Size(); ++node) {
+		const BaseNode &base = this->nodes[node];
+		if (base.demand != base.last_job_demand) return 100;
+		uint supply = this->Monthly(base.supply);
+		current_total += supply;
+		remaining_total += base.last_job_supply;
+		diff += Delta(supply, base.last_job_supply);
+		for (const BaseEdge &edge : this->edges[node]) {
+			uint capacity = this->Monthly(edge.capacity);
+			current_total += capacity;
+			remaining_total += edge.last_job_capacity;
+			diff += Delta(capacity, edge.last_job_capacity);
+		}
+	}
+	/* Whatever was there last time and isn't anymore has been removed. */
+	if (this->last_job_total > remaining_total) diff += this->last_job_total - remaining_total;
+
+	uint64 total = max(current_total, this->last_job_total);
+	if (total == 0) return 0;
+	return (uint)min<uint64>(100, diff * 100 / total);
 }
 
 /**
- * Add a node to the component and create empty edges associated with it. Set
- * the station's last_component to this component. Calculate the distances to all
- * other nodes. The distances to _all_ nodes are important as the demand
- * calculator relies on their availability.
+ * Record the current monthly supplies and capacities as reference for
+ * GetChangeSinceLastJob. To be called when a job is spawned for the graph.
+ */
+void LinkGraph::SetLastJobReference()
+{
+	this->last_job_total = 0;
+	for (NodeID node = 0; node < this->Size(); ++node) {
+		BaseNode &base = this->nodes[node];
+		base.last_job_supply = this->Monthly(base.supply);
+		base.last_job_demand = base.demand;
+		this->last_job_total += base.last_job_supply;
+		for (BaseEdge &edge : this->edges[node]) {
+			edge.last_job_capacity = this->Monthly(edge.capacity);
+			this->last_job_total += edge.last_job_capacity;
+		}
+	}
+}
+
+/**
+ * Add a node to the component and create an empty edge list for it. Set the
+ * station's last_component to this component.
  * @param st New node's station.
  * @return New node's ID.
  */
@@ -160,23 +207,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 
 	NodeID new_node = this->Size();
 	this->nodes.Append();
-	/* Avoid reducing the height of the matrix as that is expensive and we
-	 * most likely will increase it again later which is again expensive. */
-	this->edges.Resize(new_node + 1U,
-			max(new_node + 1U, this->edges.Height()));
+	this->edges.emplace_back();
 
 	this->nodes[new_node].Init(st->xy, st->index,
 			HasBit(good.status, GoodsEntry::GES_ACCEPTANCE));
 
-	BaseEdge *new_edges = this->edges[new_node];
-
-	/* Reset the first edge starting at the new node */
-	new_edges[new_node].next_edge = INVALID_NODE;
-
-	for (NodeID i = 0; i <= new_node; ++i) {
-		new_edges[i].Init();
-		this->edges[i][new_node].Init();
-	}
 	return new_node;
 }
 
@@ -191,12 +226,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 void LinkGraph::Node::AddEdge(NodeID to, uint capacity, uint usage, EdgeUpdateMode mode)
 {
 	assert(this->index != to);
-	BaseEdge &edge = this->edges[to];
-	BaseEdge &first = this->edges[this->index];
+	assert(!this->HasEdgeTo(to));
+	BaseEdge &edge = *(this->edges.emplace(this->edges.begin() + this->FindEdge(to)));
+	edge.Init(to);
 	edge.capacity = capacity;
 	edge.usage = usage;
-	edge.next_edge = first.next_edge;
-	first.next_edge = to;
 	if (mode & EUM_UNRESTRICTED)  edge.last_unrestricted_update = _date;
 	if (mode & EUM_RESTRICTED) edge.last_restricted_update = _date;
 }
@@ -212,10 +246,11 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 {
 	assert(capacity > 0);
 	assert(usage <= capacity);
-	if (this->edges[to].capacity == 0) {
+	size_t pos = this->FindEdge(to);
+	if (pos == this->edges.size() || this->edges[pos].dest_node != to) {
 		this->AddEdge(to, capacity, usage, mode);
 	} else {
-		(*this)[to].Update(capacity, usage, mode);
+		Edge(this->edges[pos]).Update(capacity, usage, mode);
 	}
 }
 
@@ -226,24 +261,9 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 void LinkGraph::Node::RemoveEdge(NodeID to)
 {
 	if (this->index == to) return;
-	BaseEdge &edge = this->edges[to];
-	edge.capacity = 0;
-	edge.last_unrestricted_update = INVALID_DATE;
-	edge.last_restricted_update = INVALID_DATE;
-	edge.usage = 0;
-
-	NodeID prev = this->index;
-	NodeID next = this->edges[this->index].next_edge;
-	while (next != INVALID_NODE) {
-		if (next == to) {
-			/* Will be removed, skip it. */
-			this->edges[prev].next_edge = edge.next_edge;
-			edge.next_edge = INVALID_NODE;
-			break;
-		} else {
-			prev = next;
-			next = this->edges[next].next_edge;
-		}
+	size_t pos = this->FindEdge(to);
+	if (pos < this->edges.size() && this->edges[pos].dest_node == to) {
+		this->edges.erase(this->edges.begin() + pos);
 	}
 }
 
@@ -275,19 +295,17 @@ void LinkGraph::Edge::Update(uint capacity, uint usage, EdgeUpdateMode mode)
 }
 
 /**
- * Resize the component and fill it with empty nodes and edges. Used when
+ * Resize the component and fill it with empty nodes and edge lists. Used when
  * loading from save games. The component is expected to be empty before.
  * @param size New size of the component.
  */
 void LinkGraph::Init(uint size)
 {
 	assert(this->Size() == 0);
-	this->edges.Resize(size, size);
+	this->edges.resize(size);
 	this->nodes.Resize(size);
 
 	for (uint i = 0; i < size; ++i) {
 		this->nodes[i].Init();
-		BaseEdge *column = this->edges[i];
-		for (uint j = 0; j < size; ++j) column[j].Init();
 	}
 }
@@ -14,12 +14,13 @@
 
 #include "../core/pool_type.hpp"
 #include "../core/smallmap_type.hpp"
-#include "../core/smallmatrix_type.hpp"
 #include "../core/bitmath_func.hpp"
 #include "../station_base.h"
 #include "../cargotype.h"
 #include "../date_func.h"
 #include "linkgraph_type.h"
+#include <vector>
+#include <algorithm>
 
 struct SaveLoad;
 class LinkGraph;
@@ -52,24 +53,28 @@ public:
 		StationID station;       ///< Station ID.
 		TileIndex xy;            ///< Location of the station referred to by the node.
 		Date last_update;        ///< When the supply was last updated.
+		uint last_job_supply;    ///< Monthly supply when the last job for the link graph was spawned.
+		uint last_job_demand;    ///< Acceptance when the last job for the link graph was spawned.
 		void Init(TileIndex xy = INVALID_TILE, StationID st = INVALID_STATION, uint demand = 0);
 	};
 
 	/**
-	 * An edge in the link graph. Corresponds to a link between two stations or at
-	 * least the distance between them. Edges from one node to itself contain the
-	 * ID of the opposite Node of the first active edge (i.e. not just distance) in
-	 * the column as next_edge.
+	 * An edge in the link graph. Corresponds to a link between two stations.
+	 * Only edges which actually exist are stored, in a list per source node
+	 * which is sorted by destination node.
 	 */
 	struct BaseEdge {
 		uint capacity;                 ///< Capacity of the link.
 		uint usage;                    ///< Usage of the link.
 		Date last_unrestricted_update; ///< When the unrestricted part of the link was last updated.
 		Date last_restricted_update;   ///< When the restricted part of the link was last updated.
-		NodeID next_edge;              ///< Destination of next valid edge starting at the same source node.
-		void Init();
+		uint last_job_capacity;        ///< Monthly capacity when the last job for the link graph was spawned.
+		NodeID dest_node;              ///< Destination of the edge.
+		void Init(NodeID dest_node = INVALID_NODE);
 	};
 
+	typedef std::vector<BaseEdge> EdgeVector;
+
 	/**
 	 * Wrapper for an edge (const or not) allowing retrieval, but no modification.
 	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
@@ -120,27 +125,57 @@ public:
 
 	/**
 	 * Wrapper for a node (const or not) allowing retrieval, but no modification.
-	 * @tparam Tedge Actual node class, may be "const BaseNode" or just "BaseNode".
-	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
+	 * @tparam Tnode Actual node class, may be "const BaseNode" or just "BaseNode".
+	 * @tparam Tedge_vector Actual edge list class, may be "const EdgeVector" or just "EdgeVector".
 	 */
-	template<typename Tnode, typename Tedge>
+	template<typename Tnode, typename Tedge_vector>
 	class NodeWrapper {
 	protected:
-		Tnode &node;  ///< Node being wrapped.
-		Tedge *edges; ///< Outgoing edges for wrapped node.
-		NodeID index; ///< ID of wrapped node.
+		Tnode &node;          ///< Node being wrapped.
+		Tedge_vector &edges;  ///< Outgoing edges for wrapped node, sorted by destination.
+		NodeID index;         ///< ID of wrapped node.
 
 	public:
 
+		/**
+		 * Find the position of the edge to the given node, or the position
+		 * such an edge would have to be inserted at.
+		 * @param to ID of end node of edge.
+		 * @return Position in the edge list.
+		 */
+		size_t FindEdge(NodeID to) const
+		{
+			return std::lower_bound(this->edges.begin(), this->edges.end(), to, [](const BaseEdge &edge, NodeID to) {
+				return edge.dest_node < to;
+			}) - this->edges.begin();
+		}
+
 		/**
 		 * Wrap a node.
 		 * @param node Node to be wrapped.
 		 * @param edges Outgoing edges for node to be wrapped.
 		 * @param index ID of node to be wrapped.
 		 */
-		NodeWrapper(Tnode &node, Tedge *edges, NodeID index) : node(node),
+		NodeWrapper(Tnode &node, Tedge_vector &edges, NodeID index) : node(node),
 			edges(edges), index(index) {}
 
+		/**
+		 * Check if there is an edge from the wrapped node to the given one.
+		 * @param to ID of end node of edge.
+		 * @return If the edge exists.
+		 */
+		bool HasEdgeTo(NodeID to) const
+		{
+			size_t pos = this->FindEdge(to);
+			return pos < this->edges.size() && this->edges[pos].dest_node == to;
+		}
+
+		/**
+		 * Get the number of outgoing edges of the wrapped node.
+		 * @return Number of edges.
+		 */
+		uint NumEdges() const { return (uint)this->edges.size(); }
+
 		/**
 		 * Get supply of wrapped node.
 		 * @return Supply.
@@ -173,17 +208,15 @@ public:
 	};
 
 	/**
-	 * Base class for iterating across outgoing edges of a node. Only the real
-	 * edges (those with capacity) are iterated. The ones with only distance
-	 * information are skipped.
+	 * Base class for iterating across outgoing edges of a node. As only the
+	 * real edges are stored this is a plain walk over the node's edge list.
 	 * @tparam Tedge Actual edge class. May be "BaseEdge" or "const BaseEdge".
 	 * @tparam Titer Actual iterator class.
 	 */
 	template <class Tedge, class Tedge_wrapper, class Titer>
 	class BaseEdgeIterator {
 	protected:
-		Tedge *base;    ///< Array of edges being iterated.
-		NodeID current; ///< Current offset in edges array.
+		Tedge *current; ///< Edge currently pointed to.
 
 		/**
 		 * A "fake" pointer to enable operator-> on temporaries. As the objects
@@ -210,13 +243,9 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param current ID of current node (to locate the first edge).
+		 * @param current Edge to start iterating at.
 		 */
-		BaseEdgeIterator (Tedge *base, NodeID current) :
-			base(base),
-			current(current == INVALID_NODE ? current : base[current].next_edge)
-		{}
+		BaseEdgeIterator (Tedge *current) : current(current) {}
 
 		/**
 		 * Prefix-increment.
@@ -224,7 +253,7 @@ public:
 		 */
 		Titer &operator++()
 		{
-			this->current = this->base[this->current].next_edge;
+			++this->current;
 			return static_cast<Titer &>(*this);
 		}
 
@@ -235,7 +264,7 @@ public:
 		Titer operator++(int)
 		{
 			Titer ret(static_cast<Titer &>(*this));
-			this->current = this->base[this->current].next_edge;
+			++this->current;
 			return ret;
 		}
 
@@ -244,12 +273,12 @@ public:
 		 * child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If the iterators have the same edge array and current node.
+		 * @return If the iterators point to the same edge.
 		 */
 		template<class Tother>
 		bool operator==(const Tother &other)
 		{
-			return this->base == other.base && this->current == other.current;
+			return this->current == other.current;
 		}
 
 		/**
@@ -257,12 +286,12 @@ public:
 		 * may be of a child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If either the edge arrays or the current nodes differ.
+		 * @return If the iterators point to different edges.
 		 */
 		template<class Tother>
 		bool operator!=(const Tother &other)
 		{
-			return this->base != other.base || this->current != other.current;
+			return this->current != other.current;
 		}
 
 		/**
@@ -271,7 +300,7 @@ public:
 		 */
 		SmallPair<NodeID, Tedge_wrapper> operator*() const
 		{
-			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(this->base[this->current]));
+			return SmallPair<NodeID, Tedge_wrapper>(this->current->dest_node, Tedge_wrapper(*this->current));
 		}
 
 		/**
@@ -311,11 +340,10 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start iterating at.
 		 */
-		ConstEdgeIterator(const BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
+		ConstEdgeIterator(const BaseEdge *current) :
+			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(current) {}
 	};
 
 	/**
@@ -326,18 +354,17 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start iterating at.
 		 */
-		EdgeIterator(BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(edges, current) {}
+		EdgeIterator(BaseEdge *current) :
+			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(current) {}
 	};
 
 	/**
 	 * Constant node class. Only retrieval operations are allowed on both the
 	 * node itself and its edges.
 	 */
-	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdge> {
+	class ConstNode : public NodeWrapper<const BaseNode, const EdgeVector> {
 	public:
 		/**
 		 * Constructor.
@@ -345,34 +372,40 @@ public:
 		 * @param node ID of the node.
 		 */
 		ConstNode(const LinkGraph *lg, NodeID node) :
-			NodeWrapper<const BaseNode, const BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<const BaseNode, const EdgeVector>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get a ConstEdge. This is not a reference as the wrapper objects are
-		 * not actually persistent.
+		 * not actually persistent. If there is no such edge an empty one is
+		 * returned.
 		 * @param to ID of end node of edge.
 		 * @return Constant edge wrapper.
 		 */
-		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const
+		{
+			size_t pos = this->FindEdge(to);
+			if (pos < this->edges.size() && this->edges[pos].dest_node == to) return ConstEdge(this->edges[pos]);
+			return ConstEdge(LinkGraph::empty_edge);
+		}
 
 		/**
 		 * Get an iterator pointing to the start of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges, this->index); }
+		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges.data()); }
 
 		/**
 		 * Get an iterator pointing beyond the end of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges, INVALID_NODE); }
+		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges.data() + this->edges.size()); }
 	};
 
 	/**
 	 * Updatable node class. The node itself as well as its edges can be modified.
 	 */
-	class Node : public NodeWrapper<BaseNode, BaseEdge> {
+	class Node : public NodeWrapper<BaseNode, EdgeVector> {
 	public:
 		/**
 		 * Constructor.
@@ -380,28 +413,34 @@ public:
 		 * @param node ID of the node.
 		 */
 		Node(LinkGraph *lg, NodeID node) :
-			NodeWrapper<BaseNode, BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<BaseNode, EdgeVector>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get an Edge. This is not a reference as the wrapper objects are not
-		 * actually persistent.
+		 * actually persistent. The edge has to exist.
 		 * @param to ID of end node of edge.
 		 * @return Edge wrapper.
 		 */
-		Edge operator[](NodeID to) { return Edge(this->edges[to]); }
+		Edge operator[](NodeID to)
+		{
+			size_t pos = this->FindEdge(to);
+			assert(pos < this->edges.size() && this->edges[pos].dest_node == to);
+			return Edge(this->edges[pos]);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the start of the edges array. Adding or
+		 * removing edges of this node invalidates the iterator.
 		 * @return Edge iterator.
 		 */
-		EdgeIterator Begin() { return EdgeIterator(this->edges, this->index); }
+		EdgeIterator Begin() { return EdgeIterator(this->edges.data()); }
 
 		/**
 		 * Get an iterator pointing beyond the end of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		EdgeIterator End() { return EdgeIterator(this->edges, INVALID_NODE); }
+		EdgeIterator End() { return EdgeIterator(this->edges.data() + this->edges.size()); }
 
 		/**
 		 * Update the node's supply and set last_update to the current date.
@@ -437,7 +476,10 @@ public:
 	};
 
 	typedef SmallVector<BaseNode, 16> NodeVector;
-	typedef SmallMatrix<BaseEdge> EdgeMatrix;
+	typedef std::vector<EdgeVector> AdjacencyList;
+
+	/** Edge returned when looking up a link which doesn't exist. */
+	static const BaseEdge empty_edge;
 
 	/** Minimum effective distance for timeout calculation. */
 	static const uint MIN_TIMEOUT_DISTANCE = 32;
@@ -459,12 +501,12 @@ public:
 	}
 
 	/** Bare constructor, only for save/load. */
-	LinkGraph() : cargo(INVALID_CARGO), last_compression(0) {}
+	LinkGraph() : cargo(INVALID_CARGO), last_compression(0), last_job_total(0) {}
 	/**
 	 * Real constructor.
 	 * @param cargo Cargo the link graph is about.
 	 */
-	LinkGraph(CargoID cargo) : cargo(cargo), last_compression(_date) {}
+	LinkGraph(CargoID cargo) : cargo(cargo), last_compression(_date), last_job_total(0) {}
 
 	void Init(uint size);
 	void ShiftDates(int interval);
@@ -524,6 +566,9 @@ public:
 	NodeID AddNode(const Station *st);
 	void RemoveNode(NodeID id);
 
+	uint GetChangeSinceLastJob() const;
+	void SetLastJobReference();
+
 	inline uint64 CalculateCostEstimate() const {
 		uint64 size_squared = this->Size() * this->Size();
 		return size_squared * FindLastBit(size_squared * size_squared); // N^2 * 4log_2(N)
@@ -534,12 +579,14 @@ protected:
 	friend class LinkGraph::Node;
 	friend const SaveLoad *GetLinkGraphDesc();
 	friend const SaveLoad *GetLinkGraphJobDesc();
-	friend void SaveLoad_LinkGraph(LinkGraph &lg);
+	friend void Save_LinkGraph(LinkGraph &lg);
+	friend void Load_LinkGraph(LinkGraph &lg);
 
 	CargoID cargo;         ///< Cargo of this component's link graph.
 	Date last_compression; ///< Last time the capacities and supplies were compressed.
+	uint64 last_job_total; ///< Sum of the monthly supplies and capacities when the last job was spawned.
 	NodeVector nodes;      ///< Nodes in the component.
-	EdgeMatrix edges;      ///< Edges in the component.
+	AdjacencyList edges;   ///< Outgoing edges of each node in the component.
 };
 
 #define FOR_ALL_LINK_GRAPHS(var) FOR_ALL_ITEMS_FROM(LinkGraph, link_graph_index, var, 0)
@@ -51,7 +51,8 @@ LinkGraphJob::LinkGraphJob(const LinkGraph &orig, uint duration_multiplier) :
 		join_date_ticks(GetLinkGraphJobJoinDateTicks(duration_multiplier)),
 		start_date_ticks((_date * DAY_TICKS) + _date_fract),
 		job_completed(false),
-		abort_job(false)
+		abort_job(false),
+		run_time_us(0)
 {
 }
 
@@ -66,20 +67,14 @@ void LinkGraphJob::EraseFlows(NodeID from)
 	}
 }
 
-void LinkGraphJob::SetJobGroup(std::shared_ptr<LinkGraphJobGroup> group)
-{
-	this->group = std::move(group);
-}
-
 /**
- * Join the calling thread with this job's thread if threading is enabled.
+ * Wait for the job's tasks in the worker pool to finish. Tasks of an aborted
+ * job which haven't been started yet are dropped.
  */
 void LinkGraphJob::JoinThread()
 {
-	if (this->group != nullptr) {
-		this->group->JoinThread();
-		this->group.reset();
-	}
+	if (this->IsJobAborted()) GetWorkerThreadPool().Cancel(&this->task_group);
+	GetWorkerThreadPool().Wait(&this->task_group);
 }
 
 /**
@@ -119,11 +114,11 @@ void LinkGraphJob::FinaliseJob()
 			continue;
 		}
 
-		LinkGraph *lg = LinkGraph::Get(ge.link_graph);
+		const LinkGraph *lg = LinkGraph::Get(ge.link_graph);
 		FlowStatMap &flows = from.Flows();
 
 		for (EdgeIterator it(from.Begin()); it != from.End(); ++it) {
-			if (from[it->first].Flow() == 0) continue;
+			if (it->second.Flow() == 0) continue;
 			StationID to = (*this)[it->first].Station();
 			Station *st2 = Station::GetIfValid(to);
 			if (st2 == NULL || st2->goods[this->Cargo()].link_graph != this->link_graph.index ||
@@ -154,7 +149,7 @@ void LinkGraphJob::FinaliseJob()
 				} else {
 					FlowStat shares(INVALID_STATION, 1);
 					it->second.SwapShares(shares);
-					ge.flows.erase(it++);
+					it = ge.flows.erase(it);
 					for (FlowStat::SharesMap::const_iterator shares_it(shares.GetShares()->begin());
 							shares_it != shares.GetShares()->end(); ++shares_it) {
 						RerouteCargo(st, this->Cargo(), shares_it->second, st->index);
@@ -229,13 +224,15 @@ void LinkGraphJob::Init()
 {
 	uint size = this->Size();
 	this->nodes.resize(size);
-	this->edges.Resize(size, size);
+	uint num_edges = 0;
 	for (uint i = 0; i < size; ++i) {
-		this->nodes[i].Init(this->link_graph[i].Supply());
-		EdgeAnnotation *node_edges = this->edges[i];
-		for (uint j = 0; j < size; ++j) {
-			node_edges[j].Init();
-		}
+		LinkGraph::ConstNode node = this->link_graph[i];
+		this->nodes[i].Init(node.Supply(), num_edges);
+		num_edges += node.NumEdges();
+	}
+	this->edges.resize(num_edges);
+	for (EdgeAnnotation &anno : this->edges) {
+		anno.Init();
 	}
 }
 
@@ -244,19 +241,18 @@ void LinkGraphJob::Init()
  */
 void LinkGraphJob::EdgeAnnotation::Init()
 {
-	this->demand = 0;
 	this->flow = 0;
-	this->unsatisfied_demand = 0;
 }
 
 /**
- * Initialize a Linkgraph job node. The underlying memory is expected to be
- * freshly allocated, without any constructors having been called.
+ * Initialize a Linkgraph job node.
  * @param supply Initial undelivered supply.
+ * @param first_edge Position of the annotation of the node's first edge.
  */
-void LinkGraphJob::NodeAnnotation::Init(uint supply)
+void LinkGraphJob::NodeAnnotation::Init(uint supply, uint first_edge)
 {
 	this->undelivered_supply = supply;
+	this->first_edge = first_edge;
 }
 
 /**
@@ -12,15 +12,15 @@
 #ifndef LINKGRAPHJOB_H
 #define LINKGRAPHJOB_H
 
-#include "../thread/thread.h"
+#include "../thread/thread_pool.h"
 #include "../core/dyn_arena_alloc.hpp"
+#include "../3rdparty/cpp-btree/btree_map.h"
 #include "linkgraph.h"
 #include <vector>
 #include <memory>
 
 class LinkGraphJob;
 class Path;
-class LinkGraphJobGroup;
 typedef std::vector<Path *> PathList;
 
 /** Type of the pool for link graph jobs. */
@@ -32,13 +32,58 @@ extern LinkGraphJobPool _link_graph_job_pool;
  * Class for calculation jobs to be run on link graphs.
  */
 class LinkGraphJob : public LinkGraphJobPool::PoolItem<&_link_graph_job_pool>{
+public:
+	/**
+	 * Annotation for the transport demand between two nodes. Only pairs of
+	 * nodes between which some demand has been assigned get one.
+	 */
+	struct DemandAnnotation {
+		uint demand;             ///< Transport demand between the nodes.
+		uint unsatisfied_demand; ///< Demand between the nodes that hasn't been satisfied yet.
+
+		DemandAnnotation() : demand(0), unsatisfied_demand(0) {}
+
+		/**
+		 * Get the transport demand between the nodes.
+		 * @return Demand.
+		 */
+		uint Demand() const { return this->demand; }
+
+		/**
+		 * Get the transport demand that hasn't been satisfied by flows, yet.
+		 * @return Unsatisfied demand.
+		 */
+		uint UnsatisfiedDemand() const { return this->unsatisfied_demand; }
+
+		/**
+		 * Add some (not yet satisfied) demand.
+		 * @param demand Demand to be added.
+		 */
+		void AddDemand(uint demand)
+		{
+			this->demand += demand;
+			this->unsatisfied_demand += demand;
+		}
+
+		/**
+		 * Satisfy some demand.
+		 * @param demand Demand to be satisfied.
+		 */
+		void SatisfyDemand(uint demand)
+		{
+			assert(demand <= this->unsatisfied_demand);
+			this->unsatisfied_demand -= demand;
+		}
+	};
+
+	/** Demands from one node to others, sorted by destination node. */
+	typedef btree::btree_map<NodeID, DemandAnnotation> DemandAnnotationMap;
+
 private:
 	/**
 	 * Annotation for a link graph edge.
 	 */
 	struct EdgeAnnotation {
-		uint demand;             ///< Transport demand between the nodes.
-		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 		uint flow;               ///< Planned flow over this edge.
 		void Init();
 	};
@@ -48,33 +93,34 @@ private:
 	 */
 	struct NodeAnnotation {
 		uint undelivered_supply; ///< Amount of supply that hasn't been distributed yet.
+		uint first_edge;         ///< Position of the annotation of the node's first edge in the job's edge annotations.
 		PathList paths;          ///< Paths through this node, sorted so that those with flow == 0 are in the back.
 		FlowStatMap flows;       ///< Planned flows to other nodes.
-		void Init(uint supply);
+		DemandAnnotationMap demands; ///< Demands to other nodes.
+		void Init(uint supply, uint first_edge);
 	};
 
 	typedef std::vector<NodeAnnotation> NodeAnnotationVector;
-	typedef SmallMatrix<EdgeAnnotation> EdgeAnnotationMatrix;
+	typedef std::vector<EdgeAnnotation> EdgeAnnotationVector;
 
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend void GetLinkGraphJobDayLengthScaleAfterLoad(LinkGraphJob *lgj);
 	friend class LinkGraphSchedule;
-	friend class LinkGraphJobGroup;
 
 protected:
 	const LinkGraph link_graph;       ///< Link graph to by analyzed. Is copied when job is started and mustn't be modified later.
-	std::shared_ptr<LinkGraphJobGroup> group; ///< JOb group thread the job is running in or NULL if it's running in the main thread.
+	WorkerTaskGroup task_group;       ///< Worker pool tasks of this job.
 	const LinkGraphSettings settings; ///< Copy of _settings_game.linkgraph at spawn time.
 	DateTicks join_date_ticks;        ///< Date when the job is to be joined.
 	DateTicks start_date_ticks;       ///< Date when the job was started.
 	NodeAnnotationVector nodes;       ///< Extra node data necessary for link graph calculation.
-	EdgeAnnotationMatrix edges;       ///< Extra edge data necessary for link graph calculation.
+	EdgeAnnotationVector edges;       ///< Extra edge data necessary for link graph calculation. Edges of each node are stored consecutively in the same order as in the link graph.
 	bool job_completed;               ///< Is the job still running. This is accessed by multiple threads and is permitted to be spuriously incorrect.
 	bool abort_job;                   ///< Abort the job at the next available opportunity. This is accessed by multiple threads.
+	uint64 run_time_us;               ///< Wall clock time taken to run the handlers, in microseconds. Only valid once the job has been joined.
 
 	void EraseFlows(NodeID from);
 	void JoinThread();
-	void SetJobGroup(std::shared_ptr<LinkGraphJobGroup> group);
 
 public:
 
@@ -98,18 +144,6 @@ public:
 		Edge(const LinkGraph::BaseEdge &edge, EdgeAnnotation &anno) :
 				LinkGraph::ConstEdge(edge), anno(anno) {}
 
-		/**
-		 * Get the transport demand between end the points of the edge.
-		 * @return Demand.
-		 */
-		uint Demand() const { return this->anno.demand; }
-
-		/**
-		 * Get the transport demand that hasn't been satisfied by flows, yet.
-		 * @return Unsatisfied demand.
-		 */
-		uint UnsatisfiedDemand() const { return this->anno.unsatisfied_demand; }
-
 		/**
 		 * Get the total flow on the edge.
 		 * @return Flow.
@@ -131,43 +165,24 @@ public:
 			assert(flow <= this->anno.flow);
 			this->anno.flow -= flow;
 		}
-
-		/**
-		 * Add some (not yet satisfied) demand.
-		 * @param demand Demand to be added.
-		 */
-		void AddDemand(uint demand)
-		{
-			this->anno.demand += demand;
-			this->anno.unsatisfied_demand += demand;
-		}
-
-		/**
-		 * Satisfy some demand.
-		 * @param demand Demand to be satisfied.
-		 */
-		void SatisfyDemand(uint demand)
-		{
-			assert(demand <= this->anno.unsatisfied_demand);
-			this->anno.unsatisfied_demand -= demand;
-		}
 	};
 
 	/**
 	 * Iterator for job edges.
 	 */
 	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator> {
-		EdgeAnnotation *base_anno; ///< Array of annotations to be (indirectly) iterated.
+		const LinkGraph::BaseEdge *base; ///< First edge of the node being iterated.
+		EdgeAnnotation *base_anno;       ///< Annotation of the first edge of the node being iterated.
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param base_anno Array of annotations to be iterated.
-		 * @param current Start offset of iteration.
+		 * @param base First edge of the node.
+		 * @param base_anno Annotation of the first edge of the node.
+		 * @param current Edge to start iterating at.
 		 */
-		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, NodeID current) :
-				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
-				base_anno(base_anno) {}
+		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, const LinkGraph::BaseEdge *current) :
+				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(current),
+				base(base), base_anno(base_anno) {}
 
 		/**
 		 * Dereference.
@@ -176,7 +191,7 @@ public:
 		 */
 		SmallPair<NodeID, Edge> operator*() const
 		{
-			return SmallPair<NodeID, Edge>(this->current, Edge(this->base[this->current], this->base_anno[this->current]));
+			return SmallPair<NodeID, Edge>(this->current->dest_node, Edge(*this->current, this->base_anno[this->current - this->base]));
 		}
 
 		/**
@@ -206,30 +221,45 @@ public:
 		 */
 		Node (LinkGraphJob *lgj, NodeID node) :
 			LinkGraph::ConstNode(&lgj->link_graph, node),
-			node_anno(lgj->nodes[node]), edge_annos(lgj->edges[node])
+			node_anno(lgj->nodes[node]), edge_annos(lgj->edges.data() + lgj->nodes[node].first_edge)
 		{}
 
 		/**
 		 * Retrieve an edge starting at this node. Mind that this returns an
-		 * object, not a reference.
+		 * object, not a reference. The edge has to exist.
 		 * @param to Remote end of the edge.
 		 * @return Edge between this node and "to".
 		 */
-		Edge operator[](NodeID to) const { return Edge(this->edges[to], this->edge_annos[to]); }
+		Edge operator[](NodeID to) const
+		{
+			size_t pos = this->FindEdge(to);
+			assert(pos < this->edges.size() && this->edges[pos].dest_node == to);
+			return Edge(this->edges[pos], this->edge_annos[pos]);
+		}
 
 		/**
-		 * Iterator for the "begin" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "begin" of the edge array.
 		 * @return Iterator pointing to the first edge.
 		 */
-		EdgeIterator Begin() const { return EdgeIterator(this->edges, this->edge_annos, index); }
+		EdgeIterator Begin() const { return EdgeIterator(this->edges.data(), this->edge_annos, this->edges.data()); }
 
 		/**
-		 * Iterator for the "end" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "end" of the edge array.
 		 * @return Iterator pointing beyond the last edge.
 		 */
-		EdgeIterator End() const { return EdgeIterator(this->edges, this->edge_annos, INVALID_NODE); }
+		EdgeIterator End() const { return EdgeIterator(this->edges.data(), this->edge_annos, this->edges.data() + this->edges.size()); }
+
+		/**
+		 * Get the demands from this node to other nodes.
+		 * @return Demands.
+		 */
+		DemandAnnotationMap &Demands() { return this->node_anno.demands; }
+
+		/**
+		 * Get a constant version of the demands from this node to other nodes.
+		 * @return Demands.
+		 */
+		const DemandAnnotationMap &Demands() const { return this->node_anno.demands; }
 
 		/**
 		 * Get amount of supply that hasn't been delivered, yet.
@@ -269,8 +299,9 @@ public:
 		 */
 		void DeliverSupply(NodeID to, uint amount)
 		{
+			if (amount == 0) return;
 			this->node_anno.undelivered_supply -= amount;
-			(*this)[to].AddDemand(amount);
+			this->node_anno.demands[to].AddDemand(amount);
 		}
 	};
 
@@ -279,7 +310,7 @@ public:
 	 * settings have to be brutally const-casted in order to populate them.
 	 */
 	LinkGraphJob() : settings(_settings_game.linkgraph),
-			join_date_ticks(INVALID_DATE), start_date_ticks(INVALID_DATE), job_completed(false) {}
+			join_date_ticks(INVALID_DATE), start_date_ticks(INVALID_DATE), job_completed(false), abort_job(false), run_time_us(0) {}
 
 	LinkGraphJob(const LinkGraph &orig, uint duration_multiplier);
 	~LinkGraphJob();
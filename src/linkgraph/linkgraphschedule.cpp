@@ -17,6 +17,7 @@
 #include "flowmapper.h"
 #include "../command_func.h"
 #include <algorithm>
+#include <chrono>
 
 #include "../safeguards.h"
 
@@ -64,17 +65,29 @@ void LinkGraphSchedule::SpawnNext()
 	uint scaling = 1 + FindLastBit(total_cost);
 	uint64 cost_budget = total_cost / scaling;
 	uint64 used_budget = 0;
-	std::vector<LinkGraphJobGroup::JobInfo> jobs_to_execute;
+	std::vector<LinkGraphJob *> jobs_to_execute;
 	while (used_budget < cost_budget && !this->schedule.empty()) {
 		LinkGraph *lg = this->schedule.front();
 		assert(lg == LinkGraph::Get(lg->index));
 		this->schedule.pop_front();
+		uint threshold = _settings_game.linkgraph.recalc_change_threshold;
+		if (threshold > 0) {
+			uint change = lg->GetChangeSinceLastJob();
+			if (change < threshold) {
+				/* Keep the flows of the last run; try again next time round. */
+				schedule_to_back.push_back(lg);
+				DEBUG(linkgraph, 3, "LinkGraphSchedule::SpawnNext(): Skipping unchanged link graph: id: %u, nodes: %u, change: %u%%",
+						lg->index, lg->Size(), change);
+				continue;
+			}
+		}
 		uint64 cost = lg->CalculateCostEstimate();
 		used_budget += cost;
 		if (LinkGraphJob::CanAllocateItem()) {
+			lg->SetLastJobReference();
 			uint duration_multiplier = CeilDivT<uint64_t>(scaling * cost, total_cost);
 			std::unique_ptr<LinkGraphJob> job(new LinkGraphJob(*lg, duration_multiplier));
-			jobs_to_execute.emplace_back(job.get(), cost);
+			jobs_to_execute.push_back(job.get());
 			if (this->running.empty() || job->JoinDateTicks() >= this->running.back()->JoinDateTicks()) {
 				this->running.push_back(std::move(job));
 				DEBUG(linkgraph, 3, "LinkGraphSchedule::SpawnNext(): Running job: id: %u, nodes: %u, cost: " OTTD_PRINTF64U ", duration_multiplier: %u",
@@ -95,10 +108,10 @@ void LinkGraphSchedule::SpawnNext()
 
 	this->schedule.splice(this->schedule.end(), schedule_to_back);
 
-	LinkGraphJobGroup::ExecuteJobSet(std::move(jobs_to_execute));
+	this->StartJobs(std::move(jobs_to_execute));
 
-	DEBUG(linkgraph, 2, "LinkGraphSchedule::SpawnNext(): Linkgraph job totals: cost: " OTTD_PRINTF64U ", budget: " OTTD_PRINTF64U ", scaling: %u, scheduled: %zu, running: %zu",
-			total_cost, cost_budget, scaling, this->schedule.size(), this->running.size());
+	DEBUG(linkgraph, 2, "LinkGraphSchedule::SpawnNext(): Linkgraph job totals: cost: " OTTD_PRINTF64U ", budget: " OTTD_PRINTF64U ", scaling: %u, scheduled: %zu, running: %zu, queue depth: %u, workers: %u",
+			total_cost, cost_budget, scaling, this->schedule.size(), this->running.size(), GetWorkerThreadPool().QueueDepth(), GetWorkerThreadPool().NumWorkers());
 }
 
 /**
@@ -129,8 +142,18 @@ void LinkGraphSchedule::JoinNext()
 		std::unique_ptr<LinkGraphJob> next = std::move(this->running.front());
 		this->running.pop_front();
 		LinkGraphID id = next->LinkGraphIndex();
+		bool completed = next->IsJobCompleted();
+		std::chrono::steady_clock::time_point join_start = std::chrono::steady_clock::now();
 		next->FinaliseJob(); // joins the thread and finalises the job
 		assert(!next->IsJobAborted());
+		if (completed) {
+			DEBUG(linkgraph, 2, "LinkGraphSchedule::JoinNext(): Joined job: id: %u, cargo: %u, nodes: %u, run time: " OTTD_PRINTF64U " us",
+					id, next->Cargo(), next->Size(), next->run_time_us);
+		} else {
+			uint64 waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - join_start).count();
+			DEBUG(linkgraph, 1, "LinkGraphSchedule::JoinNext(): Joined unfinished job: id: %u, cargo: %u, nodes: %u, run time: " OTTD_PRINTF64U " us, waited: " OTTD_PRINTF64U " us, queue depth: %u",
+					id, next->Cargo(), next->Size(), next->run_time_us, waited, GetWorkerThreadPool().QueueDepth());
+		}
 		next.reset();
 		if (LinkGraph::IsValidID(id)) {
 			LinkGraph *lg = LinkGraph::Get(id);
@@ -142,16 +165,18 @@ void LinkGraphSchedule::JoinNext()
 
 /**
  * Run all handlers for the given Job. This method is tailored to
- * ThreadObject::New.
+ * WorkerThreadPool::Submit.
  * @param j Pointer to a link graph job.
  */
 /* static */ void LinkGraphSchedule::Run(void *j)
 {
 	LinkGraphJob *job = (LinkGraphJob *)j;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 	for (uint i = 0; i < lengthof(instance.handlers); ++i) {
 		if (job->IsJobAborted()) return;
 		instance.handlers[i]->Run(*job);
 	}
+	job->run_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 
 	/*
 	 * Note that this it not guaranteed to be an atomic write and there are no memory barriers or other protections.
@@ -175,11 +200,30 @@ void LinkGraphSchedule::JoinNext()
  */
 void LinkGraphSchedule::SpawnAll()
 {
-	std::vector<LinkGraphJobGroup::JobInfo> jobs_to_execute;
+	std::vector<LinkGraphJob *> jobs_to_execute;
 	for (JobList::iterator i = this->running.begin(); i != this->running.end(); ++i) {
-		jobs_to_execute.emplace_back(i->get());
+		jobs_to_execute.push_back(i->get());
+	}
+	this->StartJobs(std::move(jobs_to_execute));
+}
+
+/**
+ * Hand the given jobs to the worker pool. Jobs which are due to be joined
+ * first are queued first. If no worker threads could be started the jobs are
+ * run right here.
+ * @param jobs Jobs to start.
+ */
+void LinkGraphSchedule::StartJobs(std::vector<LinkGraphJob *> jobs)
+{
+	if (jobs.empty()) return;
+
+	std::stable_sort(jobs.begin(), jobs.end(), [](const LinkGraphJob *a, const LinkGraphJob *b) {
+		return a->JoinDateTicks() < b->JoinDateTicks();
+	});
+
+	for (LinkGraphJob *job : jobs) {
+		GetWorkerThreadPool().Submit(&LinkGraphSchedule::Run, job, &job->task_group);
 	}
-	LinkGraphJobGroup::ExecuteJobSet(std::move(jobs_to_execute));
 }
 
 /**
@@ -228,82 +272,6 @@ LinkGraphSchedule::~LinkGraphSchedule()
 	this->Clear();
 }
 
-LinkGraphJobGroup::LinkGraphJobGroup(constructor_token token, std::vector<LinkGraphJob *> jobs) :
-	jobs(std::move(jobs)) { }
-
-void LinkGraphJobGroup::SpawnThread() {
-	ThreadObject *t = nullptr;
-
-	/**
-	 * Spawn a thread if possible and run the link graph job in the thread. If
-	 * that's not possible run the job right now in the current thread.
-	 */
-	if (ThreadObject::New(&(LinkGraphJobGroup::Run), this, &t, "ottd:linkgraph")) {
-		this->thread.reset(t);
-		for (auto &it : this->jobs) {
-			it->SetJobGroup(this->shared_from_this());
-		}
-	} else {
-		this->thread.reset();
-		/* Of course this will hang a bit.
-		 * On the other hand, if you want to play games which make this hang noticably
-		 * on a platform without threads then you'll probably get other problems first.
-		 * OK:
-		 * If someone comes and tells me that this hangs for him/her, I'll implement a
-		 * smaller grained "Step" method for all handlers and add some more ticks where
-		 * "Step" is called. No problem in principle. */
-		LinkGraphJobGroup::Run(this);
-	}
-}
-
-void LinkGraphJobGroup::JoinThread() {
-	if (!this->thread || this->joined_thread) return;
-	this->thread->Join();
-	this->joined_thread = true;
-}
-
-/**
- * Run all jobs for the given LinkGraphJobGroup. This method is tailored to
- * ThreadObject::New.
- * @param j Pointer to a LinkGraphJobGroup.
- */
-/* static */ void LinkGraphJobGroup::Run(void *group)
-{
-	LinkGraphJobGroup *job_group = (LinkGraphJobGroup *)group;
-	for (LinkGraphJob *job : job_group->jobs) {
-		LinkGraphSchedule::Run(job);
-	}
-}
-
-/* static */ void LinkGraphJobGroup::ExecuteJobSet(std::vector<JobInfo> jobs) {
-	const uint thread_budget = 200000;
-
-	std::sort(jobs.begin(), jobs.end(), [](const JobInfo &a, const JobInfo &b) {
-		return a.cost_estimate < b.cost_estimate;
-	});
-
-	std::vector<LinkGraphJob *> bucket;
-	uint bucket_cost = 0;
-	auto flush_bucket = [&]() {
-		if (!bucket_cost) return;
-		DEBUG(linkgraph, 2, "LinkGraphJobGroup::ExecuteJobSet: Creating Job Group: jobs: %zu, cost: %u", bucket.size(), bucket_cost);
-		auto group = std::make_shared<LinkGraphJobGroup>(constructor_token(), std::move(bucket));
-		group->SpawnThread();
-		bucket_cost = 0;
-		bucket.clear();
-	};
-
-	for (JobInfo &it : jobs) {
-		if (bucket_cost && (bucket_cost + it.cost_estimate > thread_budget)) flush_bucket();
-		bucket.push_back(it.job);
-		bucket_cost += it.cost_estimate;
-	}
-	flush_bucket();
-}
-
-LinkGraphJobGroup::JobInfo::JobInfo(LinkGraphJob *job) :
-		job(job), cost_estimate(job->Graph().CalculateCostEstimate()) { }
-
 /**
  * Pause the game if on the next _date_fract tick, we would do a join with the next
  * link graph job, but it is still running.
@@ -12,7 +12,7 @@
 #ifndef LINKGRAPHSCHEDULE_H
 #define LINKGRAPHSCHEDULE_H
 
-#include "../thread/thread.h"
+#include "../thread/thread_pool.h"
 #include "linkgraph.h"
 #include <memory>
 
@@ -50,6 +50,8 @@ protected:
 	GraphList schedule;            ///< Queue for new jobs.
 	JobList running;               ///< Currently running jobs.
 
+	void StartJobs(std::vector<LinkGraphJob *> jobs);
+
 public:
 	/* This is a tick where not much else is happening, so a small lag might go unnoticed. */
 	static const uint SPAWN_JOIN_TICK = 21; ///< Tick when jobs are spawned or joined every day.
@@ -81,33 +83,4 @@ public:
 	void Unqueue(LinkGraph *lg) { this->schedule.remove(lg); }
 };
 
-class LinkGraphJobGroup : public std::enable_shared_from_this<LinkGraphJobGroup> {
-	friend LinkGraphJob;
-
-private:
-	bool joined_thread = false;              ///< True if thread has already been joined
-	std::unique_ptr<ThreadObject> thread;    ///< Thread the job group is running in or NULL if it's running in the main thread.
-	const std::vector<LinkGraphJob *> jobs;  ///< The set of jobs in this job set
-
-private:
-	struct constructor_token { };
-	static void Run(void *group);
-	void SpawnThread();
-	void JoinThread();
-
-public:
-	LinkGraphJobGroup(constructor_token token, std::vector<LinkGraphJob *> jobs);
-
-	struct JobInfo {
-		LinkGraphJob * job;
-		uint cost_estimate;
-
-		JobInfo(LinkGraphJob *job);
-		JobInfo(LinkGraphJob *job, uint cost_estimate) :
-				job(job), cost_estimate(cost_estimate) { }
-	};
-
-	static void ExecuteJobSet(std::vector<JobInfo> jobs);
-};
-
 #endif /* LINKGRAPHSCHEDULE_H */
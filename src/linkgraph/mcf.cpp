@@ -4,7 +4,9 @@
 #include "../core/math_func.hpp"
 #include "mcf.h"
 #include "../3rdparty/cpp-btree/btree_map.h"
+#include "../console_func.h"
 #include <set>
+#include <chrono>
 
 #include "../safeguards.h"
 
@@ -12,7 +14,7 @@ typedef btree::btree_map<NodeID, Path *> PathViaMap;
 
 /**
  * This is a wrapper around Tannotation* which also stores a cache of GetAnnotation() and GetNode()
- * to remove the need dereference the Tannotation* pointer when sorting/inseting/erasing in MultiCommodityFlow::Dijkstra::AnnoSet
+ * to remove the need dereference the Tannotation* pointer when sorting/inseting/erasing in the Dijkstra queues
  */
 template<typename Tannotation>
 class AnnoSetItem {
@@ -105,8 +107,8 @@ public:
 };
 
 /**
- * Iterator class for getting the edges in the order of their next_edge
- * members.
+ * Iterator class for getting the edges of a node in the order they are stored
+ * in the link graph.
  */
 class GraphEdgeIterator {
 private:
@@ -121,7 +123,7 @@ public:
 	 * @param job Job to iterate on.
 	 */
 	GraphEdgeIterator(LinkGraphJob &job) : job(job),
-		i(NULL, NULL, INVALID_NODE), end(NULL, NULL, INVALID_NODE)
+		i(NULL, NULL, NULL), end(NULL, NULL, NULL)
 	{}
 
 	/**
@@ -284,7 +286,7 @@ struct AnnoSetAllocatorStore {
 };
 
 /**
- * Custom allocator specifically for use with MultiCommodityFlow::Dijkstra::AnnoSet
+ * Custom allocator specifically for use with AnnoSetQueue
  * This allocates RB-set nodes in contiguous blocks, and frees all allocated nodes when destructed
  * If a node is deallocated, it is returned in the next allocation, this is so that the same node
  * can be re-used across a call to Path::Fork
@@ -340,58 +342,206 @@ struct AnnoSetAllocator {
 #endif
 
 /**
- * Annotation wrapper class which also stores an iterator to the AnnoSet node which points to this annotation
- * This is to enable erasing the AnnoSet node when calling Path::Fork without having to search the set
+ * Priority queue of annotations for the Dijkstra algorithm, based on a
+ * std::set. Every update erases and reinserts the annotation. This is slower
+ * than AnnoHeap and only kept as a reference for benchmarking.
  */
 template<class Tannotation>
-struct AnnosWrapper : public Tannotation {
+class AnnoSetQueue {
 #ifdef CUSTOM_ALLOCATOR
-	typename std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator, AnnoSetAllocator<AnnoSetItem<Tannotation> > >::iterator self_iter;
+	typedef std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator, AnnoSetAllocator<AnnoSetItem<Tannotation> > > AnnoSet;
+	AnnoSetAllocatorStore annos_store;
+#else
+	typedef std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator> AnnoSet;
+#endif
+	AnnoSet annos;                                      ///< Queued annotations, best first.
+	std::vector<typename AnnoSet::iterator> self_iters; ///< Set node of each annotation, or annos.end() if not queued.
+
+public:
+	/**
+	 * Create an empty queue.
+	 * @param size Number of nodes in the graph.
+	 */
+#ifdef CUSTOM_ALLOCATOR
+	AnnoSetQueue(uint size) : annos(typename Tannotation::Comparator(), AnnoSetAllocator<AnnoSetItem<Tannotation> >(annos_store)), self_iters(size, annos.end()) {}
 #else
-	typename std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator>::iterator self_iter;
+	AnnoSetQueue(uint size) : self_iters(size, annos.end()) {}
 #endif
 
+	inline bool IsEmpty() const { return this->annos.empty(); }
+
+	/**
+	 * Queue an annotation or move it to the right place after its value changed.
+	 * @param anno Annotation to be queued.
+	 */
+	inline void Push(Tannotation *anno)
+	{
+		typename AnnoSet::iterator &self_iter = this->self_iters[anno->GetNode()];
+		if (self_iter != this->annos.end()) this->annos.erase(self_iter);
+		self_iter = this->annos.insert(AnnoSetItem<Tannotation>(anno)).first;
+	}
+
+	/**
+	 * Remove the best annotation from the queue.
+	 * @return Best annotation.
+	 */
+	inline Tannotation *Pop()
+	{
+		typename AnnoSet::iterator i = this->annos.begin();
+		Tannotation *anno = i->anno_ptr;
+		this->self_iters[i->node_id] = this->annos.end();
+		this->annos.erase(i);
+		return anno;
+	}
+};
+
+/**
+ * Priority queue of annotations for the Dijkstra algorithm. This is an
+ * indexed 4-ary heap in a flat array. The position of each node in the heap is
+ * tracked so that the annotation of a queued node can be updated in place,
+ * in either direction, without searching. The order is the same strict total
+ * order as used by AnnoSetQueue, so both yield the same results.
+ */
+template<class Tannotation>
+class AnnoHeap {
+	static const uint ARITY = 4;
+	static const uint NOT_QUEUED = UINT_MAX;
+	typedef AnnoSetItem<Tannotation> Item;
+
+	std::vector<Item> heap;                ///< The heap, best annotation first.
+	std::vector<uint> positions;           ///< Position of each node in #heap, or NOT_QUEUED.
+	typename Tannotation::Comparator comp; ///< Returns if an item is better than another one.
+
+	inline void Place(uint pos, const Item &item)
+	{
+		this->heap[pos] = item;
+		this->positions[item.node_id] = pos;
+	}
+
+	void SiftUp(uint pos)
+	{
+		Item item = this->heap[pos];
+		while (pos > 0) {
+			uint parent = (pos - 1) / ARITY;
+			if (!this->comp(item, this->heap[parent])) break;
+			this->Place(pos, this->heap[parent]);
+			pos = parent;
+		}
+		this->Place(pos, item);
+	}
+
+	void SiftDown(uint pos)
+	{
+		Item item = this->heap[pos];
+		uint size = (uint)this->heap.size();
+		for (;;) {
+			uint first_child = pos * ARITY + 1;
+			if (first_child >= size) break;
+			uint last_child = min(first_child + ARITY, size);
+			uint best = first_child;
+			for (uint child = first_child + 1; child < last_child; ++child) {
+				if (this->comp(this->heap[child], this->heap[best])) best = child;
+			}
+			if (!this->comp(this->heap[best], item)) break;
+			this->Place(pos, this->heap[best]);
+			pos = best;
+		}
+		this->Place(pos, item);
+	}
+
+public:
+	/**
+	 * Create an empty queue.
+	 * @param size Number of nodes in the graph.
+	 */
+	AnnoHeap(uint size) : positions(size, NOT_QUEUED)
+	{
+		this->heap.reserve(size);
+	}
+
+	inline bool IsEmpty() const { return this->heap.empty(); }
 
-	AnnosWrapper(NodeID n, bool source = false) : Tannotation(n, source) {}
+	/**
+	 * Queue an annotation or move it to the right place after its value changed.
+	 * @param anno Annotation to be queued.
+	 */
+	void Push(Tannotation *anno)
+	{
+		NodeID node = anno->GetNode();
+		uint pos = this->positions[node];
+		if (pos == NOT_QUEUED) {
+			pos = (uint)this->heap.size();
+			this->heap.push_back(Item(anno));
+		} else {
+			this->heap[pos] = Item(anno);
+		}
+		this->SiftUp(pos);
+		this->SiftDown(this->positions[node]);
+	}
+
+	/**
+	 * Remove the best annotation from the queue.
+	 * @return Best annotation.
+	 */
+	Tannotation *Pop()
+	{
+		Tannotation *anno = this->heap.front().anno_ptr;
+		this->positions[this->heap.front().node_id] = NOT_QUEUED;
+		Item last = this->heap.back();
+		this->heap.pop_back();
+		if (!this->heap.empty()) {
+			this->Place(0, last);
+			this->SiftDown(0);
+		}
+		return anno;
+	}
 };
 
+/**
+ * Allocate uninitialised storage for one annotation per node, to be filled in
+ * by Dijkstra. The allocator isn't thread safe, so this has to be done before
+ * handing the paths to a worker thread.
+ * @tparam Tannotation Annotation to be used.
+ * @param paths Container for the paths to be calculated.
+ */
+template<class Tannotation>
+void MultiCommodityFlow::AllocatePaths(PathVector &paths)
+{
+	uint size = this->job.Size();
+	paths.resize(size, NULL);
+
+	this->job.path_allocator.SetParameters(sizeof(Tannotation), (8192 - 32) / sizeof(Tannotation));
+
+	for (NodeID node = 0; node < size; ++node) {
+		paths[node] = static_cast<Path *>(this->job.path_allocator.Allocate());
+	}
+}
+
 /**
  * A slightly modified Dijkstra algorithm. Grades the paths not necessarily by
  * distance, but by the value Tannotation computes. It uses the max_saturation
  * setting to artificially decrease capacities.
  * @tparam Tannotation Annotation to be used.
  * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @tparam Tqueue Priority queue to be used for the annotations.
  * @param source_node Node where the algorithm starts.
- * @param paths Container for the paths to be calculated.
+ * @param paths Container for the paths to be calculated, as set up by AllocatePaths.
  */
-template<class Tannotation, class Tedge_iterator>
+template<class Tannotation, class Tedge_iterator, class Tqueue>
 void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 {
-#ifdef CUSTOM_ALLOCATOR
-	typedef std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator, AnnoSetAllocator<AnnoSetItem<Tannotation> > > AnnoSet;
-	AnnoSetAllocatorStore annos_store;
-	AnnoSet annos = AnnoSet(typename Tannotation::Comparator(), AnnoSetAllocator<Tannotation *>(annos_store));
-#else
-	typedef std::set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator> AnnoSet;
-	AnnoSet annos = AnnoSet(typename Tannotation::Comparator());
-#endif
 	Tedge_iterator iter(this->job);
 	uint size = this->job.Size();
-	paths.resize(size, NULL);
-
-	this->job.path_allocator.SetParameters(sizeof(AnnosWrapper<Tannotation>), (8192 - 32) / sizeof(AnnosWrapper<Tannotation>));
+	assert(paths.size() == size);
+	Tqueue annos(size);
 
 	for (NodeID node = 0; node < size; ++node) {
-		AnnosWrapper<Tannotation> *anno = new (this->job.path_allocator.Allocate()) AnnosWrapper<Tannotation>(node, node == source_node);
+		Tannotation *anno = new (paths[node]) Tannotation(node, node == source_node);
 		anno->UpdateAnnotation();
-		anno->self_iter = annos.insert(AnnoSetItem<Tannotation>(anno)).first;
-		paths[node] = anno;
-	}
-	while (!annos.empty()) {
-		typename AnnoSet::iterator i = annos.begin();
-		AnnosWrapper<Tannotation> *source = static_cast<AnnosWrapper<Tannotation> *>(i->anno_ptr);
-		annos.erase(i);
-		source->self_iter = annos.end();
+		annos.Push(anno);
+	}
+	while (!annos.IsEmpty()) {
+		Tannotation *source = annos.Pop();
 		NodeID from = source->GetNode();
 		iter.SetNode(source_node, from);
 		for (NodeID to = iter.Next(); to != INVALID_NODE; to = iter.Next()) {
@@ -405,17 +555,72 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 			}
 			/* punish in-between stops a little */
 			uint distance = DistanceMaxPlusManhattan(this->job[from].XY(), this->job[to].XY()) + 1;
-			AnnosWrapper<Tannotation> *dest = static_cast<AnnosWrapper<Tannotation> *>(paths[to]);
+			Tannotation *dest = static_cast<Tannotation *>(paths[to]);
 			if (dest->IsBetter(source, capacity, capacity - edge.Flow(), distance)) {
-				if (dest->self_iter != annos.end()) annos.erase(dest->self_iter);
 				dest->Fork(source, capacity, capacity - edge.Flow(), distance);
 				dest->UpdateAnnotation();
-				dest->self_iter = annos.insert(AnnoSetItem<Tannotation>(dest)).first;
+				annos.Push(dest);
 			}
 		}
 	}
 }
 
+/** Parameters of a Dijkstra run on a worker thread. */
+struct DijkstraTask {
+	MultiCommodityFlow *mcf; ///< Flow calculation the run belongs to.
+	NodeID source;           ///< Node where the algorithm starts.
+	PathVector *paths;       ///< Allocated paths to be calculated.
+};
+
+/**
+ * Run Dijkstra for a DijkstraTask. This method is tailored to
+ * WorkerThreadPool::Submit.
+ * @param task Pointer to the DijkstraTask.
+ */
+template<class Tannotation, class Tedge_iterator>
+/* static */ void MultiCommodityFlow::RunDijkstra(void *task)
+{
+	DijkstraTask *t = static_cast<DijkstraTask *>(task);
+	t->mcf->Dijkstra<Tannotation, Tedge_iterator, AnnoHeap<Tannotation> >(t->source, *t->paths);
+}
+
+/**
+ * Calculate the path trees of the next source node(s) to be handled.
+ * Normally only a single source is handled, so that each search sees the
+ * flows assigned for all previous sources. If parallel_mcf is set the trees
+ * of up to PARALLEL_BATCH_SIZE sources are calculated concurrently on the
+ * link graph worker threads, all based on the flows before the batch. The
+ * result is independent of the number of threads, as long as the caller
+ * assigns flow for the sources in order.
+ * @tparam Tannotation Annotation to be used.
+ * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @param first_source First source node to calculate the paths for.
+ * @param paths Container for the path trees, one per source.
+ * @return Number of sources handled, i.e. filled entries in paths.
+ */
+template<class Tannotation, class Tedge_iterator>
+uint MultiCommodityFlow::FindPaths(NodeID first_source, PathVectorList &paths)
+{
+	uint count = this->job.Settings().parallel_mcf ? min<uint>(this->job.Size() - first_source, PARALLEL_BATCH_SIZE) : 1;
+	paths.resize(count);
+	for (uint i = 0; i < count; ++i) this->AllocatePaths<Tannotation>(paths[i]);
+
+	if (count == 1) {
+		this->Dijkstra<Tannotation, Tedge_iterator, AnnoHeap<Tannotation> >(first_source, paths[0]);
+		return 1;
+	}
+
+	/* The searches only read from the job, so they can run concurrently. */
+	std::vector<DijkstraTask> tasks(count);
+	WorkerTaskGroup group;
+	for (uint i = 0; i < count; ++i) {
+		tasks[i] = { this, (NodeID)(first_source + i), &paths[i] };
+		GetWorkerThreadPool().Submit(&MultiCommodityFlow::RunDijkstra<Tannotation, Tedge_iterator>, &tasks[i], &group, true);
+	}
+	GetWorkerThreadPool().Wait(&group);
+	return count;
+}
+
 /**
  * Clean up paths that lead nowhere and the root path.
  * @param source_id ID of the root node.
@@ -445,20 +650,20 @@ void MultiCommodityFlow::CleanupPaths(NodeID source_id, PathVector &paths)
 
 /**
  * Push flow along a path and update the unsatisfied_demand of the associated
- * edge.
- * @param edge Edge whose ends the path connects.
+ * demand.
+ * @param demand Demand between the ends of the path.
  * @param path End of the path the flow should be pushed on.
  * @param accuracy Accuracy of the calculation.
  * @param max_saturation If < UINT_MAX only push flow up to the given
  *                       saturation, otherwise the path can be "overloaded".
  */
-uint MultiCommodityFlow::PushFlow(Edge &edge, Path *path, uint accuracy,
+uint MultiCommodityFlow::PushFlow(DemandAnnotation &demand, Path *path, uint accuracy,
 		uint max_saturation)
 {
-	assert(edge.UnsatisfiedDemand() > 0);
-	uint flow = Clamp(edge.Demand() / accuracy, 1, edge.UnsatisfiedDemand());
+	assert(demand.UnsatisfiedDemand() > 0);
+	uint flow = Clamp(demand.Demand() / accuracy, 1, demand.UnsatisfiedDemand());
 	flow = path->AddFlow(flow, this->job, max_saturation);
-	edge.SatisfyDemand(flow);
+	demand.SatisfyDemand(flow);
 	return flow;
 }
 
@@ -607,47 +812,92 @@ bool MCF1stPass::EliminateCycles()
 	return cycles_found;
 }
 
+/**
+ * Push flow for all unsatisfied demands of a source along the shortest paths
+ * found for it, up to the saturation limit.
+ * @param source Source node of the demands.
+ * @param paths Path tree calculated for source.
+ * @param accuracy Accuracy of the calculation.
+ * @return If any flow could be assigned and demand is still left.
+ */
+bool MCF1stPass::SaturatePaths(NodeID source, PathVector &paths, uint accuracy)
+{
+	bool more_loops = false;
+
+	/* Demands are sorted by destination, so they are handled in the
+	 * same order as iterating over all nodes would. */
+	DemandAnnotationMap &demands = this->job[source].Demands();
+	for (DemandAnnotationMap::iterator it = demands.begin(); it != demands.end(); ++it) {
+		DemandAnnotation &demand = it->second;
+		if (demand.UnsatisfiedDemand() > 0) {
+			Path *path = paths[it->first];
+			assert(path != NULL);
+			/* Generally only allow paths that don't exceed the
+			 * available capacity. But if no demand has been assigned
+			 * yet, make an exception and allow any valid path *once*. */
+			if (path->GetFreeCapacity() > 0 && this->PushFlow(demand, path,
+					accuracy, this->max_saturation) > 0) {
+				/* If a path has been found there is a chance we can
+				 * find more. */
+				more_loops = more_loops || (demand.UnsatisfiedDemand() > 0);
+			} else if (demand.UnsatisfiedDemand() == demand.Demand() &&
+					path->GetFreeCapacity() > INT_MIN) {
+				this->PushFlow(demand, path, accuracy, UINT_MAX);
+			}
+		}
+	}
+	return more_loops;
+}
+
 /**
  * Run the first pass of the MCF calculation.
  * @param job Link graph job to calculate.
  */
 MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
-	PathVector paths;
+	PathVectorList paths;
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool more_loops;
 
 	do {
 		more_loops = false;
-		for (NodeID source = 0; source < size; ++source) {
+		for (NodeID first_source = 0; first_source < size;) {
 			/* First saturate the shortest paths. */
-			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
-
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = job[source][dest];
-				if (edge.UnsatisfiedDemand() > 0) {
-					Path *path = paths[dest];
-					assert(path != NULL);
-					/* Generally only allow paths that don't exceed the
-					 * available capacity. But if no demand has been assigned
-					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
-							accuracy, this->max_saturation) > 0) {
-						/* If a path has been found there is a chance we can
-						 * find more. */
-						more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
-					} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
-							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(edge, path, accuracy, UINT_MAX);
-					}
-				}
+			uint count = this->FindPaths<DistanceAnnotation, GraphEdgeIterator>(first_source, paths);
+			for (uint i = 0; i < count; ++i) {
+				NodeID source = first_source + i;
+				if (this->SaturatePaths(source, paths[i], accuracy)) more_loops = true;
+				this->CleanupPaths(source, paths[i]);
 			}
-			this->CleanupPaths(source, paths);
+			first_source += count;
 		}
 	} while ((more_loops || this->EliminateCycles()) && !job.IsJobAborted());
 }
 
+/**
+ * Push flow for all unsatisfied demands of a source along the paths with the
+ * most capacity left, regardless of saturation.
+ * @param source Source node of the demands.
+ * @param paths Path tree calculated for source.
+ * @param accuracy Accuracy of the calculation.
+ * @return If any demand is still left.
+ */
+bool MCF2ndPass::OverloadPaths(NodeID source, PathVector &paths, uint accuracy)
+{
+	bool demand_left = false;
+	DemandAnnotationMap &demands = this->job[source].Demands();
+	for (DemandAnnotationMap::iterator it = demands.begin(); it != demands.end(); ++it) {
+		DemandAnnotation &demand = it->second;
+		Path *path = paths[it->first];
+		if (demand.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
+			this->PushFlow(demand, path, accuracy, UINT_MAX);
+			if (demand.UnsatisfiedDemand() > 0) demand_left = true;
+		}
+	}
+	return demand_left;
+}
+
 /**
  * Run the second pass of the MCF calculation which assigns all remaining
  * demands to existing paths.
@@ -656,23 +906,20 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
 	this->max_saturation = UINT_MAX; // disable artificial cap on saturation
-	PathVector paths;
+	PathVectorList paths;
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool demand_left = true;
 	while (demand_left && !job.IsJobAborted()) {
 		demand_left = false;
-		for (NodeID source = 0; source < size; ++source) {
-			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = this->job[source][dest];
-				Path *path = paths[dest];
-				if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(edge, path, accuracy, UINT_MAX);
-					if (edge.UnsatisfiedDemand() > 0) demand_left = true;
-				}
+		for (NodeID first_source = 0; first_source < size;) {
+			uint count = this->FindPaths<CapacityAnnotation, FlowEdgeIterator>(first_source, paths);
+			for (uint i = 0; i < count; ++i) {
+				NodeID source = first_source + i;
+				if (this->OverloadPaths(source, paths[i], accuracy)) demand_left = true;
+				this->CleanupPaths(source, paths[i]);
 			}
-			this->CleanupPaths(source, paths);
+			first_source += count;
 		}
 	}
 }
@@ -721,3 +968,85 @@ bool DistanceAnnotation::Comparator::operator()(const AnnoSetItem<DistanceAnnota
 	return x.anno_ptr != y.anno_ptr && !Greater<uint>(x.cached_annotation, y.cached_annotation,
 			x.node_id, y.node_id);
 }
+
+/**
+ * Path search on a copy of a link graph, with the same parameters as in the
+ * first pass of the MCF, for comparing the Dijkstra priority queues.
+ */
+class MCFBenchmark : public MultiCommodityFlow {
+public:
+	MCFBenchmark(LinkGraphJob &job) : MultiCommodityFlow(job) {}
+
+	/**
+	 * Calculate the path trees from all nodes.
+	 * @param iterations How often to repeat the calculation.
+	 * @param[out] parents Parent node of each node in each tree of the first iteration.
+	 * @return Time taken, in microseconds.
+	 */
+	template<class Tannotation, class Tqueue>
+	uint64 Run(uint iterations, std::vector<NodeID> &parents)
+	{
+		PathVector paths;
+		uint size = this->job.Size();
+		parents.clear();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < iterations; ++i) {
+			for (NodeID source = 0; source < size; ++source) {
+				this->AllocatePaths<Tannotation>(paths);
+				this->Dijkstra<Tannotation, GraphEdgeIterator, Tqueue>(source, paths);
+				for (Path *path : paths) {
+					if (i == 0) parents.push_back(path->GetParent() != NULL ? path->GetParent()->GetNode() : INVALID_NODE);
+					this->job.path_allocator.Free(path);
+				}
+				paths.clear();
+			}
+		}
+		uint64 time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		this->job.path_allocator.ResetArena();
+		return time;
+	}
+};
+
+/**
+ * Compare the std::set based and the heap based Dijkstra priority queues on
+ * all link graphs of the current game and print the results to the console.
+ * @param iterations How often to repeat the calculation for each link graph.
+ */
+void BenchmarkMCFDijkstra(uint iterations)
+{
+	uint64 total_set = 0;
+	uint64 total_heap = 0;
+	uint graphs = 0;
+
+	const LinkGraph *lg;
+	FOR_ALL_LINK_GRAPHS(lg) {
+		if (lg->Size() < 2) continue;
+		if (!LinkGraphJob::CanAllocateItem()) {
+			IConsolePrint(CC_ERROR, "Can't create any more link graph jobs.");
+			break;
+		}
+
+		LinkGraphJob *job = new LinkGraphJob(*lg, 1);
+		job->Init();
+		std::vector<NodeID> set_parents;
+		std::vector<NodeID> heap_parents;
+		MCFBenchmark bench(*job);
+
+		uint64 dist_set = bench.Run<DistanceAnnotation, AnnoSetQueue<DistanceAnnotation> >(iterations, set_parents);
+		uint64 dist_heap = bench.Run<DistanceAnnotation, AnnoHeap<DistanceAnnotation> >(iterations, heap_parents);
+		bool same = set_parents == heap_parents;
+		uint64 cap_set = bench.Run<CapacityAnnotation, AnnoSetQueue<CapacityAnnotation> >(iterations, set_parents);
+		uint64 cap_heap = bench.Run<CapacityAnnotation, AnnoHeap<CapacityAnnotation> >(iterations, heap_parents);
+		same = same && set_parents == heap_parents;
+
+		IConsolePrintF(same ? CC_DEFAULT : CC_ERROR, "Link graph %u (%u nodes): distance: set " OTTD_PRINTF64U " us, heap " OTTD_PRINTF64U " us; capacity: set " OTTD_PRINTF64U " us, heap " OTTD_PRINTF64U " us%s",
+				lg->index, lg->Size(), dist_set, dist_heap, cap_set, cap_heap, same ? "" : "; results differ");
+
+		total_set += dist_set + cap_set;
+		total_heap += dist_heap + cap_heap;
+		graphs++;
+		delete job;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "%u link graphs, %u iterations: set " OTTD_PRINTF64U " us, heap " OTTD_PRINTF64U " us", graphs, iterations, total_set, total_heap);
+}
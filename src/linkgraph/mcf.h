@@ -7,6 +7,7 @@
 #include <vector>
 
 typedef std::vector<Path *> PathVector;
+typedef std::vector<PathVector> PathVectorList;
 
 /**
  * Multi-commodity flow calculating base class.
@@ -21,10 +22,26 @@ protected:
 			max_saturation(job.Settings().short_path_saturation)
 	{}
 
-	template<class Tannotation, class Tedge_iterator>
+	/**
+	 * Number of sources whose path trees are calculated together in parallel
+	 * mode. This must not depend on the number of threads as it affects the
+	 * result.
+	 */
+	static const uint PARALLEL_BATCH_SIZE = 64;
+
+	template<class Tannotation>
+	void AllocatePaths(PathVector &paths);
+
+	template<class Tannotation, class Tedge_iterator, class Tqueue>
 	void Dijkstra(NodeID from, PathVector &paths);
 
-	uint PushFlow(Edge &edge, Path *path, uint accuracy, uint max_saturation);
+	template<class Tannotation, class Tedge_iterator>
+	static void RunDijkstra(void *task);
+
+	template<class Tannotation, class Tedge_iterator>
+	uint FindPaths(NodeID first_source, PathVectorList &paths);
+
+	uint PushFlow(DemandAnnotation &demand, Path *path, uint accuracy, uint max_saturation);
 
 	void CleanupPaths(NodeID source, PathVector &paths);
 
@@ -49,6 +66,7 @@ protected:
  */
 class MCF1stPass : public MultiCommodityFlow {
 private:
+	bool SaturatePaths(NodeID source, PathVector &paths, uint accuracy);
 	bool EliminateCycles();
 	bool EliminateCycles(PathVector &path, NodeID origin_id, NodeID next_id);
 	void EliminateCycle(PathVector &path, Path *cycle_begin, uint flow);
@@ -65,6 +83,8 @@ public:
  * pass this pass is cheaper. The accuracy is used here, too.
  */
 class MCF2ndPass : public MultiCommodityFlow {
+private:
+	bool OverloadPaths(NodeID source, PathVector &paths, uint accuracy);
 public:
 	MCF2ndPass(LinkGraphJob &job);
 };
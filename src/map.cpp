@@ -14,6 +14,7 @@
 #include "core/alloc_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
+#include "pathfinder/water_regions.h"
 
 #include "safeguards.h"
 
@@ -78,6 +79,8 @@ void AllocateMap(uint size_x, uint size_y)
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+
+	AllocateWaterRegions();
 }
 
 
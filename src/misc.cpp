@@ -65,6 +65,7 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	AllocateMap(size_x, size_y);
 
 	ViewportMapClearTunnelCache();
+	ViewportMapClearColourCache();
 	ClearCommandLog();
 
 	_pause_mode = PM_UNPAUSED;
@@ -19,8 +19,72 @@
 
 #include "packet.h"
 
+#include <vector>
+
 #include "../../safeguards.h"
 
+/** Sizes of the packet buffers. Most packets we send fit in the smallest one. */
+static const PacketSize PACKET_BUFFER_SIZES[] = { 64, 256, SEND_MTU, SHRT_MAX };
+/** Maximum number of unused buffers kept per size class and thread. */
+static const uint PACKET_BUFFER_POOL_SIZES[] = { 256, 256, 128, 4 };
+assert_compile(lengthof(PACKET_BUFFER_SIZES) == lengthof(PACKET_BUFFER_POOL_SIZES));
+
+/** Whether the packet buffer pool of this thread has been destroyed, e.g. when packets are freed during exit. */
+static thread_local bool _packet_buffer_pool_destroyed = false;
+
+/**
+ * Unused packet buffers, so creating and sending packets doesn't need to go to
+ * the heap every time. Each thread has its own pool, so no locking is needed;
+ * a buffer freed by another thread than the one allocating it just moves over.
+ */
+struct PacketBufferPool {
+	std::vector<byte *> free[lengthof(PACKET_BUFFER_SIZES)]; ///< Unused buffers per size class.
+
+	~PacketBufferPool()
+	{
+		for (uint i = 0; i < lengthof(this->free); i++) {
+			for (byte *buffer : this->free[i]) ::free(buffer);
+		}
+		_packet_buffer_pool_destroyed = true;
+	}
+
+	/**
+	 * Get a buffer.
+	 * @param bytes Minimum size of the buffer.
+	 * @param capacity [out] The size of the buffer.
+	 * @return The buffer.
+	 */
+	byte *Allocate(size_t bytes, PacketSize &capacity)
+	{
+		uint i = 0;
+		while (PACKET_BUFFER_SIZES[i] < bytes) i++;
+		capacity = PACKET_BUFFER_SIZES[i];
+		if (_packet_buffer_pool_destroyed || this->free[i].empty()) return MallocT<byte>(capacity);
+
+		byte *buffer = this->free[i].back();
+		this->free[i].pop_back();
+		return buffer;
+	}
+
+	/**
+	 * Return a buffer to the pool.
+	 * @param buffer The buffer.
+	 * @param capacity The size of the buffer.
+	 */
+	void Free(byte *buffer, PacketSize capacity)
+	{
+		uint i = 0;
+		while (PACKET_BUFFER_SIZES[i] != capacity) i++;
+		if (!_packet_buffer_pool_destroyed && this->free[i].size() < PACKET_BUFFER_POOL_SIZES[i]) {
+			this->free[i].push_back(buffer);
+		} else {
+			::free(buffer);
+		}
+	}
+};
+
+static thread_local PacketBufferPool _packet_buffer_pool;
+
 /**
  * Create a packet that is used to read from a network socket
  * @param cs the socket handler associated with the socket we are reading from
@@ -33,7 +97,8 @@ Packet::Packet(NetworkSocketHandler *cs)
 	this->next   = NULL;
 	this->pos    = 0; // We start reading from here
 	this->size   = 0;
-	this->buffer = MallocT<byte>(SHRT_MAX);
+	/* Received packets are never larger than SEND_MTU. */
+	this->buffer = _packet_buffer_pool.Allocate(SEND_MTU, this->capacity);
 }
 
 /**
@@ -48,7 +113,7 @@ Packet::Packet(PacketType type)
 	/* Skip the size so we can write that in before sending the packet */
 	this->pos                  = 0;
 	this->size                 = sizeof(PacketSize);
-	this->buffer               = MallocT<byte>(SHRT_MAX);
+	this->buffer               = _packet_buffer_pool.Allocate(this->size + sizeof(type), this->capacity);
 	this->buffer[this->size++] = type;
 }
 
@@ -57,7 +122,24 @@ Packet::Packet(PacketType type)
  */
 Packet::~Packet()
 {
-	free(this->buffer);
+	_packet_buffer_pool.Free(this->buffer, this->capacity);
+}
+
+/**
+ * Make sure there is room for writing some more bytes to the packet,
+ * moving it to a larger buffer if needed.
+ * @param bytes The number of bytes to be written.
+ */
+void Packet::Reserve(size_t bytes)
+{
+	assert(this->size + bytes <= SHRT_MAX);
+	if (this->size + bytes <= this->capacity) return;
+
+	PacketSize old_capacity = this->capacity;
+	byte *buffer = _packet_buffer_pool.Allocate(this->size + bytes, this->capacity);
+	memcpy(buffer, this->buffer, this->size);
+	_packet_buffer_pool.Free(this->buffer, old_capacity);
+	this->buffer = buffer;
 }
 
 /**
@@ -101,6 +183,7 @@ void Packet::Send_bool(bool data)
 void Packet::Send_uint8(uint8 data)
 {
 	assert(this->size < SHRT_MAX - sizeof(data));
+	this->Reserve(sizeof(data));
 	this->buffer[this->size++] = data;
 }
 
@@ -111,6 +194,7 @@ void Packet::Send_uint8(uint8 data)
 void Packet::Send_uint16(uint16 data)
 {
 	assert(this->size < SHRT_MAX - sizeof(data));
+	this->Reserve(sizeof(data));
 	this->buffer[this->size++] = GB(data, 0, 8);
 	this->buffer[this->size++] = GB(data, 8, 8);
 }
@@ -122,6 +206,7 @@ void Packet::Send_uint16(uint16 data)
 void Packet::Send_uint32(uint32 data)
 {
 	assert(this->size < SHRT_MAX - sizeof(data));
+	this->Reserve(sizeof(data));
 	this->buffer[this->size++] = GB(data,  0, 8);
 	this->buffer[this->size++] = GB(data,  8, 8);
 	this->buffer[this->size++] = GB(data, 16, 8);
@@ -135,6 +220,7 @@ void Packet::Send_uint32(uint32 data)
 void Packet::Send_uint64(uint64 data)
 {
 	assert(this->size < SHRT_MAX - sizeof(data));
+	this->Reserve(sizeof(data));
 	this->buffer[this->size++] = GB(data,  0, 8);
 	this->buffer[this->size++] = GB(data,  8, 8);
 	this->buffer[this->size++] = GB(data, 16, 8);
@@ -155,6 +241,7 @@ void Packet::Send_string(const char *data)
 	assert(data != NULL);
 	/* The <= *is* valid due to the fact that we are comparing sizes and not the index. */
 	assert(this->size + strlen(data) + 1 <= SHRT_MAX);
+	this->Reserve(strlen(data) + 1);
 	while ((this->buffer[this->size++] = *data++) != '\0') {}
 }
 
@@ -166,6 +253,7 @@ void Packet::Send_binary(const char *data, const size_t size)
 {
 	assert(data != NULL);
 	assert(size < MAX_CMD_TEXT_LENGTH);
+	this->Reserve(size);
 	memcpy(&this->buffer[this->size], data, size);
 	this->size += (PacketSize) size;
 }
@@ -58,6 +58,10 @@ struct Packet {
 private:
 	/** Socket we're associated with. */
 	NetworkSocketHandler *cs;
+	/** The allocated size of the buffer, one of the size classes of the buffer pool. */
+	PacketSize capacity;
+
+	void Reserve(size_t bytes);
 
 public:
 	Packet(NetworkSocketHandler *cs);
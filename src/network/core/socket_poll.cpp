@@ -0,0 +1,103 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file socket_poll.cpp Readiness notification for many sockets at once.
+ */
+
+#ifdef ENABLE_NETWORK
+
+#include "../../stdafx.h"
+#include "../../debug.h"
+
+#include "socket_poll.h"
+
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+
+#include <sys/epoll.h>
+#include <vector>
+
+#include "../../safeguards.h"
+
+/** Buffer for the events returned by epoll_wait. */
+static std::vector<struct epoll_event> _epoll_events;
+
+/**
+ * Create the epoll instance.
+ * @return True if the poller can be used.
+ */
+bool SocketPoller::Open()
+{
+	this->Close();
+	this->fd = epoll_create1(EPOLL_CLOEXEC);
+	if (this->fd == -1) DEBUG(net, 0, "epoll_create1 failed with error %d, falling back to select()", errno);
+	return this->IsOpen();
+}
+
+/** Close the epoll instance. */
+void SocketPoller::Close()
+{
+	if (this->fd == -1) return;
+	close(this->fd);
+	this->fd = -1;
+}
+
+/**
+ * Register a socket, or change the events it is watched for.
+ * The poller is level triggered, i.e. a socket is reported for as long as it is ready.
+ * @param s The socket.
+ * @param key Key to report the socket with.
+ * @param events The SocketPollEvents to watch for.
+ * @param registered Whether the socket has been registered before.
+ * @return True if the socket is watched.
+ */
+bool SocketPoller::Watch(SOCKET s, uint64 key, uint32 events, bool registered)
+{
+	struct epoll_event ev;
+	ev.events = 0;
+	if ((events & SPE_READ) != 0) ev.events |= EPOLLIN;
+	if ((events & SPE_WRITE) != 0) ev.events |= EPOLLOUT;
+	ev.data.u64 = key;
+	if (epoll_ctl(this->fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, s, &ev) == 0) return true;
+
+	/* The socket may have been registered with an earlier instance, or its descriptor reused. */
+	if (errno == (registered ? ENOENT : EEXIST) && epoll_ctl(this->fd, registered ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, s, &ev) == 0) return true;
+
+	DEBUG(net, 0, "epoll_ctl failed with error %d", errno);
+	return false;
+}
+
+/**
+ * Get the sockets which are ready, without blocking.
+ * @param events [out] The ready sockets.
+ * @param max_events Maximum number of sockets to report; pass the number of registered sockets to get all ready ones.
+ * @return The number of ready sockets, or -1 on error.
+ */
+int SocketPoller::Wait(SocketPollEvent *events, int max_events)
+{
+	if (max_events <= 0) return 0;
+	if (_epoll_events.size() < (size_t)max_events) _epoll_events.resize(max_events);
+
+	int n;
+	do {
+		n = epoll_wait(this->fd, _epoll_events.data(), max_events, 0);
+	} while (n < 0 && errno == EINTR);
+
+	for (int i = 0; i < n; i++) {
+		const struct epoll_event &ev = _epoll_events[i];
+		events[i].key = ev.data.u64;
+		/* Errors and hang-ups are noticed when reading. */
+		events[i].events = ((ev.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0 ? SPE_READ : 0) | ((ev.events & EPOLLOUT) != 0 ? SPE_WRITE : 0);
+	}
+	return n;
+}
+
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
+
+#endif /* ENABLE_NETWORK */
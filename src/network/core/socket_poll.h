@@ -0,0 +1,70 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file socket_poll.h Readiness notification for many sockets at once.
+ */
+
+#ifndef NETWORK_CORE_SOCKET_POLL_H
+#define NETWORK_CORE_SOCKET_POLL_H
+
+#include "os_abstraction.h"
+
+#ifdef ENABLE_NETWORK
+
+#if defined(__linux__)
+/** The socket poller is backed by epoll; elsewhere select() is used on all sockets instead. */
+#	define NETWORK_HAVE_SOCKET_POLLER
+#endif
+
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+
+/** Events a socket can be watched for. */
+enum SocketPollEvents {
+	SPE_NONE  = 0,      ///< Not watched.
+	SPE_READ  = 1 << 0, ///< Data can be read, a connection can be accepted, or the connection was closed or failed.
+	SPE_WRITE = 1 << 1, ///< Data can be written.
+};
+
+/** A ready socket, as reported by SocketPoller::Wait. */
+struct SocketPollEvent {
+	uint64 key;    ///< Key the socket was registered with.
+	uint32 events; ///< The SocketPollEvents the socket is ready for.
+};
+
+/**
+ * Watches a set of sockets and reports only those which are ready, so
+ * the cost of servicing them doesn't depend on the number of idle sockets.
+ * Sockets are unregistered automatically when they are closed.
+ */
+class SocketPoller {
+	int fd; ///< The epoll instance, -1 when not open.
+
+public:
+	SocketPoller() : fd(-1) {}
+	~SocketPoller() { this->Close(); }
+
+	bool Open();
+	void Close();
+
+	/**
+	 * Whether the poller is ready for use.
+	 * @return True if it has been opened successfully.
+	 */
+	bool IsOpen() const { return this->fd != -1; }
+
+	bool Watch(SOCKET s, uint64 key, uint32 events, bool registered);
+	int Wait(SocketPollEvent *events, int max_events);
+};
+
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
+
+#endif /* ENABLE_NETWORK */
+
+#endif /* NETWORK_CORE_SOCKET_POLL_H */
@@ -18,16 +18,28 @@
 
 #include "tcp.h"
 
+#if defined(UNIX) && !defined(__OS2__)
+#	include <sys/uio.h>
+#	include <limits.h>
+#endif
+
 #include "../../safeguards.h"
 
+/** Maximum number of packets handed to the OS at once. */
+#if defined(IOV_MAX) && IOV_MAX < 64
+static const uint SEND_BATCH_PACKETS = IOV_MAX;
+#else
+static const uint SEND_BATCH_PACKETS = 64;
+#endif
+
 /**
  * Construct a socket handler for a TCP connection.
  * @param s The just opened TCP connection.
  */
 NetworkTCPSocketHandler::NetworkTCPSocketHandler(SOCKET s) :
 		NetworkSocketHandler(),
-		packet_queue(NULL), packet_recv(NULL),
-		sock(s), writable(false)
+		packet_queue(NULL), packet_queue_tail(NULL), packet_recv(NULL),
+		sock(s), writable(false), poll_events(0)
 {
 }
 
@@ -50,6 +62,7 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
 		delete this->packet_queue;
 		this->packet_queue = p;
 	}
+	this->packet_queue_tail = NULL;
 	delete this->packet_recv;
 	this->packet_recv = NULL;
 
@@ -64,26 +77,50 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
  */
 void NetworkTCPSocketHandler::SendPacket(Packet *packet)
 {
-	Packet *p;
 	assert(packet != NULL);
 
+	/* The buffer of the packet is already the smallest size class it fits in,
+	 * so there is no need to shrink it before queueing. */
 	packet->PrepareToSend();
 
-	/* Reallocate the packet as in 99+% of the times we send at most 25 bytes and
-	 * keeping the other 1400+ bytes wastes memory, especially when someone tries
-	 * to do a denial of service attack! */
-	packet->buffer = ReallocT(packet->buffer, packet->size);
-
-	/* Locate last packet buffered for the client */
-	p = this->packet_queue;
-	if (p == NULL) {
+	if (this->packet_queue == NULL) {
 		/* No packets yet */
 		this->packet_queue = packet;
 	} else {
-		/* Skip to the last packet */
-		while (p->next != NULL) p = p->next;
-		p->next = packet;
+		this->packet_queue_tail->next = packet;
+	}
+	this->packet_queue_tail = packet;
+}
+
+/**
+ * Send the data of the first packets in the queue with a single system call.
+ * @param sock The socket to send to.
+ * @param p The first packet to send.
+ * @return The number of bytes sent, or -1 on error.
+ */
+static ssize_t SendPacketBatch(SOCKET sock, Packet *p)
+{
+#if defined(UNIX) && !defined(__OS2__)
+	struct iovec iov[SEND_BATCH_PACKETS];
+	int count = 0;
+	for (; p != NULL && count < (int)SEND_BATCH_PACKETS; p = p->next, count++) {
+		iov[count].iov_base = p->buffer + p->pos;
+		iov[count].iov_len = p->size - p->pos;
 	}
+	return writev(sock, iov, count);
+#elif defined(WIN32)
+	WSABUF bufs[SEND_BATCH_PACKETS];
+	DWORD count = 0;
+	for (; p != NULL && count < SEND_BATCH_PACKETS; p = p->next, count++) {
+		bufs[count].buf = (CHAR *)p->buffer + p->pos;
+		bufs[count].len = p->size - p->pos;
+	}
+	DWORD sent;
+	if (WSASend(sock, bufs, count, &sent, 0, NULL, NULL) != 0) return -1;
+	return sent;
+#else
+	return send(sock, (const char*)p->buffer + p->pos, p->size - p->pos, 0);
+#endif
 }
 
 /**
@@ -107,7 +144,7 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 
 	p = this->packet_queue;
 	while (p != NULL) {
-		res = send(this->sock, (const char*)p->buffer + p->pos, p->size - p->pos, 0);
+		res = SendPacketBatch(this->sock, p);
 		if (res == -1) {
 			int err = GET_LAST_ERROR();
 			if (err != EWOULDBLOCK) {
@@ -118,6 +155,8 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 				}
 				return SPS_CLOSED;
 			}
+			/* Wait until the socket is reported writable again. */
+			this->writable = false;
 			return SPS_PARTLY_SENT;
 		}
 		if (res == 0) {
@@ -126,19 +165,23 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 			return SPS_CLOSED;
 		}
 
-		p->pos += res;
-
-		/* Is this packet sent? */
-		if (p->pos == p->size) {
-			/* Go to the next packet */
+		/* Drop the packets which are sent completely. */
+		while (res >= p->size - p->pos) {
+			res -= p->size - p->pos;
 			this->packet_queue = p->next;
 			delete p;
 			p = this->packet_queue;
-		} else {
+			if (p == NULL) break;
+		}
+
+		if (res > 0) {
+			/* The OS buffer is full in the middle of this packet. */
+			p->pos += res;
 			return SPS_PARTLY_SENT;
 		}
 	}
 
+	this->packet_queue_tail = NULL;
 	return SPS_ALL_SENT;
 }
 
@@ -31,10 +31,12 @@ enum SendPacketsState {
 class NetworkTCPSocketHandler : public NetworkSocketHandler {
 private:
 	Packet *packet_queue;     ///< Packets that are awaiting delivery
+	Packet *packet_queue_tail; ///< Last packet of #packet_queue, for appending to it
 	Packet *packet_recv;      ///< Partially received packet
 public:
 	SOCKET sock;              ///< The socket currently connected to
 	bool writable;            ///< Can we write to this socket?
+	uint32 poll_events;       ///< Events the socket is watched for by the socket poller of its listener, 0 when not watched
 
 	/**
 	 * Whether this socket is currently bound to a socket.
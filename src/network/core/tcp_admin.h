@@ -63,6 +63,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_STATS_DELTA,     ///< The server sends the changes in the game statistics to the admin.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -86,6 +87,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_STATS_DELTA,     ///< The admin would like to have delta encoded statistics of the game.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -110,6 +112,25 @@ enum AdminCompanyRemoveReason {
 	ADMIN_CRR_END,       ///< Sentinel for end.
 };
 
+/** Tables of the statistics sent with #ADMIN_PACKET_SERVER_STATS_DELTA. */
+enum AdminStatsTable {
+	ADMIN_STATS_COMPANY,         ///< Key: company ID. Fields: money, loan, income and expenses of this quarter.
+	ADMIN_STATS_STATION_CARGO,   ///< Key: station ID << 8 | cargo ID. Fields: cargo waiting, rating.
+	ADMIN_STATS_VEHICLE,         ///< Key: vehicle ID. Fields: owner, vehicle type, profit this year, profit last year.
+	ADMIN_STATS_LINK,            ///< Key: cargo ID << 32 | from station ID << 16 | to station ID. Fields: capacity, usage.
+
+	ADMIN_STATS_TABLE_END,       ///< Sentinel for end.
+};
+
+/** Flags of an #ADMIN_PACKET_SERVER_STATS_DELTA packet. */
+enum AdminStatsFlags {
+	ADMIN_STATS_FLAG_FULL = 0x01, ///< The records are a full snapshot; forget all previously received state first.
+	ADMIN_STATS_FLAG_LAST = 0x02, ///< This is the last packet of this snapshot.
+};
+
+/** Version of the format of #ADMIN_PACKET_SERVER_STATS_DELTA packets. */
+static const uint8 ADMIN_STATS_FORMAT_VERSION = 1;
+
 /** Main socket handler for admin related connections. */
 class NetworkAdminSocketHandler : public NetworkTCPSocketHandler {
 protected:
@@ -481,6 +502,27 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Send the changes in the game statistics since the previous snapshot.
+	 * A snapshot may be spread over several packets; only records are split.
+	 * uint8   Format version, see #ADMIN_STATS_FORMAT_VERSION.
+	 * uint32  Sequence number of the snapshot, increasing by one for every snapshot.
+	 * uint8   Flags, see #AdminStatsFlags.
+	 * Then records until the end of the packet:
+	 * uint8   Table (see #AdminStatsTable), with bit 7 set when the record is removed.
+	 * varint  Key of the record within the table.
+	 * Only when the record is not removed:
+	 * uint8   Bit mask of the fields which changed.
+	 * zvarint For every set bit, the difference of the field to its previous value (0 for new records).
+	 *
+	 * A varint is an unsigned integer stored in groups of 7 bits, least significant
+	 * group first, with bit 7 set on every byte but the last. A zvarint is a
+	 * signed integer stored as varint after zigzag encoding, i.e. (n << 1) ^ (n >> 63).
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_STATS_DELTA(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true);
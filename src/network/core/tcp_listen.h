@@ -15,10 +15,12 @@
 #define NETWORK_CORE_TCP_LISTEN_H
 
 #include "tcp.h"
+#include "socket_poll.h"
 #include "../network.h"
 #include "../../core/pool_type.hpp"
 #include "../../debug.h"
 #include "table/strings.h"
+#include <vector>
 
 #ifdef ENABLE_NETWORK
 
@@ -33,6 +35,59 @@ class TCPListenHandler {
 	/** List of sockets we listen on. */
 	static SocketList sockets;
 
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+	/** Poller for the listening sockets and the sockets of the clients. */
+	static SocketPoller poller;
+
+	/** Key of the listening sockets in the poller; clients use their pool index in the upper half. */
+	static const uint64 LISTENER_POLL_KEY = (uint64)UINT32_MAX << 32;
+
+	/**
+	 * Handle the receiving of packets for the sockets reported ready by the poller.
+	 * Sockets stay writable until sending would block, after which the
+	 * poller is asked to report when they can be written to again.
+	 * @return true if everything went okay.
+	 */
+	static bool ReceivePolled()
+	{
+		uint watched = sockets.Length();
+
+		Tsocket *cs;
+		FOR_ALL_ITEMS_FROM(Tsocket, idx, cs, 0) {
+			if (!cs->IsConnected()) continue;
+			watched++;
+
+			uint32 events = cs->writable ? SPE_READ : SPE_READ | SPE_WRITE;
+			if (events == cs->poll_events) continue;
+
+			uint64 key = (uint64)cs->index << 32 | (uint32)cs->sock;
+			if (poller.Watch(cs->sock, key, events, cs->poll_events != 0)) cs->poll_events = events;
+		}
+
+		static std::vector<SocketPollEvent> ready;
+		if (ready.size() < watched) ready.resize(watched);
+		int n = poller.Wait(ready.data(), watched);
+		if (n < 0) return false;
+
+		for (int i = 0; i < n; i++) {
+			uint64 key = ready[i].key;
+			if ((key & LISTENER_POLL_KEY) == LISTENER_POLL_KEY) {
+				/* accept clients.. */
+				AcceptClient((SOCKET)(uint32)key);
+				continue;
+			}
+
+			/* The client may have gone, and its slot reused, while handling the others. */
+			cs = Tsocket::GetIfValid((size_t)(key >> 32));
+			if (cs == NULL || !cs->IsConnected() || (uint32)cs->sock != (uint32)key) continue;
+
+			if ((ready[i].events & SPE_WRITE) != 0) cs->writable = true;
+			if ((ready[i].events & SPE_READ) != 0) cs->ReceivePackets();
+		}
+		return _networking;
+	}
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
+
 public:
 	/**
 	 * Accepts clients from the sockets.
@@ -99,6 +154,10 @@ public:
 	 */
 	static bool Receive()
 	{
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+		if (poller.IsOpen()) return ReceivePolled();
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
+
 		fd_set read_fd, write_fd;
 		struct timeval tv;
 
@@ -161,6 +220,17 @@ public:
 			return false;
 		}
 
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+		if (poller.Open()) {
+			for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
+				if (!poller.Watch(s->second, LISTENER_POLL_KEY | (uint32)s->second, SPE_READ, false)) {
+					poller.Close();
+					break;
+				}
+			}
+		}
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
+
 		return true;
 	}
 
@@ -171,11 +241,17 @@ public:
 			closesocket(s->second);
 		}
 		sockets.Clear();
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+		poller.Close();
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
 		DEBUG(net, 1, "[%s] closed listeners", Tsocket::GetName());
 	}
 };
 
 template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> SocketList TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::sockets;
+#ifdef NETWORK_HAVE_SOCKET_POLLER
+template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> SocketPoller TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::poller;
+#endif /* NETWORK_HAVE_SOCKET_POLLER */
 
 #endif /* ENABLE_NETWORK */
 
@@ -23,6 +23,7 @@
 #include "network_udp.h"
 #include "network_gamelist.h"
 #include "network_base.h"
+#include "network_sync_hash.h"
 #include "core/udp.h"
 #include "core/host.h"
 #include "network_gui.h"
@@ -562,6 +563,7 @@ void NetworkClose(bool close_admins)
 		}
 		ServerNetworkGameSocketHandler::CloseListeners();
 		ServerNetworkAdminSocketHandler::CloseListeners();
+		NetworkAdminStatsReset();
 	} else if (MyClient::my_client != NULL) {
 		MyClient::SendQuit();
 		MyClient::my_client->CloseConnection(NETWORK_RECV_STATUS_CONN_LOST);
@@ -761,6 +763,7 @@ bool NetworkServerStart()
 	_network_server = true;
 	_networking = true;
 	_frame_counter = 0;
+	SyncHashReset();
 	_frame_counter_server = 0;
 	_frame_counter_max = 0;
 	_last_sync_frame = 0;
@@ -1018,7 +1021,9 @@ void NetworkGameLoop()
 		NetworkExecuteLocalCommandQueue();
 
 		/* Then we make the frame */
+		SyncHashBeginFrame();
 		StateGameLoop();
+		SyncHashEndFrame(_frame_counter);
 
 		_sync_seed_1 = _random.state[0];
 #ifdef NETWORK_SEND_DOUBLE_SEED
@@ -1026,6 +1031,7 @@ void NetworkGameLoop()
 #endif
 
 		NetworkServer_Tick(send_frame);
+		NetworkAdminStatsTick();
 	} else {
 		/* Client */
 
@@ -56,6 +56,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_STATS_DELTA
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -69,6 +70,7 @@ ServerNetworkAdminSocketHandler::ServerNetworkAdminSocketHandler(SOCKET s) : Net
 	_network_admins_connected++;
 	this->status = ADMIN_STATUS_INACTIVE;
 	this->realtime_connect = _realtime_tick;
+	this->stats_full_requested = false;
 }
 
 /**
@@ -663,6 +665,28 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdLogging(ClientID clien
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Send a statistics snapshot, split over as many packets as needed.
+ * @param sequence Sequence number of the snapshot.
+ * @param flags Flags of the snapshot (see #AdminStatsFlags), #ADMIN_STATS_FLAG_LAST is added to the last packet.
+ * @param payloads The encoded records of each packet.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendStatsDelta(uint32 sequence, uint8 flags, const std::vector<std::vector<byte> > &payloads)
+{
+	for (size_t i = 0; i < payloads.size(); i++) {
+		Packet *p = new Packet(ADMIN_PACKET_SERVER_STATS_DELTA);
+
+		p->Send_uint8 (ADMIN_STATS_FORMAT_VERSION);
+		p->Send_uint32(sequence);
+		p->Send_uint8 (i + 1 == payloads.size() ? flags | ADMIN_STATS_FLAG_LAST : flags);
+		if (!payloads[i].empty()) p->Send_binary((const char *)payloads[i].data(), payloads[i].size());
+
+		this->SendPacket(p);
+	}
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /***********
  * Receiving functions
  ************/
@@ -715,6 +739,8 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_UPDATE_FREQUENC
 	}
 
 	this->update_frequency[type] = freq;
+	/* Deltas are useless without a full snapshot to apply them to. */
+	if (type == ADMIN_UPDATE_STATS_DELTA && (freq & ADMIN_FREQUENCY_AUTOMATIC) != 0) this->stats_full_requested = true;
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -778,6 +804,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_STATS_DELTA:
+			/* The admin is requesting a full statistics snapshot; it is sent with the next snapshot. */
+			this->stats_full_requested = true;
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
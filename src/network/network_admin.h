@@ -17,6 +17,7 @@
 #include "network_internal.h"
 #include "core/tcp_listen.h"
 #include "core/tcp_admin.h"
+#include <vector>
 
 extern AdminIndex _redirect_console_to_admin;
 
@@ -41,6 +42,7 @@ protected:
 	NetworkRecvStatus SendPong(uint32 d1);
 public:
 	AdminUpdateFrequency update_frequency[ADMIN_UPDATE_END]; ///< Admin requested update intervals.
+	bool stats_full_requested;                               ///< The admin needs a full statistics snapshot before it can use deltas.
 	uint32 realtime_connect;                                 ///< Time of connection.
 	NetworkAddress address;                                  ///< Address of the admin.
 
@@ -72,6 +74,7 @@ public:
 	NetworkRecvStatus SendCmdNames();
 	NetworkRecvStatus SendCmdLogging(ClientID client_id, const CommandPacket *cp);
 	NetworkRecvStatus SendRconEnd(const char *command);
+	NetworkRecvStatus SendStatsDelta(uint32 sequence, uint8 flags, const std::vector<std::vector<byte> > &payloads);
 
 	static void Send();
 	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
@@ -124,5 +127,8 @@ void NetworkAdminConsole(const char *origin, const char *string);
 void NetworkAdminGameScript(const char *json);
 void NetworkAdminCmdLogging(const NetworkClientSocket *owner, const CommandPacket *cp);
 
+void NetworkAdminStatsTick();
+void NetworkAdminStatsReset();
+
 #endif /* ENABLE_NETWORK */
 #endif /* NETWORK_ADMIN_H */
@@ -0,0 +1,386 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file network_admin_stats.cpp Delta encoded statistics stream of the admin network. */
+
+#ifdef ENABLE_NETWORK
+
+#include "../stdafx.h"
+#include "network_admin.h"
+#include "../company_base.h"
+#include "../station_base.h"
+#include "../vehicle_base.h"
+#include "../settings_type.h"
+#include "../linkgraph/linkgraph.h"
+#include "../thread/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "../safeguards.h"
+
+/*
+ * The statistics are gathered in two steps. Every admin_stats_interval ticks
+ * the main thread copies the interesting values of the pools into flat,
+ * sorted tables; that is a single linear pass without any allocations once
+ * the tables have reached their size. Comparing the tables with the previous
+ * ones and encoding the differences is done by a worker thread, after which
+ * the main thread merely wraps the prepared payloads into packets.
+ */
+
+static const uint ADMIN_STATS_MAX_FIELDS = 4; ///< Maximum number of fields of a record.
+/** Maximum number of bytes of an encoded record: table, key, mask and the fields. */
+static const uint ADMIN_STATS_MAX_RECORD_SIZE = 1 + 10 + 1 + ADMIN_STATS_MAX_FIELDS * 10;
+/** Maximum size of a payload: the MTU minus the packet header (3 bytes) and our own header (6 bytes). */
+static const uint ADMIN_STATS_MAX_PAYLOAD_SIZE = SEND_MTU - 3 - 6;
+
+/** Number of fields of the records of each table. */
+static const uint _admin_stats_table_fields[] = {
+	4, ///< ADMIN_STATS_COMPANY
+	2, ///< ADMIN_STATS_STATION_CARGO
+	4, ///< ADMIN_STATS_VEHICLE
+	2, ///< ADMIN_STATS_LINK
+};
+assert_compile(lengthof(_admin_stats_table_fields) == ADMIN_STATS_TABLE_END);
+
+/** A single row of a statistics table. */
+struct AdminStatsRecord {
+	uint64 key;                           ///< Key of the record, unique within its table.
+	int64 fields[ADMIN_STATS_MAX_FIELDS]; ///< Values of the record; unused fields are 0.
+};
+
+/** Copy of the statistics at a given moment; the tables are sorted by key. */
+struct AdminStatsSnapshot {
+	std::vector<AdminStatsRecord> tables[ADMIN_STATS_TABLE_END]; ///< The rows of each table.
+
+	void Clear()
+	{
+		for (uint i = 0; i < ADMIN_STATS_TABLE_END; i++) this->tables[i].clear();
+	}
+};
+
+/** Payloads of the packets of one snapshot. */
+typedef std::vector<std::vector<byte> > AdminStatsPayloads;
+
+/** State of the statistics stream. Everything but #job_done is owned by the worker while #job_running. */
+struct AdminStatsState {
+	AdminStatsSnapshot current;   ///< Snapshot being encoded.
+	AdminStatsSnapshot previous;  ///< Snapshot the previous delta was made against.
+	bool has_previous;            ///< Whether #previous is a snapshot admins have seen.
+	bool build_full;              ///< Whether the job should make a full snapshot as well.
+	bool delta_is_full;           ///< Whether the delta was made against nothing, i.e. it is a full snapshot.
+	AdminStatsPayloads delta;     ///< Encoded differences between #previous and #current.
+	AdminStatsPayloads full;      ///< Encoded full #current snapshot, only when #build_full.
+
+	uint32 sequence;              ///< Sequence number of the snapshot being encoded.
+	uint16 ticks;                 ///< Ticks since the last snapshot was taken.
+	bool job_running;             ///< Whether a job has been submitted and not been collected.
+	std::atomic<bool> job_done;   ///< Set by the worker when the job has finished.
+
+	AdminStatsState() : has_previous(false), build_full(false), delta_is_full(false), sequence(0), ticks(0), job_running(false), job_done(false) {}
+};
+
+static AdminStatsState _admin_stats;
+static WorkerTaskGroup _admin_stats_group;
+
+/**
+ * Append a variable length unsigned integer.
+ * @param buf Buffer to append to.
+ * @param value Value to append.
+ */
+static inline void AppendVarUint(std::vector<byte> &buf, uint64 value)
+{
+	while (value >= 0x80) {
+		buf.push_back((byte)(value | 0x80));
+		value >>= 7;
+	}
+	buf.push_back((byte)value);
+}
+
+/**
+ * Append a zigzag encoded variable length signed integer.
+ * @param buf Buffer to append to.
+ * @param value Value to append.
+ */
+static inline void AppendVarInt(std::vector<byte> &buf, int64 value)
+{
+	AppendVarUint(buf, ((uint64)value << 1) ^ (uint64)(value >> 63));
+}
+
+/** Encoder of records which splits them over payloads that fit in a packet. */
+struct AdminStatsEncoder {
+	AdminStatsPayloads &payloads; ///< Payloads being filled.
+
+	AdminStatsEncoder(AdminStatsPayloads &payloads) : payloads(payloads)
+	{
+		this->payloads.clear();
+		this->payloads.emplace_back();
+	}
+
+	/**
+	 * Get the payload with room for another record.
+	 * @return The payload.
+	 */
+	std::vector<byte> &Reserve()
+	{
+		if (this->payloads.back().size() + ADMIN_STATS_MAX_RECORD_SIZE > ADMIN_STATS_MAX_PAYLOAD_SIZE) this->payloads.emplace_back();
+		return this->payloads.back();
+	}
+
+	/**
+	 * Encode the removal of a record.
+	 * @param table Table of the record.
+	 * @param key Key of the record.
+	 */
+	void Remove(uint table, uint64 key)
+	{
+		std::vector<byte> &buf = this->Reserve();
+		buf.push_back((byte)(table | 0x80));
+		AppendVarUint(buf, key);
+	}
+
+	/**
+	 * Encode the changes of a record, if any.
+	 * @param table Table of the record.
+	 * @param from Previous state of the record, or NULL if it is new.
+	 * @param to Current state of the record.
+	 */
+	void Update(uint table, const AdminStatsRecord *from, const AdminStatsRecord &to)
+	{
+		uint8 mask = 0;
+		for (uint i = 0; i < _admin_stats_table_fields[table]; i++) {
+			if (to.fields[i] != (from != NULL ? from->fields[i] : 0)) SetBit(mask, i);
+		}
+		/* New records are always sent, unchanged ones never. */
+		if (mask == 0 && from != NULL) return;
+
+		std::vector<byte> &buf = this->Reserve();
+		buf.push_back((byte)table);
+		AppendVarUint(buf, to.key);
+		buf.push_back(mask);
+		uint i;
+		FOR_EACH_SET_BIT(i, mask) {
+			AppendVarInt(buf, to.fields[i] - (from != NULL ? from->fields[i] : 0));
+		}
+	}
+};
+
+/**
+ * Encode the differences between two snapshots.
+ * @param from Previous snapshot, or NULL to encode the full snapshot.
+ * @param to Current snapshot.
+ * @param payloads Destination of the encoded records.
+ */
+static void EncodeAdminStats(const AdminStatsSnapshot *from, const AdminStatsSnapshot &to, AdminStatsPayloads &payloads)
+{
+	AdminStatsEncoder encoder(payloads);
+	static const std::vector<AdminStatsRecord> empty;
+
+	for (uint table = 0; table < ADMIN_STATS_TABLE_END; table++) {
+		const std::vector<AdminStatsRecord> &old_rows = from != NULL ? from->tables[table] : empty;
+		const std::vector<AdminStatsRecord> &new_rows = to.tables[table];
+
+		/* Both tables are sorted, so merge them. */
+		std::vector<AdminStatsRecord>::const_iterator o = old_rows.begin();
+		std::vector<AdminStatsRecord>::const_iterator n = new_rows.begin();
+		while (o != old_rows.end() || n != new_rows.end()) {
+			if (n == new_rows.end() || (o != old_rows.end() && o->key < n->key)) {
+				encoder.Remove(table, o->key);
+				++o;
+			} else if (o == old_rows.end() || n->key < o->key) {
+				encoder.Update(table, NULL, *n);
+				++n;
+			} else {
+				encoder.Update(table, &*o, *n);
+				++o;
+				++n;
+			}
+		}
+	}
+}
+
+/**
+ * Encode the snapshot that was taken; runs on a worker thread.
+ * @param param Unused.
+ */
+static void AdminStatsJob(void *param)
+{
+	AdminStatsState &s = _admin_stats;
+
+	s.delta_is_full = !s.has_previous;
+	EncodeAdminStats(s.has_previous ? &s.previous : NULL, s.current, s.delta);
+	if (s.build_full && !s.delta_is_full) {
+		EncodeAdminStats(NULL, s.current, s.full);
+	} else {
+		s.full.clear();
+	}
+
+	std::swap(s.previous, s.current);
+	s.has_previous = true;
+
+	s.job_done.store(true, std::memory_order_release);
+}
+
+/**
+ * Add a record to a table.
+ * @param rows Table to add to.
+ * @param key Key of the record.
+ * @param f0 First field.
+ * @param f1 Second field.
+ * @param f2 Third field.
+ * @param f3 Fourth field.
+ */
+static inline void AddAdminStatsRecord(std::vector<AdminStatsRecord> &rows, uint64 key, int64 f0, int64 f1, int64 f2 = 0, int64 f3 = 0)
+{
+	AdminStatsRecord r;
+	r.key = key;
+	r.fields[0] = f0;
+	r.fields[1] = f1;
+	r.fields[2] = f2;
+	r.fields[3] = f3;
+	rows.push_back(r);
+}
+
+/**
+ * Copy the statistics of the game into a snapshot.
+ * @param snapshot Snapshot to fill.
+ */
+static void TakeAdminStatsSnapshot(AdminStatsSnapshot &snapshot)
+{
+	snapshot.Clear();
+
+	/* The pools are iterated in index order, so these tables come out sorted. */
+	const Company *c;
+	FOR_ALL_COMPANIES(c) {
+		AddAdminStatsRecord(snapshot.tables[ADMIN_STATS_COMPANY], c->index, c->money, c->current_loan, c->cur_economy.income, c->cur_economy.expenses);
+	}
+
+	const Station *st;
+	FOR_ALL_STATIONS(st) {
+		for (CargoID cid = 0; cid < NUM_CARGO; cid++) {
+			const GoodsEntry &ge = st->goods[cid];
+			if (!ge.IsSourceStationForCargo()) continue;
+			AddAdminStatsRecord(snapshot.tables[ADMIN_STATS_STATION_CARGO], (uint64)st->index << 8 | cid, ge.cargo.TotalCount(), ge.rating);
+		}
+	}
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (!v->IsPrimaryVehicle()) continue;
+		AddAdminStatsRecord(snapshot.tables[ADMIN_STATS_VEHICLE], v->index, v->owner, v->type, v->GetDisplayProfitThisYear(), v->GetDisplayProfitLastYear());
+	}
+
+	/* Link graphs aren't ordered by cargo and nodes not by station, so sort these. */
+	std::vector<AdminStatsRecord> &links = snapshot.tables[ADMIN_STATS_LINK];
+	const LinkGraph *lg;
+	FOR_ALL_LINK_GRAPHS(lg) {
+		for (NodeID from = 0; from < lg->Size(); from++) {
+			LinkGraph::ConstNode node = (*lg)[from];
+			for (LinkGraph::ConstEdgeIterator it = node.Begin(); it != node.End(); ++it) {
+				if (it->second.Capacity() == 0) continue;
+				uint64 key = (uint64)lg->Cargo() << 32 | (uint64)node.Station() << 16 | (*lg)[it->first].Station();
+				AddAdminStatsRecord(links, key, it->second.Capacity(), it->second.Usage());
+			}
+		}
+	}
+	std::sort(links.begin(), links.end(), [](const AdminStatsRecord &a, const AdminStatsRecord &b) { return a.key < b.key; });
+}
+
+/**
+ * Check whether an admin wants to receive the next snapshot.
+ * @param as The admin.
+ * @return True if it is subscribed or asked for a full snapshot.
+ */
+static inline bool IsAdminStatsReceiver(const ServerNetworkAdminSocketHandler *as)
+{
+	return (as->update_frequency[ADMIN_UPDATE_STATS_DELTA] & ADMIN_FREQUENCY_AUTOMATIC) != 0 || as->stats_full_requested;
+}
+
+/** Send the payloads of a finished job to the admins. */
+static void SendAdminStats()
+{
+	const AdminStatsState &s = _admin_stats;
+
+	ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		if (!IsAdminStatsReceiver(as)) continue;
+
+		if (s.delta_is_full) {
+			as->SendStatsDelta(s.sequence, ADMIN_STATS_FLAG_FULL, s.delta);
+		} else if (as->stats_full_requested) {
+			/* The full snapshot wasn't requested yet when the job started. */
+			if (s.full.empty()) continue;
+			as->SendStatsDelta(s.sequence, ADMIN_STATS_FLAG_FULL, s.full);
+		} else {
+			as->SendStatsDelta(s.sequence, 0, s.delta);
+		}
+		as->stats_full_requested = false;
+	}
+}
+
+/** Take and encode a snapshot of the statistics when it is time, and send the ones that are ready. */
+void NetworkAdminStatsTick()
+{
+	AdminStatsState &s = _admin_stats;
+
+	if (s.job_running) {
+		if (!s.job_done.load(std::memory_order_acquire)) return;
+		GetWorkerThreadPool().Wait(&_admin_stats_group);
+		s.job_running = false;
+		SendAdminStats();
+	}
+
+	if (++s.ticks < _settings_client.network.admin_stats_interval) return;
+	s.ticks = 0;
+
+	bool any_receiver = false;
+	bool build_full = false;
+	const ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		if (!IsAdminStatsReceiver(as)) continue;
+		any_receiver = true;
+		if (as->stats_full_requested) build_full = true;
+	}
+
+	if (!any_receiver) {
+		/* Nobody is listening, so the next admin needs a full snapshot anyway. */
+		if (s.has_previous) {
+			s.previous.Clear();
+			s.has_previous = false;
+		}
+		return;
+	}
+
+	TakeAdminStatsSnapshot(s.current);
+	s.build_full = build_full;
+	s.sequence++;
+	s.job_done.store(false, std::memory_order_relaxed);
+	s.job_running = true;
+
+	GetWorkerThreadPool().Submit(&AdminStatsJob, NULL, &_admin_stats_group);
+}
+
+/** Forget the statistics, e.g. when the game is closed; the next snapshot will be a full one. */
+void NetworkAdminStatsReset()
+{
+	AdminStatsState &s = _admin_stats;
+
+	if (s.job_running) {
+		GetWorkerThreadPool().Wait(&_admin_stats_group);
+		s.job_running = false;
+	}
+	s.current.Clear();
+	s.previous.Clear();
+	s.delta.clear();
+	s.full.clear();
+	s.has_previous = false;
+	s.ticks = 0;
+}
+
+#endif /* ENABLE_NETWORK */
@@ -30,6 +30,7 @@
 #include "network.h"
 #include "network_base.h"
 #include "network_client.h"
+#include "network_sync_hash.h"
 #include "../core/backup_type.hpp"
 
 #include "table/strings.h"
@@ -244,11 +245,29 @@ void ClientNetworkGameSocketHandler::ClientError(NetworkRecvStatus res)
 	NetworkExecuteLocalCommandQueue();
 
 	extern void StateGameLoop();
+	SyncHashBeginFrame();
 	StateGameLoop();
+	SyncHashEndFrame(_frame_counter);
 
 	/* Check if we are in sync! */
 	if (_sync_frame != 0) {
 		if (_sync_frame == _frame_counter) {
+			uint32 diverged_frame;
+			uint diverged_subsystems;
+			if (!SyncHashCheckFrames(&diverged_frame, &diverged_subsystems)) {
+				NetworkError(STR_NETWORK_ERROR_DESYNC);
+				uint s;
+				FOR_EACH_SET_BIT(s, diverged_subsystems) {
+					DEBUG(desync, 0, "sync_err: %s diverged in frame %u", GetSyncHashSubsystemName((SyncHashSubsystem)s), diverged_frame);
+				}
+				DEBUG(net, 0, "Sync error detected in frame %u!", diverged_frame);
+				my_client->ClientError(NETWORK_RECV_STATUS_DESYNC);
+
+				extern void CheckCaches(bool force_check);
+				CheckCaches(true);
+				return false;
+			}
+
 #ifdef NETWORK_SEND_DOUBLE_SEED
 			if (_sync_seed_1 != _random.state[0] || _sync_seed_2 != _random.state[1]) {
 #else
@@ -785,6 +804,7 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MAP_BEGIN(Packe
 	this->savegame = new PacketReader();
 
 	_frame_counter = _frame_counter_server = _frame_counter_max = p->Recv_uint32();
+	SyncHashReset();
 
 	_network_join_bytes = 0;
 	_network_join_bytes_total = 0;
@@ -919,6 +939,7 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_SYNC(Packet *p)
 #ifdef NETWORK_SEND_DOUBLE_SEED
 	_sync_seed_2 = p->Recv_uint32();
 #endif
+	SyncHashReceiveFrames(p, _sync_frame);
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
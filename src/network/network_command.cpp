@@ -183,20 +183,20 @@ void NetworkSendCommand(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, Comman
 }
 
 /**
- * Sync our local command queue to the command queue of the given
- * socket. This is needed for the case where we receive a command
+ * Sync our local command queue to the given command queue of joining
+ * clients. This is needed for the case where we receive a command
  * before saving the game for a joining client, but without the
  * execution of those commands. Not syncing those commands means
  * that the client will never get them and as such will be in a
  * desynced state from the time it started with joining.
- * @param cs The client to sync the queue to.
+ * @param queue The queue to sync our local queue to.
  */
-void NetworkSyncCommandQueue(NetworkClientSocket *cs)
+void NetworkSyncCommandQueue(CommandQueue *queue)
 {
 	for (CommandPacket *p = _local_execution_queue.Peek(); p != NULL; p = p->next) {
 		CommandPacket c = *p;
 		c.callback = 0;
-		cs->outgoing_queue.Append(&c);
+		queue->Append(&c);
 	}
 }
 
@@ -264,6 +264,9 @@ static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket
 		}
 	}
 
+	/* Clients joining later on don't get it directly. */
+	NetworkServerLogSnapshotCommand(cp);
+
 	cp.callback = (cs != owner) ? NULL : callback;
 	cp.my_cmd = (cs == owner);
 	_local_execution_queue.Append(&cp);
@@ -32,6 +32,7 @@
 #include "../core/pool_func.hpp"
 #include "../core/random_func.hpp"
 #include "../rev.h"
+#include "network_sync_hash.h"
 
 #include "../safeguards.h"
 
@@ -54,166 +55,179 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
+/** Frames after the start of a map transfer during which other joining clients may share its savegame. */
+static const uint MAP_SNAPSHOT_SHARE_FRAMES = 10 * 1000 / MILLISECONDS_PER_TICK;
+
+/**
+ * A compressed savegame shared by all clients joining at about the same time.
+ * Clients joining after it was made get the commands executed since then, so
+ * they end up at the same state as the clients which joined right away.
+ */
+struct NetworkMapSnapshot {
+	uint32 frame;           ///< Frame at which the savegame was made.
+	CommandQueue commands;  ///< Commands to be executed after #frame, only accessed by the main thread.
+
+	ThreadMutex *mutex;     ///< Mutex protecting everything below, as the savegame is written by the save thread.
+	std::vector<byte> data; ///< The compressed savegame written so far.
+	bool finished;          ///< Whether the whole savegame has been written.
+	bool writing;           ///< Whether the save thread is still writing, i.e. still refers to the snapshot.
+	uint clients;           ///< Number of clients using the snapshot.
 
 	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
+	 * Create a snapshot of the current game state; the savegame is written to it separately.
+	 * @param frame The current frame.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(NULL), cs(cs), current(NULL), total_size(0), packets(NULL)
+	NetworkMapSnapshot(uint32 frame) : frame(frame), finished(false), writing(true), clients(0)
 	{
 		this->mutex = ThreadMutex::New();
 	}
 
-	/** Make sure everything is cleaned up. */
-	~PacketWriter()
+	~NetworkMapSnapshot()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		if (this->cs != NULL && this->mutex != NULL) {
-			this->mutex->WaitForSignal();
-		}
-
-		/* This must all wait until the Destroy function is called. */
+		this->commands.Free();
+		delete this->mutex;
+	}
 
-		while (this->packets != NULL) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
+	/**
+	 * Drop a reference to the snapshot, and delete it when there are no references left.
+	 * @param writer Whether the save thread drops its reference, else a client does.
+	 * @return Number of clients still using the snapshot.
+	 */
+	uint Release(bool writer)
+	{
+		this->mutex->BeginCritical();
+		if (writer) {
+			this->writing = false;
+		} else {
+			this->clients--;
 		}
+		uint clients = this->clients;
+		bool unused = clients == 0 && !this->writing;
+		this->mutex->EndCritical();
 
-		delete this->current;
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
-		delete this->mutex;
-		this->mutex = NULL;
+		if (unused) delete this;
+		return clients;
 	}
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to NULL, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * Get the next packet of the savegame for a client.
+	 * @param pos [in,out] The number of bytes of the savegame the client already got.
+	 * @return The packet, or NULL if the save thread has to write more first.
 	 */
-	void Destroy()
+	Packet *GetPacket(size_t &pos)
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		static const size_t MAP_DATA_SIZE = SEND_MTU - sizeof(PacketSize) - sizeof(PacketType); ///< Bytes of the savegame per packet.
 
-		this->cs = NULL;
+		ThreadMutexLocker lock(this->mutex);
 
-		if (this->mutex != NULL) this->mutex->SendSignal();
+		if (pos > this->data.size()) return NULL;
+		size_t available = this->data.size() - pos;
+		if (available == 0) {
+			if (!this->finished) return NULL;
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+			/* Add a packet stating that this is the end. */
+			pos++;
+			return new Packet(PACKET_SERVER_MAP_DONE);
+		}
 
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
+		/* Only send full packets, unless it is the last one. */
+		if (available < MAP_DATA_SIZE && !this->finished) return NULL;
+
+		size_t to_write = min(available, MAP_DATA_SIZE);
+		Packet *p = new Packet(PACKET_SERVER_MAP_DATA);
+		p->Send_binary((const char *)this->data.data() + pos, to_write);
+		pos += to_write;
+		return p;
 	}
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Get the size of the savegame, once it has been written completely.
+	 * @return The size, or 0 if it has not been finished yet.
 	 */
-	bool HasPackets()
+	size_t GetTotalSize()
 	{
-		return this->packets != NULL;
+		ThreadMutexLocker lock(this->mutex);
+		return this->finished ? this->data.size() : 0;
 	}
+};
+
+/** The snapshot newly joining clients may share, if any. */
+static NetworkMapSnapshot *_network_map_snapshot = NULL;
+
+/** Writing a savegame directly to a snapshot, from which packets are made for the clients. */
+struct PacketWriter : SaveFilter {
+	NetworkMapSnapshot *snapshot; ///< Snapshot we are writing to.
 
 	/**
-	 * Pop a single created packet from the queue with packets.
+	 * Create the packet writer.
+	 * @param snapshot The snapshot to write the savegame to.
 	 */
-	Packet *PopPacket()
+	PacketWriter(NetworkMapSnapshot *snapshot) : SaveFilter(NULL), snapshot(snapshot)
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = NULL;
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
-		return p;
 	}
 
-	/** Append the current packet to the queue. */
-	void AppendQueue()
+	/** Release the snapshot; the packets made of it stay with the clients. */
+	~PacketWriter()
 	{
-		if (this->current == NULL) return;
-
-		Packet **p = &this->packets;
-		while (*p != NULL) {
-			p = &(*p)->next;
-		}
-		*p = this->current;
-
-		this->current = NULL;
+		this->snapshot->Release(true);
 	}
 
 	/* virtual */ void Write(byte *buf, size_t size)
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		ThreadMutexLocker lock(this->snapshot->mutex);
 
-		byte *bufe = buf + size;
-		while (buf != bufe) {
-			size_t to_write = min(SEND_MTU - this->current->size, bufe - buf);
-			memcpy(this->current->buffer + this->current->size, buf, to_write);
-			this->current->size += (PacketSize)to_write;
-			buf += to_write;
+		/* We want to abort the saving when all clients are gone. */
+		if (this->snapshot->clients == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-			if (this->current->size == SEND_MTU) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-			}
-		}
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
-		this->total_size += size;
+		this->snapshot->data.insert(this->snapshot->data.end(), buf, buf + size);
 	}
 
 	/* virtual */ void Finish()
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		ThreadMutexLocker lock(this->snapshot->mutex);
 
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		/* We want to abort the saving when all clients are gone. */
+		if (this->snapshot->clients == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		/* Make sure the last packet is flushed. */
-		this->AppendQueue();
+		this->snapshot->finished = true;
+	}
+};
 
-		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
+/**
+ * Log a command for the clients which will join using the current map snapshot.
+ * @param cp The command, as distributed to the clients.
+ */
+void NetworkServerLogSnapshotCommand(const CommandPacket &cp)
+{
+	NetworkMapSnapshot *snapshot = _network_map_snapshot;
+	if (snapshot == NULL) return;
+
+	if (_frame_counter > snapshot->frame + MAP_SNAPSHOT_SHARE_FRAMES) {
+		/* Too old to share, so nobody will need the log. */
+		_network_map_snapshot = NULL;
+		return;
+	}
 
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
+	CommandPacket c = cp;
+	c.callback = 0;
+	c.my_cmd = false;
+	snapshot->commands.Append(&c);
+}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+/**
+ * Stop using the map snapshot of a client.
+ * @param cs The client.
+ */
+static void NetworkServerReleaseSnapshot(NetworkClientSocket *cs)
+{
+	NetworkMapSnapshot *snapshot = cs->savegame;
+	cs->savegame = NULL;
+	if (snapshot == _network_map_snapshot) {
+		if (snapshot->Release(false) == 0) _network_map_snapshot = NULL;
+	} else {
+		snapshot->Release(false);
 	}
-};
+}
 
 
 /**
@@ -240,10 +254,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	if (_redirect_console_to_client == this->client_id) _redirect_console_to_client = INVALID_CLIENT_ID;
 	OrderBackup::ResetUser(this->client_id);
 
-	if (this->savegame != NULL) {
-		this->savegame->Destroy();
-		this->savegame = NULL;
-	}
+	if (this->savegame != NULL) NetworkServerReleaseSnapshot(this);
 }
 
 Packet *ServerNetworkGameSocketHandler::ReceivePacket()
@@ -575,39 +586,65 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		NetworkMapSnapshot *snapshot = _network_map_snapshot;
+		if (snapshot == NULL || _frame_counter > snapshot->frame + MAP_SNAPSHOT_SHARE_FRAMES) {
+			/* Make a dump of the current game; the previous one must be completely done with. */
+			WaitTillSaved();
+			snapshot = new NetworkMapSnapshot(_frame_counter);
+			snapshot->clients = 1;
+			NetworkSyncCommandQueue(&snapshot->commands);
+			_network_map_snapshot = snapshot;
+			if (SaveWithFilter(new PacketWriter(snapshot), true, _network_savegame_format) != SL_OK) usererror("network savedump failed");
+		} else {
+			/* Share the dump made for a client which joined a moment ago. */
+			ThreadMutexLocker lock(snapshot->mutex);
+			snapshot->clients++;
+		}
+		this->savegame = snapshot;
+		this->savegame_pos = 0;
+		this->savegame_size_sent = false;
+		this->savegame_send_packets = 4; // We start with trying 4 packets
 
-		/* Now send the _frame_counter and how many packets are coming */
+		/* Now send the frame of the savegame */
 		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
+		p->Send_uint32(snapshot->frame);
 		this->SendPacket(p);
 
-		NetworkSyncCommandQueue(this);
+		/* And the commands to execute after it, including the ones already executed by us. */
+		for (CommandPacket *cp = snapshot->commands.Peek(); cp != NULL; cp = cp->next) {
+			this->outgoing_queue.Append(cp);
+		}
 		this->status = STATUS_MAP;
 		/* Mark the start of download */
 		this->last_frame = _frame_counter;
 		this->last_frame_server = _frame_counter;
-
-		sent_packets = 4; // We start with trying 4 packets
-
-		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		if (!this->savegame_size_sent) {
+			size_t total_size = this->savegame->GetTotalSize();
+			if (total_size != 0) {
+				/* Fast-track the size to the client. */
+				Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+				p->Send_uint32((uint32)total_size);
+				this->SendPacket(p);
+				this->savegame_size_sent = true;
+			}
+		}
+
+		for (uint i = 0; i < this->savegame_send_packets; i++) {
+			Packet *p = this->savegame->GetPacket(this->savegame_pos);
+			if (p == NULL) break;
+			has_packets = true;
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
 			this->SendPacket(p);
@@ -619,9 +656,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 		}
 
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
-			this->savegame = NULL;
+			/* Done reading, the packets are all ours now */
+			NetworkServerReleaseSnapshot(this);
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
@@ -644,9 +680,12 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				best->status = STATUS_AUTHORIZED;
 				best->SendMap();
 
-				/* And update the rest. */
+				/* And let the rest join using the same savegame. */
 				FOR_ALL_CLIENT_SOCKETS(new_cs) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
+					if (new_cs->status == STATUS_MAP_WAIT) {
+						new_cs->status = STATUS_AUTHORIZED;
+						new_cs->SendMap();
+					}
 				}
 			}
 		}
@@ -656,8 +695,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				return NETWORK_RECV_STATUS_CONN_LOST;
 
 			case SPS_ALL_SENT:
-				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				/* All are sent, increase the number of packets to send */
+				if (has_packets) this->savegame_send_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -665,8 +704,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				break;
 
 			case SPS_NONE_SENT:
-				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				/* Not everything is sent, decrease the number of packets to send */
+				if (this->savegame_send_packets > 1) this->savegame_send_packets /= 2;
 				break;
 		}
 	}
@@ -720,6 +759,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendSync()
 #ifdef NETWORK_SEND_DOUBLE_SEED
 	p->Send_uint32(_sync_seed_2);
 #endif
+	/* The hashes of all frames since the previous sync. */
+	if (_settings_client.network.sync_hashes) SyncHashSendFrames(p, _frame_counter, _settings_client.network.sync_freq);
 	this->SendPacket(p);
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -1024,7 +1065,12 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
-	/* Check if someone else is receiving the map */
+	/* Join the clients which started receiving the map a moment ago */
+	if (_network_map_snapshot != NULL && _frame_counter <= _network_map_snapshot->frame + MAP_SNAPSHOT_SHARE_FRAMES) {
+		return this->SendMap();
+	}
+
+	/* Check if someone else is receiving an older map */
 	FOR_ALL_CLIENT_SOCKETS(new_cs) {
 		if (new_cs->status == STATUS_MAP) {
 			/* Tell the new client to wait */
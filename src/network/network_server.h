@@ -75,7 +75,10 @@ public:
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
 
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	struct NetworkMapSnapshot *savegame; ///< Savegame being sent to the client, possibly shared with other clients.
+	size_t savegame_pos;                 ///< Number of bytes of the savegame sent to the client.
+	bool savegame_size_sent;             ///< Whether the size of the savegame was sent to the client.
+	uint savegame_send_packets;          ///< Number of savegame packets to try to send at once.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
@@ -124,6 +127,7 @@ public:
 void NetworkServer_Tick(bool send_frame);
 void NetworkServerSetCompanyPassword(CompanyID company_id, const char *password, bool already_hashed = true);
 void NetworkServerUpdateCompanyPassworded(CompanyID company_id, bool passworded);
+void NetworkServerLogSnapshotCommand(const CommandPacket &cp);
 
 /**
  * Iterate over all the sockets from a given starting point.
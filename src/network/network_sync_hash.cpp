@@ -0,0 +1,216 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file network_sync_hash.cpp Per subsystem hashes of the game state, to pinpoint desyncs. */
+
+#include "../stdafx.h"
+#include "network_sync_hash.h"
+#include "../vehicle_base.h"
+#include "../station_base.h"
+#include "network.h"
+#ifdef ENABLE_NETWORK
+#include "core/packet.h"
+#endif /* ENABLE_NETWORK */
+
+#include "../safeguards.h"
+
+/*
+ * During every frame of a network game the loops which already visit the
+ * game state fold the values they touch into a hash per subsystem: the
+ * vehicle ticks, the station rating updates and the tile loop. That makes the
+ * hashes nearly free, but means they only cover the state those loops look
+ * at. Writes elsewhere, e.g. by commands, are not hashed when they happen; a
+ * diverging tile for example is only noticed when the tile loop reaches it,
+ * which is once in 256 frames. The server sends the hashes of all frames
+ * since the previous sync packet, so a client can tell in which frame and
+ * which subsystem it diverged first.
+ */
+
+bool _sync_hash_active;          ///< Whether the hashes are being calculated this frame.
+uint32 _sync_hash[SHS_END];      ///< Hashes of the current frame.
+
+/** Number of frames of which the hashes are kept; clients may run a bit ahead of the sync packets. */
+static const uint SYNC_HASH_RECORDS = 2 * SYNC_HASH_MAX_FRAMES;
+
+/** Hashes of a single frame. */
+struct SyncHashRecord {
+	uint32 frame;         ///< The frame these hashes belong to.
+	bool valid;           ///< Whether the record has been filled at all.
+	uint16 hash[SHS_END]; ///< The hashes, folded to 16 bits.
+};
+
+static SyncHashRecord _sync_hash_records[SYNC_HASH_RECORDS]; ///< Ring buffer with the hashes of the last frames.
+
+/**
+ * Fold the state of a vehicle into the hashes. CallVehicleTicks calls this
+ * right after Vehicle::Tick, before the cargo of the vehicle is aged.
+ * @param v The vehicle.
+ */
+void SyncHashVehicle(const Vehicle *v)
+{
+	SyncHashFold(SHS_VEHICLES, v->index);
+	SyncHashFold(SHS_VEHICLES, v->tile);
+	SyncHashFold(SHS_VEHICLES, v->x_pos);
+	SyncHashFold(SHS_VEHICLES, v->y_pos);
+	SyncHashFold(SHS_VEHICLES, v->z_pos);
+	SyncHashFold(SHS_VEHICLES, v->cur_speed | v->subspeed << 16 | v->progress << 24);
+	SyncHashFold(SHS_VEHICLES, v->direction | v->vehstatus << 8);
+
+	if (v->cargo_cap != 0) {
+		SyncHashFold(SHS_CARGO, v->index);
+		SyncHashFold(SHS_CARGO, v->cargo.TotalCount());
+	}
+}
+
+/**
+ * Fold the state of a station into the hashes, after its rating has been updated.
+ * @param st The station.
+ */
+void SyncHashStation(const Station *st)
+{
+	SyncHashFold(SHS_STATIONS, st->index);
+	SyncHashFold(SHS_CARGO, st->index);
+	for (CargoID c = 0; c < NUM_CARGO; c++) {
+		const GoodsEntry &ge = st->goods[c];
+		if (!ge.IsSourceStationForCargo()) continue;
+		SyncHashFold(SHS_STATIONS, c | ge.rating << 8 | ge.status << 16 | ge.time_since_pickup << 24);
+		SyncHashFold(SHS_CARGO, ge.cargo.TotalCount());
+	}
+}
+
+/** Forget the hashes of all frames, e.g. because the frame counter is reset. */
+void SyncHashReset()
+{
+	for (uint i = 0; i < SYNC_HASH_RECORDS; i++) _sync_hash_records[i].valid = false;
+}
+
+/** Start calculating the hashes of a new frame. */
+void SyncHashBeginFrame()
+{
+	_sync_hash_active = _networking;
+	if (!_sync_hash_active) return;
+
+	for (uint i = 0; i < SHS_END; i++) _sync_hash[i] = 0x811C9DC5;
+}
+
+/**
+ * Store the hashes of a frame that has been run.
+ * @param frame The frame.
+ */
+void SyncHashEndFrame(uint32 frame)
+{
+	if (!_sync_hash_active) return;
+	_sync_hash_active = false;
+
+	SyncHashRecord &r = _sync_hash_records[frame % SYNC_HASH_RECORDS];
+	r.frame = frame;
+	r.valid = true;
+	for (uint i = 0; i < SHS_END; i++) r.hash[i] = GB(_sync_hash[i] ^ (_sync_hash[i] >> 16), 0, 16);
+}
+
+/**
+ * Get the hashes of a frame.
+ * @param frame The frame.
+ * @return The hashes, or NULL if they aren't known.
+ */
+static const SyncHashRecord *GetSyncHashRecord(uint32 frame)
+{
+	const SyncHashRecord &r = _sync_hash_records[frame % SYNC_HASH_RECORDS];
+	return r.valid && r.frame == frame ? &r : NULL;
+}
+
+/**
+ * Get the name of a subsystem, for logging.
+ * @param subsystem The subsystem.
+ * @return The name.
+ */
+const char *GetSyncHashSubsystemName(SyncHashSubsystem subsystem)
+{
+	static const char * const names[] = { "vehicles", "cargo", "stations", "map" };
+	assert_compile(lengthof(names) == SHS_END);
+	return names[subsystem];
+}
+
+#ifdef ENABLE_NETWORK
+
+/** Hashes as sent by the server with the last sync packet, oldest frame first. */
+static uint16 _sync_hash_expected[SYNC_HASH_MAX_FRAMES][SHS_END];
+static uint _sync_hash_expected_count; ///< Number of frames in #_sync_hash_expected.
+static uint32 _sync_hash_expected_last; ///< Last frame in #_sync_hash_expected.
+
+/**
+ * Add the hashes of the frames up to the given one to a sync packet.
+ * uint8   Number of frames N; only frames with known hashes are sent.
+ * N times the hash of each #SyncHashSubsystem as uint16, oldest frame first.
+ * @param p The packet to add the hashes to.
+ * @param last_frame The frame of the sync packet.
+ * @param max_frames The maximum number of frames to send.
+ */
+void SyncHashSendFrames(Packet *p, uint32 last_frame, uint max_frames)
+{
+	uint count = 0;
+	max_frames = min(max_frames, SYNC_HASH_MAX_FRAMES);
+	while (count < max_frames && count <= last_frame && GetSyncHashRecord(last_frame - count) != NULL) count++;
+
+	p->Send_uint8(count);
+	for (uint i = count; i > 0; i--) {
+		const SyncHashRecord *r = GetSyncHashRecord(last_frame - i + 1);
+		for (uint s = 0; s < SHS_END; s++) p->Send_uint16(r->hash[s]);
+	}
+}
+
+/**
+ * Read the hashes of the server from a sync packet, if it sent any.
+ * @param p The packet to read the hashes from.
+ * @param last_frame The frame of the sync packet.
+ */
+void SyncHashReceiveFrames(Packet *p, uint32 last_frame)
+{
+	_sync_hash_expected_count = 0;
+	_sync_hash_expected_last = last_frame;
+	if (p->pos >= p->size) return;
+
+	uint count = min<uint>(p->Recv_uint8(), SYNC_HASH_MAX_FRAMES);
+	for (uint i = 0; i < count; i++) {
+		for (uint s = 0; s < SHS_END; s++) _sync_hash_expected[i][s] = p->Recv_uint16();
+	}
+	_sync_hash_expected_count = count;
+}
+
+/**
+ * Compare our hashes with the ones the server sent with the last sync packet.
+ * Frames of which we don't know the hashes, e.g. from before joining, are skipped.
+ * @param[out] frame The first frame whose hashes differ.
+ * @param[out] subsystems Bit mask of #SyncHashSubsystem which differ in that frame.
+ * @return True if all hashes matched.
+ */
+bool SyncHashCheckFrames(uint32 *frame, uint *subsystems)
+{
+	uint count = _sync_hash_expected_count;
+	_sync_hash_expected_count = 0;
+
+	for (uint i = 0; i < count; i++) {
+		uint32 f = _sync_hash_expected_last - count + 1 + i;
+		const SyncHashRecord *r = GetSyncHashRecord(f);
+		if (r == NULL) continue;
+
+		uint diff = 0;
+		for (uint s = 0; s < SHS_END; s++) {
+			if (r->hash[s] != _sync_hash_expected[i][s]) SetBit(diff, s);
+		}
+		if (diff != 0) {
+			*frame = f;
+			*subsystems = diff;
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif /* ENABLE_NETWORK */
@@ -0,0 +1,74 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file network_sync_hash.h Per subsystem hashes of the game state, to pinpoint desyncs. */
+
+#ifndef NETWORK_SYNC_HASH_H
+#define NETWORK_SYNC_HASH_H
+
+#include "../map_func.h"
+#include "../vehicle_type.h"
+#include "../station_type.h"
+
+/** Parts of the game state which are hashed separately. */
+enum SyncHashSubsystem {
+	SHS_VEHICLES, ///< Position, speed and state of the vehicles.
+	SHS_CARGO,    ///< Cargo in vehicles and waiting at stations.
+	SHS_STATIONS, ///< Ratings of the stations.
+	SHS_MAP,      ///< Contents of the tiles visited by the tile loop; other map changes only show up once the tile loop reaches them.
+	SHS_END,      ///< End marker.
+};
+
+/** Maximum number of frames of which the hashes are sent with a single sync packet. */
+static const uint SYNC_HASH_MAX_FRAMES = 128;
+
+extern bool _sync_hash_active;
+extern uint32 _sync_hash[SHS_END];
+
+/**
+ * Fold a value into the hash of a subsystem for the current frame.
+ * @param subsystem The subsystem the value belongs to.
+ * @param value The value.
+ */
+static inline void SyncHashFold(SyncHashSubsystem subsystem, uint32 value)
+{
+	_sync_hash[subsystem] = (_sync_hash[subsystem] ^ value) * 0x01000193;
+}
+
+/**
+ * Fold the contents of a tile into the map hash. The fields are folded one by
+ * one, so the hash doesn't depend on the memory layout or byte order.
+ * @param tile The tile.
+ */
+static inline void SyncHashTile(TileIndex tile)
+{
+	const Tile &m = _m[tile];
+	SyncHashFold(SHS_MAP, m.type | m.height << 8 | m.m1 << 16);
+	SyncHashFold(SHS_MAP, m.m2);
+	SyncHashFold(SHS_MAP, m.m3 | m.m4 << 8 | m.m5 << 16);
+	SyncHashFold(SHS_MAP, _me[tile].m6 | _me[tile].m7 << 8);
+}
+
+void SyncHashVehicle(const Vehicle *v);
+void SyncHashStation(const Station *st);
+
+void SyncHashReset();
+void SyncHashBeginFrame();
+void SyncHashEndFrame(uint32 frame);
+const char *GetSyncHashSubsystemName(SyncHashSubsystem subsystem);
+
+#ifdef ENABLE_NETWORK
+struct Packet;
+
+void SyncHashSendFrames(Packet *p, uint32 last_frame, uint max_frames);
+void SyncHashReceiveFrames(Packet *p, uint32 last_frame);
+bool SyncHashCheckFrames(uint32 *frame, uint *subsystems);
+#endif /* ENABLE_NETWORK */
+
+#endif /* NETWORK_SYNC_HASH_H */
@@ -34,6 +34,7 @@
 #include "date_func.h"
 #include "newgrf_debug.h"
 #include "vehicle_func.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 #include "table/object_land.h"
@@ -124,6 +125,8 @@ void BuildObject(ObjectType type, TileIndex tile, CompanyID owner, Town *town, u
 			DirtyCompanyInfrastructureWindows(owner);
 		}
 		MakeObject(t, owner, o->index, wc, Random());
+		/* Objects on water are built without clearing the tile first. */
+		if (wc != WATER_CLASS_INVALID) InvalidateWaterRegion(t);
 		MarkTileDirtyByTile(t, ZOOM_LVL_DRAW_MAP);
 	}
 
@@ -364,6 +364,7 @@ static void ShutdownGame()
 	UninitFreeType();
 
 	ViewportMapClearTunnelCache();
+	ViewportMapClearColourCache();
 	ClearCommandLog();
 }
 
@@ -1689,7 +1690,7 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
+	MaintainSpriteCache();
 	InteractiveRandom();
 
 	extern int _caret_timer;
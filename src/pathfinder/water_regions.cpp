@@ -0,0 +1,360 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Handles dividing the water in the map into square regions to assist pathfinding. */
+
+#include "../stdafx.h"
+#include "../ship.h"
+#include "../bridge_map.h"
+#include "water_regions.h"
+#include "follow_track.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../safeguards.h"
+
+/**
+ * The water of a square region of the map, divided into patches of water
+ * which are connected within the region. Regions are updated lazily: a
+ * change to the map only marks the region as not initialized, the patches
+ * are determined again the first time the region is used afterwards.
+ */
+class WaterRegion {
+	TWaterRegionTraversabilityBits edge_traversability_bits[DIAGDIR_END]; ///< Per side, the edge tiles through which ships can leave the region.
+	bool has_cross_region_aqueducts;                                      ///< Whether an aqueduct leads from this region to another one.
+	bool initialized;                                                     ///< Whether the patches are up to date.
+	TWaterRegionPatchLabel number_of_patches;                             ///< Number of patches of water, 0 if there isn't any water.
+	TWaterRegionPatchLabel uniform_label;                                 ///< Label of all tiles if #tile_patch_labels is NULL.
+	std::unique_ptr<TWaterRegionPatchLabel[]> tile_patch_labels;          ///< Label of each tile, NULL if all tiles have the same label.
+
+	/**
+	 * Get the index of a tile within its water region.
+	 * @param tile The tile.
+	 * @return Index in #tile_patch_labels.
+	 */
+	static inline uint GetLocalIndex(TileIndex tile)
+	{
+		return (TileY(tile) % WATER_REGION_EDGE_LENGTH) * WATER_REGION_EDGE_LENGTH + (TileX(tile) % WATER_REGION_EDGE_LENGTH);
+	}
+
+public:
+	WaterRegion() : has_cross_region_aqueducts(false), initialized(false), number_of_patches(0), uniform_label(INVALID_WATER_REGION_PATCH)
+	{
+		std::fill(this->edge_traversability_bits, endof(this->edge_traversability_bits), 0);
+	}
+
+	inline bool IsInitialized() const { return this->initialized; }
+	inline void Invalidate() { this->initialized = false; }
+	inline bool HasCrossRegionAqueducts() const { return this->has_cross_region_aqueducts; }
+	inline TWaterRegionPatchLabel NumberOfPatches() const { return this->number_of_patches; }
+
+	/**
+	 * Get the edge tiles through which ships can leave the region on a side.
+	 * @param side Side of the region.
+	 * @return Bit i is set if the i-th tile along the side can be left through that side.
+	 */
+	inline TWaterRegionTraversabilityBits GetEdgeTraversabilityBits(DiagDirection side) const
+	{
+		return this->edge_traversability_bits[side];
+	}
+
+	/**
+	 * Get the patch a tile of the region belongs to.
+	 * @param tile Tile within the region.
+	 * @return Label of the patch, or INVALID_WATER_REGION_PATCH if ships can't use the tile.
+	 */
+	inline TWaterRegionPatchLabel GetLabel(TileIndex tile) const
+	{
+		assert(this->initialized);
+		if (this->tile_patch_labels == NULL) return this->uniform_label;
+		return this->tile_patch_labels[GetLocalIndex(tile)];
+	}
+
+	void Update(uint region_x, uint region_y);
+};
+
+static std::vector<WaterRegion> _water_regions; ///< All water regions of the map, row by row.
+
+/**
+ * Get the number of water regions along the X axis of the map.
+ * @return Number of water regions.
+ */
+static inline uint GetWaterRegionMapSizeX()
+{
+	return MapSizeX() / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the number of water regions along the Y axis of the map.
+ * @return Number of water regions.
+ */
+static inline uint GetWaterRegionMapSizeY()
+{
+	return MapSizeY() / WATER_REGION_EDGE_LENGTH;
+}
+
+static inline uint GetWaterRegionIndex(uint region_x, uint region_y)
+{
+	return region_y * GetWaterRegionMapSizeX() + region_x;
+}
+
+/**
+ * Get the tile at a given position along a side of a water region.
+ * @param region_x X coordinate of the water region.
+ * @param region_y Y coordinate of the water region.
+ * @param side Side of the water region.
+ * @param x_or_y Position along the side.
+ * @return The edge tile.
+ */
+static TileIndex GetEdgeTileCoordinate(uint region_x, uint region_y, DiagDirection side, uint x_or_y)
+{
+	assert(x_or_y < WATER_REGION_EDGE_LENGTH);
+	const uint base_x = region_x * WATER_REGION_EDGE_LENGTH;
+	const uint base_y = region_y * WATER_REGION_EDGE_LENGTH;
+	switch (side) {
+		case DIAGDIR_NE: return TileXY(base_x, base_y + x_or_y);
+		case DIAGDIR_SW: return TileXY(base_x + WATER_REGION_EDGE_LENGTH - 1, base_y + x_or_y);
+		case DIAGDIR_NW: return TileXY(base_x + x_or_y, base_y);
+		case DIAGDIR_SE: return TileXY(base_x + x_or_y, base_y + WATER_REGION_EDGE_LENGTH - 1);
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Determine the patches of water of the region and through which edge tiles
+ * they can be left. Tiles are connected when a ship can move from one to the
+ * other, so e.g. a lock or a ship depot only connects along its axis.
+ * @param region_x X coordinate of the water region.
+ * @param region_y Y coordinate of the water region.
+ */
+void WaterRegion::Update(uint region_x, uint region_y)
+{
+	std::fill(this->edge_traversability_bits, endof(this->edge_traversability_bits), 0);
+	this->has_cross_region_aqueducts = false;
+
+	const TileArea tile_area(TileXY(region_x * WATER_REGION_EDGE_LENGTH, region_y * WATER_REGION_EDGE_LENGTH), WATER_REGION_EDGE_LENGTH, WATER_REGION_EDGE_LENGTH);
+
+	TWaterRegionPatchLabel labels[WATER_REGION_NUMBER_OF_TILES];
+	std::fill(labels, endof(labels), INVALID_WATER_REGION_PATCH);
+
+	/* Each tile is put on the stack at most once, when it gets its label. */
+	TileIndex tiles_to_check[WATER_REGION_NUMBER_OF_TILES];
+	uint num_tiles_to_check = 0;
+
+	TWaterRegionPatchLabel current_label = INVALID_WATER_REGION_PATCH;
+	TILE_AREA_LOOP(start_tile, tile_area) {
+		if (labels[GetLocalIndex(start_tile)] != INVALID_WATER_REGION_PATCH) continue;
+		if (TrackStatusToTrackdirBits(GetTileTrackStatus(start_tile, TRANSPORT_WATER, 0)) == TRACKDIR_BIT_NONE) continue;
+
+		/* Flood fill a new patch. There are at most half as many patches as tiles, so the label can't overflow. */
+		current_label++;
+		labels[GetLocalIndex(start_tile)] = current_label;
+		tiles_to_check[num_tiles_to_check++] = start_tile;
+
+		while (num_tiles_to_check > 0) {
+			const TileIndex tile = tiles_to_check[--num_tiles_to_check];
+			const TrackdirBits valid_dirs = TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+			for (TrackdirBits dirs = valid_dirs; dirs != TRACKDIR_BIT_NONE; dirs = KillFirstBit(dirs)) {
+				const Trackdir dir = (Trackdir)FindFirstBit2x64(dirs);
+				CFollowTrackWater ft;
+				if (!ft.Follow(tile, dir)) continue;
+
+				if (tile_area.Contains(ft.m_new_tile)) {
+					TWaterRegionPatchLabel &label = labels[GetLocalIndex(ft.m_new_tile)];
+					if (label == INVALID_WATER_REGION_PATCH) {
+						label = current_label;
+						tiles_to_check[num_tiles_to_check++] = ft.m_new_tile;
+					}
+				} else if (ft.m_new_tile == TileAddByDiagDir(tile, ft.m_exitdir)) {
+					/* Leaving the region through one of its sides. */
+					const uint x_or_y = DiagDirToAxis(ft.m_exitdir) == AXIS_X ? TileY(tile) - TileY(tile_area.tile) : TileX(tile) - TileX(tile_area.tile);
+					SetBit(this->edge_traversability_bits[ft.m_exitdir], x_or_y);
+				} else {
+					/* Leaving the region over an aqueduct. */
+					this->has_cross_region_aqueducts = true;
+				}
+			}
+		}
+	}
+
+	this->number_of_patches = current_label;
+
+	/* Most regions are either open water or land; don't store a label per tile for those. */
+	if (std::find_if(labels, endof(labels), [&](TWaterRegionPatchLabel l) { return l != labels[0]; }) == endof(labels)) {
+		this->tile_patch_labels.reset();
+		this->uniform_label = labels[0];
+	} else {
+		if (this->tile_patch_labels == NULL) this->tile_patch_labels.reset(new TWaterRegionPatchLabel[WATER_REGION_NUMBER_OF_TILES]);
+		std::copy(labels, endof(labels), this->tile_patch_labels.get());
+	}
+
+	this->initialized = true;
+}
+
+/**
+ * Get a water region, updating it first if needed.
+ * @param region_x X coordinate of the water region.
+ * @param region_y Y coordinate of the water region.
+ * @return The up to date water region.
+ */
+static WaterRegion &GetUpdatedWaterRegion(uint region_x, uint region_y)
+{
+	WaterRegion &region = _water_regions[GetWaterRegionIndex(region_x, region_y)];
+	if (!region.IsInitialized()) region.Update(region_x, region_y);
+	return region;
+}
+
+/**
+ * Calculate a hash of a water region patch, unique for all patches of the map.
+ * @param water_region_patch The patch.
+ * @return The hash.
+ */
+int CalculateWaterRegionPatchHash(const WaterRegionPatchDesc &water_region_patch)
+{
+	return water_region_patch.label | GetWaterRegionIndex(water_region_patch.x, water_region_patch.y) << 8;
+}
+
+/**
+ * Get the center tile of a water region.
+ * @param water_region The water region.
+ * @return The center tile; it may well be land.
+ */
+TileIndex GetWaterRegionCenterTile(const WaterRegionDesc &water_region)
+{
+	return TileXY(water_region.x * WATER_REGION_EDGE_LENGTH + WATER_REGION_EDGE_LENGTH / 2, water_region.y * WATER_REGION_EDGE_LENGTH + WATER_REGION_EDGE_LENGTH / 2);
+}
+
+/**
+ * Get the water region a tile is in.
+ * @param tile The tile.
+ * @return The water region.
+ */
+WaterRegionDesc GetWaterRegionInfo(TileIndex tile)
+{
+	WaterRegionDesc desc = { (int)(TileX(tile) / WATER_REGION_EDGE_LENGTH), (int)(TileY(tile) / WATER_REGION_EDGE_LENGTH) };
+	return desc;
+}
+
+/**
+ * Get the water region patch a tile is in.
+ * @param tile The tile.
+ * @return The patch; its label is INVALID_WATER_REGION_PATCH if ships can't use the tile.
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	const WaterRegionDesc region = GetWaterRegionInfo(tile);
+	WaterRegionPatchDesc desc = { region.x, region.y, GetUpdatedWaterRegion(region.x, region.y).GetLabel(tile) };
+	return desc;
+}
+
+/**
+ * Mark the water region of a tile as changed. Call this whenever a change to
+ * the tile may change where ships can go.
+ * @param tile The changed tile.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	if (_water_regions.empty()) return;
+
+	_water_regions[GetWaterRegionIndex(TileX(tile) / WATER_REGION_EDGE_LENGTH, TileY(tile) / WATER_REGION_EDGE_LENGTH)].Invalidate();
+
+	/* Whether ships can leave a region depends on the first tile of the adjacent region too. */
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		const TileIndex adjacent = AddTileIndexDiffCWrap(tile, TileIndexDiffCByDiagDir(side));
+		if (adjacent == INVALID_TILE) continue;
+		_water_regions[GetWaterRegionIndex(TileX(adjacent) / WATER_REGION_EDGE_LENGTH, TileY(adjacent) / WATER_REGION_EDGE_LENGTH)].Invalidate();
+	}
+}
+
+/**
+ * Call the callback for each patch in the adjacent water region on one side
+ * which ships can reach directly from the given patch.
+ * @param water_region_patch The patch to start from.
+ * @param side Side of the region of the patch.
+ * @param callback Function to call for each reachable patch.
+ */
+static void VisitAdjacentWaterRegionPatchNeighbours(const WaterRegionPatchDesc &water_region_patch, DiagDirection side, const TVisitWaterRegionPatchCallBack &callback)
+{
+	const TileIndexDiffC offset = TileIndexDiffCByDiagDir(side);
+	const int nx = water_region_patch.x + offset.x;
+	const int ny = water_region_patch.y + offset.y;
+	if (nx < 0 || ny < 0 || nx >= (int)GetWaterRegionMapSizeX() || ny >= (int)GetWaterRegionMapSizeY()) return;
+
+	const WaterRegion &current_region = GetUpdatedWaterRegion(water_region_patch.x, water_region_patch.y);
+	const WaterRegion &neighbouring_region = GetUpdatedWaterRegion(nx, ny);
+	const DiagDirection opposite_side = ReverseDiagDir(side);
+
+	/* The positions along the side where ships can cross over into the adjacent region. */
+	const TWaterRegionTraversabilityBits traversability_bits = current_region.GetEdgeTraversabilityBits(side) & neighbouring_region.GetEdgeTraversabilityBits(opposite_side);
+	if (traversability_bits == 0) return;
+
+	if (current_region.NumberOfPatches() == 1 && neighbouring_region.NumberOfPatches() == 1) {
+		WaterRegionPatchDesc neighbour = { nx, ny, 1 };
+		callback(neighbour);
+		return;
+	}
+
+	/* There are several patches on either side, so check the edge tiles one by one. */
+	TWaterRegionPatchLabel unique_labels[WATER_REGION_EDGE_LENGTH];
+	uint num_unique_labels = 0;
+	for (uint x_or_y = 0; x_or_y < WATER_REGION_EDGE_LENGTH; x_or_y++) {
+		if (!HasBit(traversability_bits, x_or_y)) continue;
+
+		const TileIndex current_edge_tile = GetEdgeTileCoordinate(water_region_patch.x, water_region_patch.y, side, x_or_y);
+		if (current_region.GetLabel(current_edge_tile) != water_region_patch.label) continue;
+
+		const TileIndex neighbour_edge_tile = GetEdgeTileCoordinate(nx, ny, opposite_side, x_or_y);
+		const TWaterRegionPatchLabel neighbour_label = neighbouring_region.GetLabel(neighbour_edge_tile);
+		assert(neighbour_label != INVALID_WATER_REGION_PATCH);
+		if (std::find(unique_labels, unique_labels + num_unique_labels, neighbour_label) == unique_labels + num_unique_labels) {
+			unique_labels[num_unique_labels++] = neighbour_label;
+		}
+	}
+
+	for (uint i = 0; i < num_unique_labels; i++) {
+		WaterRegionPatchDesc neighbour = { nx, ny, unique_labels[i] };
+		callback(neighbour);
+	}
+}
+
+/**
+ * Call the callback for each water region patch which ships can reach
+ * directly from the given patch, either over a side of its region or over an
+ * aqueduct leading out of its region.
+ * @param water_region_patch The patch to start from.
+ * @param callback Function to call for each reachable patch.
+ */
+void VisitWaterRegionPatchNeighbours(const WaterRegionPatchDesc &water_region_patch, const TVisitWaterRegionPatchCallBack &callback)
+{
+	const WaterRegion &current_region = GetUpdatedWaterRegion(water_region_patch.x, water_region_patch.y);
+
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		VisitAdjacentWaterRegionPatchNeighbours(water_region_patch, side, callback);
+	}
+
+	if (current_region.HasCrossRegionAqueducts()) {
+		const TileArea tile_area(TileXY(water_region_patch.x * WATER_REGION_EDGE_LENGTH, water_region_patch.y * WATER_REGION_EDGE_LENGTH), WATER_REGION_EDGE_LENGTH, WATER_REGION_EDGE_LENGTH);
+		TILE_AREA_LOOP(tile, tile_area) {
+			if (!IsBridgeTile(tile) || GetTunnelBridgeTransportType(tile) != TRANSPORT_WATER) continue;
+			if (current_region.GetLabel(tile) != water_region_patch.label) continue;
+
+			const TileIndex other_end = GetOtherBridgeEnd(tile);
+			if (!tile_area.Contains(other_end)) callback(GetWaterRegionPatchInfo(other_end));
+		}
+	}
+}
+
+/** Allocate the water regions for the current map size. All regions start out not initialized. */
+void AllocateWaterRegions()
+{
+	_water_regions.clear();
+	_water_regions.resize(GetWaterRegionMapSizeX() * GetWaterRegionMapSizeY());
+}
@@ -15,6 +15,193 @@
 #include "../../misc/array.hpp"
 #include "../../misc/hashtable.hpp"
 #include "../../misc/binaryheap.hpp"
+#include "../../core/math_func.hpp"
+#include "../../date_func.h"
+#include "../../debug.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Allocation statistics of the node arenas of all node types and threads, published daily at debug level yapf=2. */
+struct CNodeArenaStats {
+	static std::atomic<uint> s_searches;         ///< Node lists created since the last statistics output.
+	static std::atomic<uint> s_reused;           ///< Node lists which reused the arena of an earlier search since the last statistics output.
+	static std::atomic<uint> s_blocks_allocated; ///< Node blocks allocated since the last statistics output.
+	static std::atomic<uint> s_blocks_freed;     ///< Node blocks freed when shrinking an arena since the last statistics output.
+	static std::atomic<uint> s_peak_nodes;       ///< Most nodes used by a single search since the last statistics output.
+	static std::atomic<Date> s_last_date;        ///< Date of the last statistics output.
+
+	/**
+	 * Record the number of nodes used by a search.
+	 * @param nodes Number of nodes.
+	 */
+	static inline void RecordSearch(uint nodes)
+	{
+		uint peak = s_peak_nodes.load(std::memory_order_relaxed);
+		while (nodes > peak && !s_peak_nodes.compare_exchange_weak(peak, nodes, std::memory_order_relaxed)) {}
+	}
+
+	/**
+	 * Output and reset the statistics on the first search of a day. Every
+	 * search passes here, so the rail, road and ship pathfinders all count.
+	 */
+	static inline void OutputDaily()
+	{
+		Date last_date = s_last_date.load(std::memory_order_relaxed);
+		if (last_date == _date || !s_last_date.compare_exchange_strong(last_date, _date)) return;
+
+		DEBUG(yapf, 2, "Node arenas today: %u searches, %u reused arenas, %u blocks allocated, %u blocks freed, %u nodes peak",
+				s_searches.exchange(0), s_reused.exchange(0), s_blocks_allocated.exchange(0), s_blocks_freed.exchange(0), s_peak_nodes.exchange(0));
+	}
+};
+
+/**
+ * Storage for the nodes and the open queue of a single search. Arenas are kept
+ *  per thread and node type, and are reset instead of freed when a search ends,
+ *  so the next search doesn't need to allocate at all. The memory kept follows
+ *  the sizes of recent searches, so a single huge search doesn't pin its memory.
+ */
+template <class Titem_>
+class CNodeArenaT {
+public:
+	static const uint BLOCK_SIZE = 256;      ///< Number of nodes per block.
+
+	CBinaryHeapT<Titem_> m_open_queue;       ///< Priority queue of pointers to open item data.
+
+protected:
+	std::vector<Titem_ *> m_blocks;          ///< Blocks of BLOCK_SIZE nodes, only the first m_count nodes are constructed.
+	uint m_count;                            ///< Number of nodes in use.
+
+	/** Arenas of this node type not used by any search, per thread. */
+	struct FreeList {
+		std::vector<std::unique_ptr<CNodeArenaT>> arenas; ///< The unused arenas.
+		uint recent_peak;                                 ///< Decaying maximum of the node counts of recent searches.
+
+		FreeList() : recent_peak(0) {}
+	};
+
+	static FreeList &GetFreeList()
+	{
+		static thread_local FreeList free_list;
+		return free_list;
+	}
+
+	/**
+	 * Destroy all nodes and keep only enough blocks for the given number of nodes.
+	 * @param keep_nodes Number of nodes to keep memory for.
+	 */
+	void Reset(uint keep_nodes)
+	{
+		for (uint i = 0; i < m_count; i++) (*this)[i].~Titem_();
+		m_count = 0;
+		m_open_queue.Clear();
+
+		uint keep_blocks = CeilDiv(keep_nodes, BLOCK_SIZE);
+		while (m_blocks.size() > keep_blocks) {
+			free(m_blocks.back());
+			m_blocks.pop_back();
+			CNodeArenaStats::s_blocks_freed++;
+		}
+	}
+
+	/**
+	 * Make sure there is memory for the given number of nodes.
+	 * @param nodes Number of nodes.
+	 */
+	void Reserve(uint nodes)
+	{
+		uint blocks = CeilDiv(nodes, BLOCK_SIZE);
+		m_blocks.reserve(blocks);
+		while (m_blocks.size() < blocks) {
+			m_blocks.push_back(MallocT<Titem_>(BLOCK_SIZE));
+			CNodeArenaStats::s_blocks_allocated++;
+		}
+	}
+
+public:
+	CNodeArenaT() : m_open_queue(2048), m_count(0) {}
+
+	~CNodeArenaT()
+	{
+		Reset(0);
+	}
+
+	/**
+	 * Take an unused arena of the current thread, or create one sized for recent searches.
+	 * @return The arena, to be given back with Release.
+	 */
+	static CNodeArenaT *Acquire()
+	{
+		FreeList &free_list = GetFreeList();
+		CNodeArenaStats::OutputDaily();
+		CNodeArenaStats::s_searches++;
+		if (!free_list.arenas.empty()) {
+			CNodeArenaT *arena = free_list.arenas.back().release();
+			free_list.arenas.pop_back();
+			CNodeArenaStats::s_reused++;
+			return arena;
+		}
+		CNodeArenaT *arena = new CNodeArenaT();
+		arena->Reserve(free_list.recent_peak);
+		return arena;
+	}
+
+	/**
+	 * Give an arena back to the current thread once its search is done.
+	 * @param arena The arena, from Acquire.
+	 */
+	static void Release(CNodeArenaT *arena)
+	{
+		FreeList &free_list = GetFreeList();
+		uint used = arena->Length();
+		CNodeArenaStats::RecordSearch(used);
+
+		/* Follow growth immediately, but shrink slowly. */
+		free_list.recent_peak = max(used, free_list.recent_peak - free_list.recent_peak / 16);
+		arena->Reset(free_list.recent_peak + free_list.recent_peak / 4);
+		free_list.arenas.emplace_back(arena);
+	}
+
+	/** allocate and construct new item */
+	inline Titem_ *AppendC()
+	{
+		if (m_count == m_blocks.size() * BLOCK_SIZE) Reserve(m_count + 1);
+		Titem_ *item = &(*this)[m_count++];
+		return new (item) Titem_;
+	}
+
+	/** Return actual number of items */
+	inline uint Length() const
+	{
+		return m_count;
+	}
+
+	/** indexed access (non-const) */
+	inline Titem_ &operator[](uint index)
+	{
+		return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	/** indexed access (const) */
+	inline const Titem_ &operator[](uint index) const
+	{
+		return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	/**
+	 * Helper for creating a human readable output of this data.
+	 * @param dmp The location to dump to.
+	 */
+	template <typename D> void Dump(D &dmp) const
+	{
+		dmp.WriteLine("num_items = %d", m_count);
+		CStrA name;
+		for (uint i = 0; i < m_count; i++) {
+			name.Format("item[%d]", i);
+			dmp.WriteStructT(name.Data(), &(*this)[i]);
+		}
+	}
+};
 
 /**
  * Hash table based node list multi-container class.
@@ -26,21 +213,21 @@ class CNodeList_HashTableT {
 public:
 	typedef Titem_ Titem;                                        ///< Make #Titem_ visible from outside of class.
 	typedef typename Titem_::Key Key;                            ///< Make Titem_::Key a property of #HashTable.
-	typedef SmallArray<Titem_, 65536, 256> CItemArray;           ///< Type that we will use as item container.
+	typedef CNodeArenaT<Titem_> CItemArena;                      ///< Type that we will use as item container.
 	typedef CHashTableT<Titem_, Thash_bits_open_  > COpenList;   ///< How pointers to open nodes will be stored.
 	typedef CHashTableT<Titem_, Thash_bits_closed_> CClosedList; ///< How pointers to closed nodes will be stored.
 	typedef CBinaryHeapT<Titem_> CPriorityQueue;                 ///< How the priority queue will be managed.
 
 protected:
-	CItemArray      m_arr;        ///< Here we store full item data (Titem_).
+	CItemArena     *m_arena;      ///< Here we store full item data (Titem_) and the priority queue of pointers to open item data.
 	COpenList       m_open;       ///< Hash table of pointers to open item data.
 	CClosedList     m_closed;     ///< Hash table of pointers to closed item data.
-	CPriorityQueue  m_open_queue; ///< Priority queue of pointers to open item data.
+	CPriorityQueue &m_open_queue; ///< Priority queue of pointers to open item data.
 	Titem          *m_new_node;   ///< New open node under construction.
 
 public:
 	/** default constructor */
-	CNodeList_HashTableT() : m_open_queue(2048)
+	CNodeList_HashTableT() : m_arena(CItemArena::Acquire()), m_open_queue(m_arena->m_open_queue)
 	{
 		m_new_node = NULL;
 	}
@@ -48,8 +235,12 @@ public:
 	/** destructor */
 	~CNodeList_HashTableT()
 	{
+		CItemArena::Release(m_arena);
 	}
 
+	CNodeList_HashTableT(const CNodeList_HashTableT &) = delete;
+	CNodeList_HashTableT &operator=(const CNodeList_HashTableT &) = delete;
+
 	/** return number of open nodes */
 	inline int OpenCount()
 	{
@@ -65,7 +256,7 @@ public:
 	/** allocate new data item from m_arr */
 	inline Titem_ *CreateNewNode()
 	{
-		if (m_new_node == NULL) m_new_node = m_arr.AppendC();
+		if (m_new_node == NULL) m_new_node = m_arena->AppendC();
 		return m_new_node;
 	}
 
@@ -143,19 +334,19 @@ public:
 	/** The number of items. */
 	inline int TotalCount()
 	{
-		return m_arr.Length();
+		return m_arena->Length();
 	}
 
 	/** Get a particular item. */
 	inline Titem_& ItemAt(int idx)
 	{
-		return m_arr[idx];
+		return (*m_arena)[idx];
 	}
 
 	/** Helper for creating output of this array. */
 	template <class D> void Dump(D &dmp) const
 	{
-		dmp.WriteStructT("m_arr", &m_arr);
+		dmp.WriteStructT("m_arr", m_arena);
 	}
 };
 
@@ -17,6 +17,9 @@
 #include "../../vehicle_type.h"
 #include "../pathfinder_type.h"
 
+struct RoadVehPathCache;
+struct RoadVehPathLookahead;
+
 /**
  * Finds the best path for given ship using YAPF.
  * @param v        the ship that needs to find a path
@@ -42,9 +45,18 @@ bool YapfShipCheckReverse(const Ship *v);
  * @param enterdir  diagonal direction which the RV will enter this new tile from
  * @param trackdirs available trackdirs on the new tile (to choose from)
  * @param path_found [out] Whether a path has been found (true) or has been guessed (false)
+ * @param path_cache [out] The choices at the next junctions, starting with this one, if a path has been found
  * @return          the best trackdir for next turn or INVALID_TRACKDIR if the path could not be found
  */
-Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found);
+Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found, RoadVehPathCache &path_cache);
+
+/**
+ * Finds the choices of road vehicles at the junctions after the last one in their path caches.
+ * This only reads the game state, so several calls may run concurrently.
+ * @param requests The searches to do, the results are stored in them.
+ * @param count    Number of searches.
+ */
+void YapfRoadVehicleFindPathsAhead(RoadVehPathLookahead *requests, uint count);
 
 /**
  * Finds the best path for given train using YAPF.
@@ -14,8 +14,9 @@
 
 #include "../../debug.h"
 #include "../../settings_type.h"
+#include <atomic>
 
-extern int _total_pf_time_us;
+extern std::atomic<int> _total_pf_time_us;
 
 /**
  * CYapfBaseT - A-star type path finder base class.
@@ -109,6 +110,12 @@ public:
 		return *m_settings;
 	}
 
+	/** set the maximum number of nodes to visit, overriding the setting; 0 means no limit */
+	inline void SetMaxSearchNodes(int max_search_nodes)
+	{
+		m_max_search_nodes = max_search_nodes;
+	}
+
 	/**
 	 * Main pathfinder routine:
 	 *   - set startup node(s)
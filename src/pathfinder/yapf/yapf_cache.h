@@ -21,4 +21,10 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that the road layout (or a road stop or depot) has changed.
+ * @param tile the tile that is changed, or INVALID_TILE if all cached road segments are invalid
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
 #endif /* YAPF_CACHE_H */
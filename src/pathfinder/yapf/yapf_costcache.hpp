@@ -13,6 +13,10 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include "../../tilearea_type.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -77,7 +81,7 @@ public:
 	 */
 	inline bool PfNodeCacheFetch(Node &n)
 	{
-		CacheKey key(n.GetKey());
+		CacheKey key(Yapf().PfNodeCacheKey(n));
 		Yapf().ConnectNodeToCachedData(n, *new (m_local_cache.Append()) CachedData(key));
 		return false;
 	}
@@ -93,26 +97,74 @@ public:
 
 
 /**
- * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
- *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ * Base class for segment cost cache providers. Contains the lists of all segment
+ *  cost caches per transport type and static notification function called whenever
+ *  the track or road layout changes, which records the changed tile in each cache.
+ *  The caches evict the segments near the changed tiles the next time they are used.
+ *  It is implemented as base class because it needs to be shared between all
+ *  rail and road YAPF types (one list of caches, one notification function).
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	static const uint REGION_BITS = 4;              ///< Segments are indexed by regions of 2^REGION_BITS x 2^REGION_BITS tiles.
+	static const uint MAX_CHANGED_TILES = 4096;     ///< Number of changed tiles after which the cache is flushed completely instead.
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	static std::vector<CSegmentCostCacheBase *> s_caches[TRANSPORT_WATER]; ///< All segment cost caches, for rail and road.
+
+	static uint  s_stats_hits;                      ///< Segments found in a global cache since the last statistics output.
+	static uint  s_stats_misses;                    ///< Segments not found in a global cache since the last statistics output.
+	static uint  s_stats_evicted;                   ///< Segments evicted because of nearby track layout changes since the last statistics output.
+	static uint  s_stats_flushes;                   ///< Complete flushes of a cache since the last statistics output.
+
+	TransportType m_transport_type;                 ///< Transport type of the cached segments.
+	std::vector<TileIndex> m_changed_tiles;         ///< Tiles changed since the cache was last used.
+	bool         m_flush_all;                       ///< Whether the whole cache has to be flushed the next time it is used.
+
+	inline CSegmentCostCacheBase(TransportType tt) : m_transport_type(tt), m_flush_all(false)
+	{
+		s_caches[tt].push_back(this);
+	}
+
+	inline ~CSegmentCostCacheBase()
+	{
+		std::vector<CSegmentCostCacheBase *> &caches = s_caches[m_transport_type];
+		caches.erase(std::find(caches.begin(), caches.end(), this));
+	}
+
+	/**
+	 * Record a layout change in all caches of a transport type.
+	 * @param tt Transport type whose layout changed.
+	 * @param tile Changed tile, or INVALID_TILE to flush all caches completely.
+	 */
+	static void NotifyLayoutChange(TransportType tt, TileIndex tile)
+	{
+		for (CSegmentCostCacheBase *cache : s_caches[tt]) {
+			if (cache->m_flush_all) continue;
+			if (tile == INVALID_TILE || cache->m_changed_tiles.size() >= MAX_CHANGED_TILES) {
+				cache->m_flush_all = true;
+				cache->m_changed_tiles.clear();
+			} else {
+				cache->m_changed_tiles.push_back(tile);
+			}
+		}
+	}
+
+	/**
+	 * Get the index of the region a tile coordinate is in.
+	 * @param x X coordinate of the tile.
+	 * @param y Y coordinate of the tile.
+	 * @return Region index.
+	 */
+	static inline uint32 GetRegion(uint x, uint y)
 	{
-		s_rail_change_counter++;
+		return ((y >> REGION_BITS) << 16) | (x >> REGION_BITS);
 	}
 };
 
 
 /**
  * CSegmentCostCacheT - template class providing hash-map and storage (heap)
- *  of Tsegment structures. Each rail node contains pointer to the segment
+ *  of Tsegment structures. Each rail or road node contains pointer to the segment
  *  that contains cached (or non-cached) segment cost information. Nodes can
  *  differ by key type, but they use the same segment type. Segment key should
  *  be always the same (TileIndex + DiagDirection) that represent the beginning
@@ -127,17 +179,81 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
+	typedef std::unordered_map<uint32, std::vector<Key> > RegionIndex;
 
 	HashTable    m_map;
 	Heap         m_heap;
+	RegionIndex  m_regions;                ///< keys of the cached segments by the regions their tiles are in
 
-	inline CSegmentCostCacheT() {}
+	inline CSegmentCostCacheT() : CSegmentCostCacheBase(Tsegment::TT) {}
 
 	/** flush (clear) the cache */
 	inline void Flush()
 	{
 		m_map.Clear();
 		m_heap.Clear();
+		m_regions.clear();
+		m_changed_tiles.clear();
+		m_flush_all = false;
+		s_stats_flushes++;
+	}
+
+	/**
+	 * Index a cached segment by the regions it covers, so it is evicted when
+	 *  a tile in or next to it changes.
+	 * @param key Key of the segment.
+	 * @param area Bounding box of the tiles of the segment.
+	 */
+	void AddSegmentArea(const Key &key, const TileArea &area)
+	{
+		uint x0 = TileX(area.tile) >> REGION_BITS;
+		uint y0 = TileY(area.tile) >> REGION_BITS;
+		uint x1 = (TileX(area.tile) + area.w - 1) >> REGION_BITS;
+		uint y1 = (TileY(area.tile) + area.h - 1) >> REGION_BITS;
+		for (uint y = y0; y <= y1; y++) {
+			for (uint x = x0; x <= x1; x++) {
+				m_regions[GetRegion(x << REGION_BITS, y << REGION_BITS)].push_back(key);
+			}
+		}
+	}
+
+	/**
+	 * Evict all segments with a tile in or next to a changed tile.
+	 * @param tile The changed tile.
+	 */
+	void InvalidateTile(TileIndex tile)
+	{
+		/* The end of a segment depends on the tile after its last tile too. */
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		uint x0 = (x > 0 ? x - 1 : 0) >> REGION_BITS;
+		uint x1 = min(x + 1, MapMaxX()) >> REGION_BITS;
+		uint y0 = (y > 0 ? y - 1 : 0) >> REGION_BITS;
+		uint y1 = min(y + 1, MapMaxY()) >> REGION_BITS;
+		for (uint ry = y0; ry <= y1; ry++) {
+			for (uint rx = x0; rx <= x1; rx++) {
+				typename RegionIndex::iterator it = m_regions.find(GetRegion(rx << REGION_BITS, ry << REGION_BITS));
+				if (it == m_regions.end()) continue;
+				/* Keys of segments which have been evicted already are simply skipped. */
+				for (const Key &key : it->second) {
+					if (m_map.TryPop(key) != NULL) s_stats_evicted++;
+				}
+				m_regions.erase(it);
+			}
+		}
+	}
+
+	/** Apply the track layout changes recorded since the cache was last used. */
+	void ProcessChanges()
+	{
+		if (!m_flush_all) {
+			for (TileIndex tile : m_changed_tiles) InvalidateTile(tile);
+			m_changed_tiles.clear();
+
+			/* Evicted segments stay in the heap; start over when they take up most of it. */
+			if (m_heap.Length() < (uint)(1 << C_HASH_BITS) || m_heap.Length() < 2 * (uint)m_map.Count()) return;
+		}
+		Flush();
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -171,9 +287,10 @@ public:
 	typedef CSegmentCostCacheT<CachedData> Cache;
 
 protected:
-	Cache &m_global_cache;
+	Cache *m_global_cache;         ///< the global cache, NULL until it is first used
+	bool   m_global_cache_allowed; ///< whether the global cache may be used
 
-	inline CYapfSegmentCostCacheGlobalT() : m_global_cache(stGetGlobalCache()) {};
+	inline CYapfSegmentCostCacheGlobalT() : m_global_cache(NULL), m_global_cache_allowed(true) {};
 
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
@@ -183,42 +300,74 @@ protected:
 
 	inline static Cache& stGetGlobalCache()
 	{
-		static int last_rail_change_counter = 0;
 		static Date last_date = 0;
 		static Cache C;
 
 		/* some statistics */
 		if (last_date != _date) {
 			last_date = _date;
-			DEBUG(yapf, 2, "Pf time today: %5d ms", _total_pf_time_us / 1000);
-			_total_pf_time_us = 0;
+			DEBUG(yapf, 2, "Pf time today: %5d ms", _total_pf_time_us.exchange(0) / 1000);
+
+			uint lookups = Cache::s_stats_hits + Cache::s_stats_misses;
+			DEBUG(yapf, 2, "Segment cache today: %u hits, %u misses (%u%% hit rate), %u evicted, %u flushes",
+					Cache::s_stats_hits, Cache::s_stats_misses, lookups == 0 ? 0 : Cache::s_stats_hits * 100 / lookups,
+					Cache::s_stats_evicted, Cache::s_stats_flushes);
+			Cache::s_stats_hits = 0;
+			Cache::s_stats_misses = 0;
+			Cache::s_stats_evicted = 0;
+			Cache::s_stats_flushes = 0;
 		}
 
-		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
-			last_rail_change_counter = Cache::s_rail_change_counter;
-			C.Flush();
-		}
+		/* evict the segments affected by track layout changes */
+		C.ProcessChanges();
 		return C;
 	}
 
 public:
+	/**
+	 * Only use local segment cost data. The global cache isn't thread safe, so
+	 *  this has to be called for searches which don't run on the main thread.
+	 */
+	inline void DisableGlobalCache()
+	{
+		m_global_cache_allowed = false;
+	}
+
 	/**
 	 * Called by YAPF to attach cached or local segment cost data to the given node.
 	 *  @return true if globally cached data were used or false if local data was used
 	 */
 	inline bool PfNodeCacheFetch(Node &n)
 	{
-		if (!Yapf().CanUseGlobalCache(n)) {
+		if (!m_global_cache_allowed || !Yapf().CanUseGlobalCache(n)) {
 			return Tlocal::PfNodeCacheFetch(n);
 		}
-		CacheKey key(n.GetKey());
+		if (m_global_cache == NULL) m_global_cache = &stGetGlobalCache();
+		CacheKey key(Yapf().PfNodeCacheKey(n));
 		bool found;
-		CachedData &item = m_global_cache.Get(key, &found);
+		CachedData &item = m_global_cache->Get(key, &found);
 		Yapf().ConnectNodeToCachedData(n, item);
+		if (found) {
+			Cache::s_stats_hits++;
+		} else {
+			Cache::s_stats_misses++;
+		}
 		return found;
 	}
 
+	/**
+	 * Called by YAPF when the cost of a segment has been calculated, to index
+	 *  the segment by the tiles it covers if it is kept in the global cache.
+	 * @param n Node of the segment.
+	 * @param area Bounding box of the tiles of the segment.
+	 */
+	inline void PfNodeCacheSegmentArea(Node &n, const TileArea &area)
+	{
+		if (m_global_cache == NULL) return;
+		const CacheKey &key = n.m_segment->GetKey();
+		if (m_global_cache->m_map.Find(key) == n.m_segment) m_global_cache->AddSegmentArea(key, area);
+	}
+
 	/**
 	 * Called by YAPF to flush the cached segment cost data back into cache storage.
 	 *  Current cache implementation doesn't use that.
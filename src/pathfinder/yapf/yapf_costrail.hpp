@@ -473,6 +473,9 @@ public:
 
 		TrackFollower tf_local(v, Yapf().GetCompatibleRailTypes(), &Yapf().m_perf_ts_cost);
 
+		/* Tiles of the segment, for invalidating it when any of them changes. */
+		TileArea segment_area(n.m_key.m_tile, 1, 1);
+
 		if (!has_parent) {
 			/* We will jump to the middle of the cost calculator assuming that segment cache is not used. */
 			assert(!is_cached_segment);
@@ -520,6 +523,7 @@ public:
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
 			/* All other tile costs will be calculated here. */
+			segment_area.Add(cur.tile);
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
 			/* If we skipped some tunnel/bridge/station tiles, add their base cost */
@@ -719,6 +723,7 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			segment.m_end_segment_reason = end_segment_reason & ESRB_CACHED_MASK;
 			/* Save end of segment back to the node. */
 			n.SetLastTileTrackdir(cur.tile, cur.td);
+			Yapf().PfNodeCacheSegmentArea(n, segment_area);
 		}
 
 		/* Do we have an excuse why not to continue pathfinding in this direction? */
@@ -766,6 +771,11 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			&& (n.m_parent->m_num_signals_passed >= m_sig_look_ahead_costs.Size());
 	}
 
+	inline typename CachedData::Key PfNodeCacheKey(const Node &n) const
+	{
+		return typename CachedData::Key(n.GetKey());
+	}
+
 	inline void ConnectNodeToCachedData(Node &n, CachedData &ci)
 	{
 		n.m_segment = &ci;
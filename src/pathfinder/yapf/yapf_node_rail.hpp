@@ -65,6 +65,7 @@ struct CYapfRailSegmentKey
 struct CYapfRailSegment
 {
 	typedef CYapfRailSegmentKey Key;
+	static const TransportType TT = TRANSPORT_RAIL; ///< transport type of the segment cost cache
 
 	CYapfRailSegmentKey    m_key;
 	TileIndex              m_last_tile;
@@ -12,19 +12,120 @@
 #ifndef YAPF_NODE_ROAD_HPP
 #define YAPF_NODE_ROAD_HPP
 
+/**
+ * Key for cached segment cost for road YAPF. Which tiles a road vehicle can
+ *  enter depends on its owner and road types, so these are part of the key.
+ */
+struct CYapfRoadSegmentKey
+{
+	TileIndex m_tile;
+	Trackdir  m_td;
+	Owner     m_owner;
+	RoadTypes m_roadtypes;
+
+	inline CYapfRoadSegmentKey(const CYapfNodeKeyExitDir &node_key, Owner owner, RoadTypes roadtypes)
+		: m_tile(node_key.m_tile)
+		, m_td(node_key.m_td)
+		, m_owner(owner)
+		, m_roadtypes(roadtypes)
+	{}
+
+	inline int32 CalcHash() const
+	{
+		return (((int)m_tile) << 4) | m_td;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return m_tile;
+	}
+
+	inline Trackdir GetTrackdir() const
+	{
+		return m_td;
+	}
+
+	inline bool operator==(const CYapfRoadSegmentKey &other) const
+	{
+		return m_tile == other.m_tile && m_td == other.m_td && m_owner == other.m_owner && m_roadtypes == other.m_roadtypes;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteTile("tile", GetTile());
+		dmp.WriteEnumT("td", GetTrackdir());
+		dmp.WriteLine("owner = %d", m_owner);
+		dmp.WriteLine("roadtypes = %d", m_roadtypes);
+	}
+};
+
+/** cached segment cost for road YAPF */
+struct CYapfRoadSegment
+{
+	typedef CYapfRoadSegmentKey Key;
+	static const TransportType TT = TRANSPORT_ROAD; ///< transport type of the segment cost cache
+
+	CYapfRoadSegmentKey    m_key;
+	TileIndex              m_last_tile;
+	Trackdir               m_last_td;
+	int                    m_cost;      ///< cost of the segment, -1 if not calculated (yet)
+	CYapfRoadSegment      *m_hash_next;
+
+	inline CYapfRoadSegment(const CYapfRoadSegmentKey &key)
+		: m_key(key)
+		, m_last_tile(INVALID_TILE)
+		, m_last_td(INVALID_TRACKDIR)
+		, m_cost(-1)
+		, m_hash_next(NULL)
+	{}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return m_key.GetTile();
+	}
+
+	inline CYapfRoadSegment *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(CYapfRoadSegment *next)
+	{
+		m_hash_next = next;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteStructT("m_key", &m_key);
+		dmp.WriteTile("m_last_tile", m_last_tile);
+		dmp.WriteEnumT("m_last_td", m_last_td);
+		dmp.WriteLine("m_cost = %d", m_cost);
+	}
+};
+
 /** Yapf Node for road YAPF */
 template <class Tkey_>
 struct CYapfRoadNodeT : CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > {
 	typedef CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > base;
+	typedef CYapfRoadSegment CachedData;
 
+	CYapfRoadSegment *m_segment;
 	TileIndex m_segment_last_tile;
 	Trackdir  m_segment_last_td;
+	bool      m_is_choice;          ///< whether the vehicle had a choice of trackdirs when entering the tile of this node
 
 	void Set(CYapfRoadNodeT *parent, TileIndex tile, Trackdir td, bool is_choice)
 	{
 		base::Set(parent, tile, td, is_choice);
+		m_segment = NULL;
 		m_segment_last_tile = tile;
 		m_segment_last_td = td;
+		m_is_choice = is_choice;
 	}
 };
 
@@ -64,7 +64,7 @@ template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
 	fclose(f2);
 }
 
-int _total_pf_time_us = 0;
+std::atomic<int> _total_pf_time_us(0);
 
 template <class Types>
 class CYapfReserveTrack
@@ -154,6 +154,23 @@ private:
 		return (tile != m_res_dest || td != m_res_dest_td) && (tile != m_res_fail_tile || td != m_res_fail_td);
 	}
 
+	/** Notify the segment cost caches of a reserved track/platform, as reservations change segment costs. */
+	bool NotifyReservedTrack(TileIndex tile, Trackdir td)
+	{
+		/* Reservations don't change road segment costs, so level crossings don't concern road vehicles here. */
+		if (IsRailStationTile(tile)) {
+			TileIndex     start = tile;
+			TileIndexDiff diff = TileOffsByDiagDir(TrackdirToExitdir(ReverseTrackdir(td)));
+			do {
+				CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_RAIL, tile);
+				tile = TILE_ADD(tile, diff);
+			} while (IsCompatibleTrainStationTile(tile, start) && tile != m_origin_tile);
+		} else {
+			CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_RAIL, tile);
+		}
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 public:
 	/** Set the target to where the reservation should be extended. */
 	inline void SetReservationTarget(Node *node, TileIndex tile, Trackdir td)
@@ -209,8 +226,8 @@ public:
 
 		if (target != NULL) target->okay = true;
 
-		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		for (Node *node = m_res_node; node->m_parent != NULL; node = node->m_parent) {
+			node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::NotifyReservedTrack);
 		}
 
 		return true;
@@ -709,10 +726,22 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
-int CSegmentCostCacheBase::s_rail_change_counter = 0;
+std::vector<CSegmentCostCacheBase *> CSegmentCostCacheBase::s_caches[TRANSPORT_WATER];
+uint CSegmentCostCacheBase::s_stats_hits = 0;
+uint CSegmentCostCacheBase::s_stats_misses = 0;
+uint CSegmentCostCacheBase::s_stats_evicted = 0;
+uint CSegmentCostCacheBase::s_stats_flushes = 0;
+
+std::atomic<uint> CNodeArenaStats::s_searches(0);
+std::atomic<uint> CNodeArenaStats::s_reused(0);
+std::atomic<uint> CNodeArenaStats::s_blocks_allocated(0);
+std::atomic<uint> CNodeArenaStats::s_blocks_freed(0);
+std::atomic<uint> CNodeArenaStats::s_peak_nodes(0);
+std::atomic<Date> CNodeArenaStats::s_last_date(0);
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
-	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_RAIL, tile);
+	/* Level crossings are part of road segments too. */
+	if (tile != INVALID_TILE && IsLevelCrossingTile(tile)) YapfNotifyRoadLayoutChange(tile);
 }
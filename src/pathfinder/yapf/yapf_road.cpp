@@ -11,6 +11,7 @@
 
 #include "../../stdafx.h"
 #include "yapf.hpp"
+#include "yapf_cache.h"
 #include "yapf_node_road.hpp"
 #include "../../roadstop_base.h"
 
@@ -33,6 +34,7 @@ public:
 	typedef typename Types::TrackFollower TrackFollower; ///< track follower helper
 	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
 	typedef typename Node::Key Key;    ///< key to hash tables
+	typedef typename Node::CachedData CachedData;
 
 protected:
 	/** to access inherited path finder */
@@ -114,57 +116,84 @@ public:
 	{
 		/* this is to handle the case where the starting tile is a junction custom bridge head,
 		 * and we have advanced across the bridge in the initial step */
-		int segment_cost = tf->m_tiles_skipped * YAPF_TILE_LENGTH;
+		int entry_cost = tf->m_tiles_skipped * YAPF_TILE_LENGTH;
 
-		uint tiles = 0;
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TileIndex tile = n.m_key.m_tile;
 		Trackdir trackdir = n.m_key.m_td;
-		for (;;) {
-			/* base tile cost depending on distance between edges */
-			segment_cost += Yapf().OneTileCost(tile, trackdir);
-
-			const RoadVehicle *v = Yapf().GetVehicle();
-			/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
-			if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
-
-			/* stop if we have just entered the depot */
-			if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
-				/* next time we will reverse and leave the depot */
-				break;
-			}
+		int segment_cost = 0;
+
+		CachedData &segment = *n.m_segment;
+		if (segment.m_cost >= 0) {
+			/* the segment has been walked before, reuse its end and cost */
+			tile = segment.m_last_tile;
+			trackdir = segment.m_last_td;
+			segment_cost = segment.m_cost;
+		} else {
+			/* Road stops and depots have costs depending on their occupancy or may be the destination,
+			 * and bridge speed limits depend on the vehicle. Segments with those aren't cached. */
+			bool is_cacheable = true;
+			TileArea segment_area(tile, 1, 1);
+
+			uint tiles = 0;
+			for (;;) {
+				segment_area.Add(tile);
+				if (IsTileType(tile, MP_STATION) || IsRoadDepotTile(tile)) is_cacheable = false;
+
+				/* base tile cost depending on distance between edges */
+				segment_cost += Yapf().OneTileCost(tile, trackdir);
+
+				const RoadVehicle *v = Yapf().GetVehicle();
+				/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
+				if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
+
+				/* stop if we have just entered the depot */
+				if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
+					/* next time we will reverse and leave the depot */
+					break;
+				}
+
+				/* if there are no reachable trackdirs on new tile, we have end of road */
+				TrackFollower F(Yapf().GetVehicle());
+				if (!F.Follow(tile, trackdir)) break;
 
-			/* if there are no reachable trackdirs on new tile, we have end of road */
-			TrackFollower F(Yapf().GetVehicle());
-			if (!F.Follow(tile, trackdir)) break;
+				/* if we skipped some tunnel tiles, add their cost */
+				/* with custom bridge heads, this cost must be added before checking if the segment has ended */
+				segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
+				tiles += F.m_tiles_skipped + 1;
 
-			/* if we skipped some tunnel tiles, add their cost */
-			/* with custom bridge heads, this cost must be added before checking if the segment has ended */
-			segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
-			tiles += F.m_tiles_skipped + 1;
+				/* if there are more trackdirs available & reachable, we are at the end of segment */
+				if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
 
-			/* if there are more trackdirs available & reachable, we are at the end of segment */
-			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
+				Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
 
-			Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
+				/* stop if RV is on simple loop with no junctions */
+				if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
 
-			/* stop if RV is on simple loop with no junctions */
-			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
+				/* add hilly terrain penalty */
+				segment_cost += Yapf().SlopeCost(tile, F.m_new_tile, trackdir);
 
-			/* add hilly terrain penalty */
-			segment_cost += Yapf().SlopeCost(tile, F.m_new_tile, trackdir);
+				/* add min/max speed penalties */
+				int min_speed = 0;
+				int max_veh_speed = v->GetDisplayMaxSpeed();
+				int max_speed = F.GetSpeedLimit(&min_speed);
+				if (max_speed < max_veh_speed) segment_cost += 1 * (max_veh_speed - max_speed);
+				if (min_speed > max_veh_speed) segment_cost += 10 * (min_speed - max_veh_speed);
+				if (max_speed != INT_MAX || min_speed > 0) is_cacheable = false;
 
-			/* add min/max speed penalties */
-			int min_speed = 0;
-			int max_veh_speed = v->GetDisplayMaxSpeed();
-			int max_speed = F.GetSpeedLimit(&min_speed);
-			if (max_speed < max_veh_speed) segment_cost += 1 * (max_veh_speed - max_speed);
-			if (min_speed > max_veh_speed) segment_cost += 10 * (min_speed - max_veh_speed);
+				/* move to the next tile */
+				tile = F.m_new_tile;
+				trackdir = new_td;
+				if (tiles > MAX_RV_PF_TILES) break;
+			}
 
-			/* move to the next tile */
-			tile = F.m_new_tile;
-			trackdir = new_td;
-			if (tiles > MAX_RV_PF_TILES) break;
+			if (is_cacheable) {
+				/* write back the segment information so it can be reused the next time */
+				segment.m_last_tile = tile;
+				segment.m_last_td = trackdir;
+				segment.m_cost = segment_cost;
+				Yapf().PfNodeCacheSegmentArea(n, segment_area);
+			}
 		}
 
 		/* save end of segment back to the node */
@@ -173,9 +202,29 @@ public:
 
 		/* save also tile cost */
 		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
-		n.m_cost = parent_cost + segment_cost;
+		n.m_cost = parent_cost + entry_cost + segment_cost;
 		return true;
 	}
+
+	/**
+	 * Whether the segment of a node may be taken from or stored in the global cache.
+	 * Segments are only cached when they can't contain the destination.
+	 */
+	inline bool CanUseGlobalCache(Node &n)
+	{
+		return n.m_parent != NULL && Yapf().IsDestinationCacheable();
+	}
+
+	inline typename CachedData::Key PfNodeCacheKey(const Node &n)
+	{
+		const RoadVehicle *v = Yapf().GetVehicle();
+		return typename CachedData::Key(n.GetKey(), v->owner, v->compatible_roadtypes);
+	}
+
+	inline void ConnectNodeToCachedData(Node &n, CachedData &ci)
+	{
+		n.m_segment = &ci;
+	}
 };
 
 
@@ -201,6 +250,12 @@ public:
 		return bDest;
 	}
 
+	/** Depots are never part of a cached segment, so cached segments can't skip the destination. */
+	inline bool IsDestinationCacheable() const
+	{
+		return true;
+	}
+
 	inline bool PfDetectDestinationTile(TileIndex tile, Trackdir trackdir)
 	{
 		return IsRoadDepotTile(tile);
@@ -264,6 +319,15 @@ public:
 		return PfDetectDestinationTile(n.m_segment_last_tile, n.m_segment_last_td);
 	}
 
+	/**
+	 * Whether cached segments may be used. Road stops and depots are never part of
+	 * a cached segment, so only other destination tiles could be skipped by them.
+	 */
+	inline bool IsDestinationCacheable() const
+	{
+		return m_dest_station != INVALID_STATION || (m_destTile != INVALID_TILE && IsRoadDepotTile(m_destTile));
+	}
+
 	inline bool PfDetectDestinationTile(TileIndex tile, Trackdir trackdir)
 	{
 		if (m_dest_station != INVALID_STATION) {
@@ -345,13 +409,69 @@ public:
 		return 'r';
 	}
 
-	static Trackdir stChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
+	/**
+	 * Store the junctions along the found path where the vehicle has to choose between trackdirs.
+	 * @param pNode Last node of the path.
+	 * @param tiles [out] Junction tiles, the one closest to the origin last.
+	 * @param tds [out] Trackdirs to take at the junctions.
+	 * @param include_origin Whether the origin is a junction too.
+	 */
+	static void StoreJunctionChoices(const Node *pNode, std::vector<TileIndex> &tiles, std::vector<byte> &tds, bool include_origin)
+	{
+		tiles.clear();
+		tds.clear();
+		for (; pNode != NULL; pNode = pNode->m_parent) {
+			if (pNode->m_parent == NULL ? include_origin : pNode->m_is_choice) {
+				tiles.push_back(pNode->GetTile());
+				tds.push_back(pNode->GetTrackdir());
+			}
+		}
+		if (tds.size() > ROADVEH_PATH_CACHE_SEGMENTS) {
+			/* only keep the junctions closest to the origin */
+			size_t excess = tds.size() - ROADVEH_PATH_CACHE_SEGMENTS;
+			tiles.erase(tiles.begin(), tiles.begin() + excess);
+			tds.erase(tds.begin(), tds.begin() + excess);
+		}
+	}
+
+	static Trackdir stChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found, RoadVehPathCache &path_cache)
 	{
-		Tpf pf;
-		return pf.ChooseRoadTrack(v, tile, enterdir, path_found);
+		Tpf pf1;
+		Trackdir result1 = pf1.ChooseRoadTrack(v, tile, enterdir, path_found, path_cache);
+
+		if (_debug_yapfdesync_level > 0 || _debug_desync_level >= 2) {
+			/* compare with a search which doesn't use the global segment cache */
+			Tpf pf2;
+			pf2.DisableGlobalCache();
+			bool path_found2;
+			RoadVehPathCache path_cache2;
+			Trackdir result2 = pf2.ChooseRoadTrack(v, tile, enterdir, path_found2, path_cache2);
+			stDesyncCheck(pf1, pf2, result1, result2, "CACHE ERROR: ChooseRoadTrack()");
+		}
+
+		return result1;
+	}
+
+	/**
+	 * Report differences between a search using the global segment cache and one that doesn't.
+	 * @param pf1 Pathfinder which used the global cache.
+	 * @param pf2 Pathfinder which didn't.
+	 * @param result1 Choice of \a pf1.
+	 * @param result2 Choice of \a pf2.
+	 * @param name Description of the search, for the debug output.
+	 */
+	static void stDesyncCheck(Tpf &pf1, Tpf &pf2, Trackdir result1, Trackdir result2, const char *name)
+	{
+		Node *best1 = pf1.GetBestNode();
+		Node *best2 = pf2.GetBestNode();
+		int cost1 = best1 != NULL ? best1->m_cost : -1;
+		int cost2 = best2 != NULL ? best2->m_cost : -1;
+		if (result1 != result2 || cost1 != cost2) {
+			DEBUG(desync, 0, "%s = [%d, %d], cost = [%d, %d], vehicle = %u", name, result1, result2, cost1, cost2, pf1.GetVehicle()->index);
+		}
 	}
 
-	inline Trackdir ChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
+	inline Trackdir ChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found, RoadVehPathCache &path_cache)
 	{
 		/* Handle special case - when next tile is destination tile.
 		 * However, when going to a station the (initial) destination
@@ -378,6 +498,11 @@ public:
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
 		Node *pNode = Yapf().GetBestNode();
+		if (pNode != NULL && path_found) {
+			/* remember the choices at the next junctions too */
+			StoreJunctionChoices(pNode, path_cache.tile, path_cache.td, true);
+			path_cache.dest_tile = v->dest_tile;
+		}
 		if (pNode != NULL) {
 			/* path was found or at least suggested
 			 * walk through the path back to its origin */
@@ -392,6 +517,29 @@ public:
 		return next_trackdir;
 	}
 
+	static void stFindPathAhead(RoadVehPathLookahead &request)
+	{
+		Tpf pf;
+		pf.FindPathAhead(request);
+	}
+
+	/**
+	 * Find the choices at the junctions after the last cached one.
+	 * This may run on a worker thread, so it must not touch the global segment cache.
+	 * @param request The search to do, the results are stored in it.
+	 */
+	inline void FindPathAhead(RoadVehPathLookahead &request)
+	{
+		Yapf().DisableGlobalCache();
+		Yapf().SetOrigin(request.tile, TrackdirToTrackdirBits(request.td));
+		Yapf().SetDestination(request.v);
+
+		if (!Yapf().FindPath(request.v)) return;
+
+		Node *pNode = Yapf().GetBestNode();
+		if (pNode != NULL) StoreJunctionChoices(pNode, request.tiles, request.tds, false);
+	}
+
 	static uint stDistanceToTile(const RoadVehicle *v, TileIndex tile)
 	{
 		Tpf pf;
@@ -444,8 +592,21 @@ public:
 
 	static FindDepotData stFindNearestDepot(const RoadVehicle *v, TileIndex tile, Trackdir td, int max_distance)
 	{
-		Tpf pf;
-		return pf.FindNearestDepot(v, tile, td, max_distance);
+		Tpf pf1;
+		FindDepotData result1 = pf1.FindNearestDepot(v, tile, td, max_distance);
+
+		if (_debug_yapfdesync_level > 0 || _debug_desync_level >= 2) {
+			/* compare with a search which doesn't use the global segment cache */
+			Tpf pf2;
+			pf2.DisableGlobalCache();
+			FindDepotData result2 = pf2.FindNearestDepot(v, tile, td, max_distance);
+			if (result1.tile != result2.tile || result1.best_length != result2.best_length) {
+				DEBUG(desync, 0, "CACHE ERROR: FindNearestDepot() = [%u, %u], cost = [%u, %u], vehicle = %u",
+						result1.tile, result2.tile, result1.best_length, result2.best_length, v->index);
+			}
+		}
+
+		return result1;
 	}
 
 	/**
@@ -486,7 +647,7 @@ struct CYapfRoad_TypesT
 	typedef CYapfFollowRoadT<Types>           PfFollow;
 	typedef CYapfOriginTileT<Types>           PfOrigin;
 	typedef Tdestination<Types>               PfDestination;
-	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;
+	typedef CYapfSegmentCostCacheGlobalT<Types> PfCache;
 	typedef CYapfCostRoadT<Types>             PfCost;
 };
 
@@ -497,10 +658,10 @@ struct CYapfRoadAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot1, CRoadNod
 struct CYapfRoadAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot2, CRoadNodeListExitDir , CYapfDestinationAnyDepotRoadT> > {};
 
 
-Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found)
+Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found, RoadVehPathCache &path_cache)
 {
 	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseRoadTrack)(const RoadVehicle*, TileIndex, DiagDirection, bool &path_found);
+	typedef Trackdir (*PfnChooseRoadTrack)(const RoadVehicle*, TileIndex, DiagDirection, bool &path_found, RoadVehPathCache &path_cache);
 	PfnChooseRoadTrack pfnChooseRoadTrack = &CYapfRoad2::stChooseRoadTrack; // default: ExitDir, allow 90-deg
 
 	/* check if non-default YAPF type should be used */
@@ -508,10 +669,26 @@ Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDi
 		pfnChooseRoadTrack = &CYapfRoad1::stChooseRoadTrack; // Trackdir, allow 90-deg
 	}
 
-	Trackdir td_ret = pfnChooseRoadTrack(v, tile, enterdir, path_found);
+	Trackdir td_ret = pfnChooseRoadTrack(v, tile, enterdir, path_found, path_cache);
 	return (td_ret != INVALID_TRACKDIR) ? td_ret : (Trackdir)FindFirstBit2x64(trackdirs);
 }
 
+void YapfRoadVehicleFindPathsAhead(RoadVehPathLookahead *requests, uint count)
+{
+	/* default is YAPF type 2 */
+	typedef void (*PfnFindPathAhead)(RoadVehPathLookahead &);
+	PfnFindPathAhead pfnFindPathAhead = &CYapfRoad2::stFindPathAhead; // default: ExitDir, allow 90-deg
+
+	/* check if non-default YAPF type should be used */
+	if (_settings_game.pf.yapf.disable_node_optimization) {
+		pfnFindPathAhead = &CYapfRoad1::stFindPathAhead; // Trackdir, allow 90-deg
+	}
+
+	for (uint i = 0; i < count; i++) {
+		pfnFindPathAhead(requests[i]);
+	}
+}
+
 FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_distance)
 {
 	TileIndex tile = v->tile;
@@ -531,3 +708,9 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 
 	return pfnFindNearestDepot(v, tile, trackdir, max_distance);
 }
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	InvalidateRoadVehPathCaches(tile);
+	CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_ROAD, tile);
+}
@@ -14,9 +14,97 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "yapf_ship_regions.h"
+
+#include <algorithm>
 
 #include "../../safeguards.h"
 
+static const int NUMBER_OF_WATER_REGIONS_LOOKAHEAD = 4; ///< Number of water regions ahead of the ship the tile level search is limited to.
+
+/** YAPF destination provider for ships, which can also head for an intermediate water region patch. */
+template <class Types>
+class CYapfDestinationTileWaterT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+	typedef typename Node::Key Key;               ///< key to hash tables
+
+protected:
+	TileIndex    m_destTile;                      ///< destination tile
+	TrackdirBits m_destTrackdirs;                 ///< destination trackdir mask
+	bool         m_has_intermediate_dest;         ///< whether the search ends in m_intermediate_dest_region_patch instead
+	TileIndex    m_intermediate_dest_tile;        ///< centre tile of the intermediate water region, for the estimate
+	WaterRegionPatchDesc m_intermediate_dest_region_patch; ///< intermediate destination patch
+
+public:
+	CYapfDestinationTileWaterT() : m_has_intermediate_dest(false) {}
+
+	/** set the destination tile / more trackdirs */
+	void SetDestination(TileIndex tile, TrackdirBits trackdirs)
+	{
+		m_destTile = tile;
+		m_destTrackdirs = trackdirs;
+	}
+
+	/**
+	 * Stop the search as soon as any tile of the given water region patch is reached.
+	 * @param water_region_patch The intermediate destination.
+	 */
+	void SetIntermediateDestination(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_has_intermediate_dest = true;
+		m_intermediate_dest_tile = GetWaterRegionCenterTile(WaterRegionDesc{water_region_patch.x, water_region_patch.y});
+		m_intermediate_dest_region_patch = water_region_patch;
+	}
+
+protected:
+	/** to access inherited path finder */
+	Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Called by YAPF to detect if node ends in the desired destination */
+	inline bool PfDetectDestination(Node &n)
+	{
+		if (m_has_intermediate_dest) return GetWaterRegionPatchInfo(n.GetTile()) == m_intermediate_dest_region_patch;
+		return (n.m_key.m_tile == m_destTile) && ((m_destTrackdirs & TrackdirToTrackdirBits(n.GetTrackdir())) != TRACKDIR_BIT_NONE);
+	}
+
+	/**
+	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
+	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
+	 */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		static const int dg_dir_to_x_offs[] = {-1, 0, 1, 0};
+		static const int dg_dir_to_y_offs[] = {0, 1, 0, -1};
+		if (PfDetectDestination(n)) {
+			n.m_estimate = n.m_cost;
+			return true;
+		}
+
+		TileIndex dest_tile = m_has_intermediate_dest ? m_intermediate_dest_tile : m_destTile;
+		TileIndex tile = n.GetTile();
+		DiagDirection exitdir = TrackdirToExitdir(n.GetTrackdir());
+		int x1 = 2 * TileX(tile) + dg_dir_to_x_offs[(int)exitdir];
+		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
+		int x2 = 2 * TileX(dest_tile);
+		int y2 = 2 * TileY(dest_tile);
+		int dx = abs(x1 - x2);
+		int dy = abs(y1 - y2);
+		int dmin = min(dx, dy);
+		int dxy = abs(dx - dy);
+		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		n.m_estimate = n.m_cost + d;
+		assert(n.m_estimate >= n.m_parent->m_estimate);
+		return true;
+	}
+};
+
 /** Node Follower module of YAPF for ships */
 template <class Types>
 class CYapfFollowShipT
@@ -28,6 +116,8 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	std::vector<WaterRegionPatchDesc> m_water_region_patches; ///< if not empty, only tiles in these patches are searched
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -35,6 +125,15 @@ protected:
 	}
 
 public:
+	/**
+	 * Only search the tiles of the given water region patches.
+	 * @param path Patches the search may enter.
+	 */
+	void RestrictSearch(const std::vector<WaterRegionPatchDesc> &path)
+	{
+		m_water_region_patches = path;
+	}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -44,6 +143,10 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			if (!m_water_region_patches.empty()) {
+				const WaterRegionPatchDesc patch = GetWaterRegionPatchInfo(F.m_new_tile);
+				if (std::find(m_water_region_patches.begin(), m_water_region_patches.end(), patch) == m_water_region_patches.end()) return;
+			}
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -54,10 +157,52 @@ public:
 		return 'w';
 	}
 
+	/**
+	 * Find the first water region patches on the way of a ship to its destination.
+	 * @param v Ship
+	 * @param tile Tile the path starts at
+	 * @param[out] high_level_path The water region patches, starting with the one of \a tile.
+	 *             Empty if the search can't be guided by water regions.
+	 * @return false if the destination is known to be unreachable
+	 */
+	static bool FindHighLevelPath(const Ship *v, TileIndex tile, std::vector<WaterRegionPatchDesc> &high_level_path)
+	{
+		high_level_path.clear();
+
+		/* fall back to a plain search when either end isn't part of a water region patch, e.g. an unusual destination */
+		if (!IsValidTile(v->dest_tile) || GetWaterRegionPatchInfo(v->dest_tile).label == INVALID_WATER_REGION_PATCH) return true;
+		if (GetWaterRegionPatchInfo(tile).label == INVALID_WATER_REGION_PATCH) return true;
+
+		high_level_path = YapfShipFindWaterRegionPath(v, tile, NUMBER_OF_WATER_REGIONS_LOOKAHEAD + 1);
+		return !high_level_path.empty();
+	}
+
+	/**
+	 * Set the destination of a tile level search. When the high level path doesn't reach the
+	 *  destination yet the search only goes as far as its last water region patch.
+	 * @param pf Pathfinder instance
+	 * @param v Ship
+	 * @param high_level_path Result of FindHighLevelPath
+	 * @param restrict Only search the tiles along the high level path
+	 */
+	static void SetShipDestination(Tpf &pf, const Ship *v, const std::vector<WaterRegionPatchDesc> &high_level_path, bool restrict)
+	{
+		/* get available trackdirs on the destination tile */
+		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
+		pf.SetDestination(v->dest_tile, dest_trackdirs);
+		if (high_level_path.size() > (size_t)NUMBER_OF_WATER_REGIONS_LOOKAHEAD) pf.SetIntermediateDestination(high_level_path.back());
+		if (restrict) pf.RestrictSearch(high_level_path);
+	}
+
 	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found)
 	{
-		/* handle special case - when next tile is destination tile */
-		if (tile == v->dest_tile) {
+		std::vector<WaterRegionPatchDesc> high_level_path;
+		bool reachable = (tile == v->dest_tile) || FindHighLevelPath(v, tile, high_level_path);
+
+		/* handle special case - when next tile is destination tile, or when the destination can't be reached at all */
+		if (!reachable || tile == v->dest_tile) {
+			path_found = reachable;
+
 			/* convert tracks to trackdirs */
 			TrackdirBits trackdirs = (TrackdirBits)(tracks | ((int)tracks << 8));
 			/* limit to trackdirs reachable from enterdir */
@@ -75,33 +220,35 @@ public:
 
 		/* convert origin trackdir to TrackdirBits */
 		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
-		/* get available trackdirs on the destination tile */
-		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
-
-		/* create pathfinder instance */
-		Tpf pf;
-		/* set origin and destination nodes */
-		pf.SetOrigin(src_tile, trackdirs);
-		pf.SetDestination(v->dest_tile, dest_trackdirs);
-		/* find best path */
-		path_found = pf.FindPath(v);
-
-		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
-		Node *pNode = pf.GetBestNode();
-		if (pNode != NULL) {
-			/* walk through the path back to the origin */
-			Node *pPrevNode = NULL;
-			while (pNode->m_parent != NULL) {
-				pPrevNode = pNode;
-				pNode = pNode->m_parent;
+		/* first only search the water regions along the high level path, then everywhere */
+		for (int attempt = 0;; attempt++) {
+			/* create pathfinder instance */
+			Tpf pf;
+			/* set origin and destination nodes */
+			pf.SetOrigin(src_tile, trackdirs);
+			SetShipDestination(pf, v, high_level_path, attempt == 0);
+			/* find best path */
+			path_found = pf.FindPath(v);
+			if (!path_found && attempt == 0 && !high_level_path.empty()) continue;
+
+			Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
+
+			Node *pNode = pf.GetBestNode();
+			if (pNode != NULL) {
+				/* walk through the path back to the origin */
+				Node *pPrevNode = NULL;
+				while (pNode->m_parent != NULL) {
+					pPrevNode = pNode;
+					pNode = pNode->m_parent;
+				}
+				/* return trackdir from the best next node (direct child of origin) */
+				Node &best_next_node = *pPrevNode;
+				assert(best_next_node.GetTile() == tile);
+				next_trackdir = best_next_node.GetTrackdir();
 			}
-			/* return trackdir from the best next node (direct child of origin) */
-			Node &best_next_node = *pPrevNode;
-			assert(best_next_node.GetTile() == tile);
-			next_trackdir = best_next_node.GetTrackdir();
+			return next_trackdir;
 		}
-		return next_trackdir;
 	}
 
 	/**
@@ -115,29 +262,35 @@ public:
 	 */
 	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2)
 	{
-		/* get available trackdirs on the destination tile */
-		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
+		std::vector<WaterRegionPatchDesc> high_level_path;
+		if (!FindHighLevelPath(v, tile, high_level_path)) return false;
+
+		/* first only search the water regions along the high level path, then everywhere */
+		for (int attempt = 0;; attempt++) {
+			/* create pathfinder instance */
+			Tpf pf;
+			/* set origin and destination nodes */
+			pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
+			SetShipDestination(pf, v, high_level_path, attempt == 0);
+			/* find best path */
+			if (!pf.FindPath(v)) {
+				if (attempt == 0 && !high_level_path.empty()) continue;
+				return false;
+			}
 
-		/* create pathfinder instance */
-		Tpf pf;
-		/* set origin and destination nodes */
-		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
-		pf.SetDestination(v->dest_tile, dest_trackdirs);
-		/* find best path */
-		if (!pf.FindPath(v)) return false;
+			Node *pNode = pf.GetBestNode();
+			if (pNode == NULL) return false;
 
-		Node *pNode = pf.GetBestNode();
-		if (pNode == NULL) return false;
+			/* path was found
+			 * walk through the path back to the origin */
+			while (pNode->m_parent != NULL) {
+				pNode = pNode->m_parent;
+			}
 
-		/* path was found
-		 * walk through the path back to the origin */
-		while (pNode->m_parent != NULL) {
-			pNode = pNode->m_parent;
+			Trackdir best_trackdir = pNode->GetTrackdir();
+			assert(best_trackdir == td1 || best_trackdir == td2);
+			return best_trackdir == td2;
 		}
-
-		Trackdir best_trackdir = pNode->GetTrackdir();
-		assert(best_trackdir == td1 || best_trackdir == td2);
-		return best_trackdir == td2;
 	}
 };
 
@@ -209,7 +362,7 @@ struct CYapfShip_TypesT
 	typedef CYapfBaseT<Types>                 PfBase;        // base pathfinder class
 	typedef CYapfFollowShipT<Types>           PfFollow;      // node follower
 	typedef CYapfOriginTileT<Types>           PfOrigin;      // origin provider
-	typedef CYapfDestinationTileT<Types>      PfDestination; // destination/distance provider
+	typedef CYapfDestinationTileWaterT<Types> PfDestination; // destination/distance provider
 	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       // segment cost cache provider
 	typedef CYapfCostShipT<Types>             PfCost;        // cost provider
 };
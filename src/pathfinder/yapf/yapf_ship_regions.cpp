@@ -0,0 +1,339 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_ship_regions.cpp Implementation of YAPF for water regions, which are used for finding intermediate ship destinations. */
+
+#include "../../stdafx.h"
+#include "../../ship.h"
+
+#include "yapf.hpp"
+#include "yapf_ship_regions.h"
+
+#include "../../safeguards.h"
+
+static const int DIRECT_NEIGHBOR_COST = 100;  ///< Cost of moving from a water region to a directly adjacent one.
+static const int NODES_PER_REGION = 4;        ///< Number of nodes to allow per water region of the map before giving up.
+static const int MAX_NUMBER_OF_NODES = 65536; ///< Hard limit of the number of nodes of a single search.
+
+/** Yapf Node Key that represents a single patch of interconnected water within a water region. */
+struct CYapfRegionPatchNodeKey {
+	WaterRegionPatchDesc m_water_region_patch;
+
+	inline void Set(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_water_region_patch = water_region_patch;
+	}
+
+	inline int CalcHash() const
+	{
+		return CalculateWaterRegionPatchHash(m_water_region_patch);
+	}
+
+	inline bool operator==(const CYapfRegionPatchNodeKey &other) const
+	{
+		return CalcHash() == other.CalcHash();
+	}
+};
+
+/**
+ * Get the Manhattan distance between two water region patches, in regions.
+ * @param a First patch.
+ * @param b Second patch.
+ * @return The distance.
+ */
+static inline int ManhattanDistance(const CYapfRegionPatchNodeKey &a, const CYapfRegionPatchNodeKey &b)
+{
+	return (abs(a.m_water_region_patch.x - b.m_water_region_patch.x) + abs(a.m_water_region_patch.y - b.m_water_region_patch.y)) * DIRECT_NEIGHBOR_COST;
+}
+
+/** Yapf Node for water regions. */
+template <class Tkey_>
+struct CYapfRegionNodeT {
+	typedef Tkey_ Key;
+	typedef CYapfRegionNodeT<Tkey_> Node;
+
+	Tkey_  m_key;
+	Node  *m_hash_next;
+	Node  *m_parent;
+	int    m_cost;
+	int    m_estimate;
+
+	inline void Set(Node *parent, const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_key.Set(water_region_patch);
+		m_hash_next = NULL;
+		m_parent = parent;
+		m_cost = 0;
+		m_estimate = 0;
+	}
+
+	inline void Set(Node *parent, const Key &key)
+	{
+		Set(parent, key.m_water_region_patch);
+	}
+
+	DiagDirection GetDiagDirFromParent() const
+	{
+		if (m_parent == NULL) return INVALID_DIAGDIR;
+		const int dx = m_key.m_water_region_patch.x - m_parent->m_key.m_water_region_patch.x;
+		const int dy = m_key.m_water_region_patch.y - m_parent->m_key.m_water_region_patch.y;
+		if (dx > 0 && dy == 0) return DIAGDIR_SW;
+		if (dx < 0 && dy == 0) return DIAGDIR_NE;
+		if (dx == 0 && dy > 0) return DIAGDIR_SE;
+		if (dx == 0 && dy < 0) return DIAGDIR_NW;
+		return INVALID_DIAGDIR;
+	}
+
+	inline Node *GetHashNext() { return m_hash_next; }
+	inline void SetHashNext(Node *pNext) { m_hash_next = pNext; }
+	inline const Tkey_ &GetKey() const { return m_key; }
+	inline int GetCost() { return m_cost; }
+	inline int GetCostEstimate() { return m_estimate; }
+	inline bool operator<(const Node &other) const { return m_estimate < other.m_estimate; }
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteLine("m_key = (%d, %d, %d)", m_key.m_water_region_patch.x, m_key.m_water_region_patch.y, m_key.m_water_region_patch.label);
+		dmp.WriteLine("m_cost = %d", m_cost);
+		dmp.WriteLine("m_estimate = %d", m_estimate);
+	}
+};
+
+/** YAPF origin for water regions. */
+template <class Types>
+class CYapfOriginRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< The pathfinder class (derived from THIS class).
+	typedef typename Types::NodeList::Titem Node; ///< This will be our node type.
+	typedef typename Node::Key Key;               ///< Key to hash tables.
+
+protected:
+	inline Tpf &Yapf() { return *static_cast<Tpf *>(this); }
+
+private:
+	std::vector<CYapfRegionPatchNodeKey> m_origin_keys;
+
+public:
+	void AddOrigin(const WaterRegionPatchDesc &water_region_patch)
+	{
+		if (!HasOrigin(water_region_patch)) {
+			CYapfRegionPatchNodeKey key;
+			key.Set(water_region_patch);
+			m_origin_keys.push_back(key);
+		}
+	}
+
+	bool HasOrigin(const WaterRegionPatchDesc &water_region_patch)
+	{
+		for (const CYapfRegionPatchNodeKey &key : m_origin_keys) {
+			if (key.m_water_region_patch == water_region_patch) return true;
+		}
+		return false;
+	}
+
+	void PfSetStartupNodes()
+	{
+		for (const CYapfRegionPatchNodeKey &origin_key : m_origin_keys) {
+			Node &node = Yapf().CreateNewNode();
+			node.Set(NULL, origin_key);
+			Yapf().AddStartupNode(node);
+		}
+	}
+};
+
+/** YAPF destination provider for water regions. */
+template <class Types>
+class CYapfDestinationRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< The pathfinder class (derived from THIS class).
+	typedef typename Types::NodeList::Titem Node; ///< This will be our node type.
+	typedef typename Node::Key Key;               ///< Key to hash tables.
+
+protected:
+	Key m_dest;
+
+public:
+	void SetDestination(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_dest.Set(water_region_patch);
+	}
+
+protected:
+	Tpf &Yapf() { return *static_cast<Tpf *>(this); }
+
+public:
+	inline bool PfDetectDestination(Node &n) const
+	{
+		return n.m_key == m_dest;
+	}
+
+	inline bool PfCalcEstimate(Node &n)
+	{
+		if (PfDetectDestination(n)) {
+			n.m_estimate = n.m_cost;
+			return true;
+		}
+
+		n.m_estimate = n.m_cost + ManhattanDistance(n.m_key, m_dest);
+
+		return true;
+	}
+};
+
+/** YAPF node following for water regions. */
+template <class Types>
+class CYapfFollowRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< The pathfinder class (derived from THIS class).
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< This will be our node type.
+	typedef typename Node::Key Key;                      ///< Key to hash tables.
+
+protected:
+	inline Tpf &Yapf() { return *static_cast<Tpf *>(this); }
+
+public:
+	inline void PfFollowNode(Node &old_node)
+	{
+		TVisitWaterRegionPatchCallBack visitFunc = [&](const WaterRegionPatchDesc &water_region_patch)
+		{
+			Node &node = Yapf().CreateNewNode();
+			node.Set(&old_node, water_region_patch);
+			Yapf().AddNewNode(node, TrackFollower{});
+		};
+		VisitWaterRegionPatchNeighbours(old_node.m_key.m_water_region_patch, visitFunc);
+	}
+
+	inline char TransportTypeChar() const { return '^'; }
+
+	/**
+	 * Find the path through water regions from the given tile to the destination of a ship.
+	 * @param v The ship.
+	 * @param start_tile Tile the ship starts at.
+	 * @param max_returned_path_length Maximum number of patches to return, counted from the start.
+	 * @return The patches of the path, starting with the one of start_tile, or an empty vector if there is no path.
+	 */
+	static std::vector<WaterRegionPatchDesc> FindWaterRegionPath(const Ship *v, TileIndex start_tile, int max_returned_path_length)
+	{
+		const WaterRegionPatchDesc start_water_region_patch = GetWaterRegionPatchInfo(start_tile);
+
+		/* We reserve 4 nodes (patches) per water region. The vast majority of water regions have 1 or 2 regions so this should be a pretty
+		 * safe limit. We cap the limit at 65536 which is at a region size of 16x16 is equivalent to one node per region for a 4096x4096 map. */
+		Tpf pf(min(static_cast<int>(MapSize() * NODES_PER_REGION) / (int)WATER_REGION_NUMBER_OF_TILES, MAX_NUMBER_OF_NODES));
+		pf.SetDestination(start_water_region_patch);
+
+		/* The search is done backwards from the destination, so the ship's own region is the end of the path. */
+		pf.AddOrigin(GetWaterRegionPatchInfo(v->dest_tile));
+
+		/* Find best path. */
+		if (!pf.FindPath(v)) return {}; // Path not found.
+
+		std::vector<WaterRegionPatchDesc> path;
+		Node *node = pf.GetBestNode();
+		for (int i = 0; i < max_returned_path_length && node != NULL; i++) {
+			path.push_back(node->m_key.m_water_region_patch);
+			node = node->m_parent;
+		}
+
+		assert(!path.empty());
+		return path;
+	}
+};
+
+/** Cost Provider of YAPF for water regions. */
+template <class Types>
+class CYapfCostRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< The pathfinder class (derived from THIS class).
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< This will be our node type.
+	typedef typename Node::Key Key;                      ///< Key to hash tables.
+
+protected:
+	/** To access inherited path finder. */
+	Tpf &Yapf() { return *static_cast<Tpf *>(this); }
+
+public:
+	/**
+	 * Called by YAPF to calculate the cost from the origin to the given node.
+	 * Calculates only the cost of given node, adds it to the parent node cost
+	 * and stores the result into Node::m_cost member.
+	 * @param n Node to calculate the cost for.
+	 * @param tf Unused.
+	 * @return True, because the cost of a region can always be calculated.
+	 */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		n.m_cost = n.m_parent->m_cost + ManhattanDistance(n.m_key, n.m_parent->m_key);
+
+		/* Incentivise zig-zagging by adding a slight penalty when the search continues in the same direction. */
+		Node *grandparent = n.m_parent->m_parent;
+		if (grandparent != NULL) {
+			const DiagDirection dir_from_parent = n.GetDiagDirFromParent();
+			if (dir_from_parent != INVALID_DIAGDIR && dir_from_parent == n.m_parent->GetDiagDirFromParent()) n.m_cost += 1;
+		}
+
+		return true;
+	}
+};
+
+/* We don't need a follower but YAPF requires one. */
+struct DummyFollower : public CFollowTrackWater {};
+
+class CYapfRegionWater;
+
+/**
+ * Config struct of YAPF for route planning.
+ * Defines all 6 base YAPF modules as classes providing services for CYapfBaseT.
+ */
+template <class Tpf_, class Tnode_list>
+struct CYapfRegion_TypesT
+{
+	typedef CYapfRegion_TypesT<Tpf_, Tnode_list> Types; ///< Shortcut for this struct type.
+	typedef Tpf_                                 Tpf;            ///< Pathfinder type.
+	typedef DummyFollower                        TrackFollower;  ///< Track follower helper class
+	typedef Tnode_list                           NodeList;
+	typedef Ship                                 VehicleType;
+
+	/** Pathfinder components (modules). */
+	typedef CYapfBaseT<Types>                 PfBase;        ///< Base pathfinder class.
+	typedef CYapfFollowRegionT<Types>         PfFollow;      ///< Node follower.
+	typedef CYapfOriginRegionT<Types>         PfOrigin;      ///< Origin provider.
+	typedef CYapfDestinationRegionT<Types>    PfDestination; ///< Destination/distance provider.
+	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       ///< Segment cost cache provider.
+	typedef CYapfCostRegionT<Types>           PfCost;        ///< Cost provider.
+};
+
+typedef CNodeList_HashTableT<CYapfRegionNodeT<CYapfRegionPatchNodeKey>, 12, 12> CRegionNodeListWater;
+
+/** YAPF for water regions. */
+class CYapfRegionWater : public CYapfT<CYapfRegion_TypesT<CYapfRegionWater, CRegionNodeListWater> >
+{
+public:
+	explicit CYapfRegionWater(int max_nodes)
+	{
+		this->SetMaxSearchNodes(max_nodes);
+	}
+};
+
+/**
+ * Finds a path at the water region level. Note that the starting tile is the end of the path, as the search is done backwards.
+ * @param v The ship to find a path for.
+ * @param start_tile The tile to start searching from.
+ * @param max_returned_path_length The maximum length of the path that will be returned.
+ * @returns A path of water region patches, or an empty vector if no path was found.
+ */
+std::vector<WaterRegionPatchDesc> YapfShipFindWaterRegionPath(const Ship *v, TileIndex start_tile, int max_returned_path_length)
+{
+	return CYapfRegionWater::FindWaterRegionPath(v, start_tile, max_returned_path_length);
+}
@@ -18,6 +18,7 @@
 #include "track_func.h"
 #include "road_type.h"
 #include "newgrf_engine.h"
+#include <vector>
 
 struct RoadVehicle;
 
@@ -79,7 +80,76 @@ static const uint RVC_DEPOT_STOP_FRAME                   = 11;
 /** The number of ticks a vehicle has for overtaking. */
 static const byte RV_OVERTAKE_TIMEOUT = 35;
 
+static const uint ROADVEH_PATH_CACHE_SEGMENTS = 8; ///< Maximum number of junction choices kept in the path cache of a road vehicle.
+static const uint ROADVEH_PATH_CACHE_REFILL   = 2; ///< Number of cached choices, including the current one, at which more are looked up ahead.
+static const uint ROADVEH_PATH_CACHE_MARGIN   = 8; ///< Distance in tiles around the cached junctions within which road changes drop the path cache.
+
+/**
+ * Choices a road vehicle will make at its next junctions, found by earlier
+ * path searches. Both vectors are in reverse order, i.e. the next (or
+ * current) junction is at the back.
+ */
+struct RoadVehPathCache {
+	std::vector<TileIndex> tile; ///< Junction tiles.
+	std::vector<byte> td;        ///< Trackdir to take at each junction.
+	TileIndex dest_tile;         ///< Destination tile of the vehicle when the path was found.
+	bool lookahead_requested;    ///< Whether a search beyond the last cached junction is queued. Never set between ticks.
+
+	inline bool empty() const { return this->td.empty(); }
+
+	/**
+	 * Check whether the cached choices may still be used, i.e. the destination is the same.
+	 * Changes of the road layout drop the cache directly, see #InvalidateRoadVehPathCaches.
+	 * @param dest Current destination of the vehicle.
+	 * @return True if the cache is non-empty and up to date.
+	 */
+	inline bool IsValidFor(TileIndex dest) const
+	{
+		return !this->empty() && dest == this->dest_tile;
+	}
+
+	bool IsNear(TileIndex v_tile, TileIndex changed) const;
+	inline uint size() const { return (uint)this->td.size(); }
+
+	inline void clear()
+	{
+		this->tile.clear();
+		this->td.clear();
+	}
+
+	/**
+	 * Get the cached choice for a junction. The entry of the previous junction
+	 * is dropped once the vehicle reaches the next one.
+	 * @param junction Junction the vehicle is about to enter.
+	 * @param dest Current destination of the vehicle.
+	 * @return Trackdir to take, or INVALID_TRACKDIR if the cache has no choice for this junction.
+	 */
+	Trackdir Lookup(TileIndex junction, TileIndex dest)
+	{
+		if (!this->IsValidFor(dest)) return INVALID_TRACKDIR;
+		size_t n = this->tile.size();
+		if (this->tile[n - 1] != junction && n >= 2 && this->tile[n - 2] == junction) {
+			this->tile.pop_back();
+			this->td.pop_back();
+		}
+		return this->tile.back() == junction ? (Trackdir)this->td.back() : INVALID_TRACKDIR;
+	}
+};
+
+/** Search for the path of a road vehicle beyond the last junction in its path cache. */
+struct RoadVehPathLookahead {
+	const RoadVehicle *v;          ///< The vehicle.
+	TileIndex tile;                ///< Last cached junction.
+	Trackdir td;                   ///< Trackdir taken at that junction.
+	std::vector<TileIndex> tiles;  ///< [out] Junctions found after it, in reverse order.
+	std::vector<byte> tds;         ///< [out] Trackdirs to take at those junctions.
+
+	RoadVehPathLookahead(const RoadVehicle *v, TileIndex tile, Trackdir td) : v(v), tile(tile), td(td) {}
+};
+
 void RoadVehUpdateCache(RoadVehicle *v, bool same_length = false);
+void InvalidateRoadVehPathCaches(TileIndex tile);
+void RunRoadVehPathLookahead();
 void GetRoadVehSpriteSize(EngineID engine, uint &width, uint &height, int &xoffs, int &yoffs, EngineImageType image_type);
 
 /**
@@ -96,6 +166,7 @@ struct RoadVehicle FINAL : public GroundVehicle<RoadVehicle, VEH_ROAD> {
 
 	RoadType roadtype;
 	RoadTypes compatible_roadtypes;
+	RoadVehPathCache path;  ///< Cached choices at the next junctions.
 
 	/** We don't want GCC to zero our struct! It already is zeroed and has an index! */
 	RoadVehicle() : GroundVehicleBase() {}
@@ -38,6 +38,7 @@
 #include "zoom_func.h"
 #include "scope_info.h"
 #include "string_func.h"
+#include "thread/thread_pool.h"
 
 #include "table/strings.h"
 
@@ -887,6 +888,128 @@ static void RoadZPosAffectSpeed(RoadVehicle *v, int old_z)
 	}
 }
 
+/**
+ * Check whether a change of the road layout may affect the cached choices.
+ * The road between the junctions isn't cached, so this only checks whether
+ * the change is within #ROADVEH_PATH_CACHE_MARGIN tiles of the area spanned
+ * by the vehicle and its cached junctions.
+ * @param v_tile Current tile of the vehicle.
+ * @param changed Tile where the road layout changed.
+ * @return True if the change is close to the cached path.
+ */
+bool RoadVehPathCache::IsNear(TileIndex v_tile, TileIndex changed) const
+{
+	uint min_x = TileX(v_tile);
+	uint max_x = min_x;
+	uint min_y = TileY(v_tile);
+	uint max_y = min_y;
+	for (TileIndex t : this->tile) {
+		min_x = min(min_x, TileX(t));
+		max_x = max(max_x, TileX(t));
+		min_y = min(min_y, TileY(t));
+		max_y = max(max_y, TileY(t));
+	}
+	uint x = TileX(changed);
+	uint y = TileY(changed);
+	return x + ROADVEH_PATH_CACHE_MARGIN >= min_x && x <= max_x + ROADVEH_PATH_CACHE_MARGIN &&
+			y + ROADVEH_PATH_CACHE_MARGIN >= min_y && y <= max_y + ROADVEH_PATH_CACHE_MARGIN;
+}
+
+/**
+ * Drop the path caches of the road vehicles whose cached path passes close to a changed tile.
+ * @param tile Tile where the road layout changed, or INVALID_TILE to drop all path caches.
+ */
+void InvalidateRoadVehPathCaches(TileIndex tile)
+{
+	RoadVehicle *v;
+	FOR_ALL_ROADVEHICLES(v) {
+		if (!v->IsFrontEngine() || v->path.empty()) continue;
+		if (tile == INVALID_TILE || v->path.IsNear(v->tile, tile)) v->path.clear();
+	}
+}
+
+/** Road vehicles which used up most of their path cache this tick, in the order they did so. */
+static std::vector<VehicleID> _roadveh_path_lookahead_queue;
+
+/** Minimum number of look-ahead searches in a tick before they are spread over worker threads. */
+static const uint ROADVEH_PATH_LOOKAHEAD_MIN_BATCH = 8;
+
+/**
+ * Queue a search beyond the last junction in the path cache of a vehicle.
+ * @param v The vehicle.
+ */
+static void RequestRoadVehPathLookahead(RoadVehicle *v)
+{
+	if (v->path.lookahead_requested) return;
+	v->path.lookahead_requested = true;
+	_roadveh_path_lookahead_queue.push_back(v->index);
+}
+
+/** A part of the look-ahead searches of a tick, tailored to WorkerThreadPool::Submit. */
+struct RoadVehPathLookaheadChunk {
+	RoadVehPathLookahead *requests; ///< First search of the chunk.
+	uint count;                     ///< Number of searches.
+
+	static void Run(void *data)
+	{
+		RoadVehPathLookaheadChunk *chunk = (RoadVehPathLookaheadChunk *)data;
+		YapfRoadVehicleFindPathsAhead(chunk->requests, chunk->count);
+	}
+};
+
+/**
+ * Extend the path caches of the road vehicles queued during this tick.
+ * The searches only read the map, so they are run concurrently when there
+ * are enough of them. The results are merged in the order the vehicles were
+ * queued, so they don't depend on the number of threads.
+ */
+void RunRoadVehPathLookahead()
+{
+	if (_roadveh_path_lookahead_queue.empty()) return;
+
+	std::vector<RoadVehPathLookahead> requests;
+	requests.reserve(_roadveh_path_lookahead_queue.size());
+	for (VehicleID id : _roadveh_path_lookahead_queue) {
+		RoadVehicle *v = RoadVehicle::GetIfValid(id);
+		if (v == NULL || !v->path.lookahead_requested) continue;
+		v->path.lookahead_requested = false;
+		/* the cache may have been dropped since the request */
+		if (!v->path.IsValidFor(v->dest_tile)) continue;
+		requests.emplace_back(v, v->path.tile.front(), (Trackdir)v->path.td.front());
+	}
+	_roadveh_path_lookahead_queue.clear();
+
+	uint count = (uint)requests.size();
+	if (count < ROADVEH_PATH_LOOKAHEAD_MIN_BATCH) {
+		YapfRoadVehicleFindPathsAhead(requests.data(), count);
+	} else {
+		uint num_chunks = min(GetWorkerThreadPool().NumWorkers() + 1, count / (ROADVEH_PATH_LOOKAHEAD_MIN_BATCH / 2));
+		std::vector<RoadVehPathLookaheadChunk> chunks(num_chunks);
+		WorkerTaskGroup group;
+		uint first = 0;
+		for (uint i = 0; i < num_chunks; i++) {
+			uint last = count * (i + 1) / num_chunks;
+			chunks[i].requests = requests.data() + first;
+			chunks[i].count = last - first;
+			first = last;
+			/* do the last chunk on this thread */
+			if (i + 1 < num_chunks) GetWorkerThreadPool().Submit(&RoadVehPathLookaheadChunk::Run, &chunks[i], &group, true);
+		}
+		RoadVehPathLookaheadChunk::Run(&chunks[num_chunks - 1]);
+		GetWorkerThreadPool().Wait(&group);
+	}
+
+	for (RoadVehPathLookahead &request : requests) {
+		RoadVehPathCache &path = RoadVehicle::From(Vehicle::Get(request.v->index))->path;
+		/* the vehicle may have searched again after the request */
+		if (path.empty() || path.tile.front() != request.tile || path.td.front() != request.td) continue;
+		size_t add = min<size_t>(request.tds.size(), ROADVEH_PATH_CACHE_SEGMENTS - min<size_t>(path.size(), ROADVEH_PATH_CACHE_SEGMENTS));
+		/* the new junctions are further away, so they go to the front */
+		path.tile.insert(path.tile.begin(), request.tiles.end() - add, request.tiles.end());
+		path.td.insert(path.td.begin(), request.tds.end() - add, request.tds.end());
+	}
+}
+
 static int PickRandomBit(uint bits)
 {
 	uint i;
@@ -953,6 +1076,7 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 	trackdirs &= DiagdirReachesTrackdirs(enterdir);
 	if (trackdirs == TRACKDIR_BIT_NONE) {
 		/* No reachable tracks, so we'll reverse */
+		v->path.clear();
 		return_track(_road_reverse_table[enterdir]);
 	}
 
@@ -969,6 +1093,7 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 		if (reverse) {
 			v->reverse_ctr = 0;
 			if (v->tile != tile) {
+				v->path.clear();
 				return_track(_road_reverse_table[enterdir]);
 			}
 		}
@@ -977,6 +1102,7 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 	desttile = v->dest_tile;
 	if (desttile == 0) {
 		/* We've got no destination, pick a random track */
+		v->path.clear();
 		return_track(PickRandomBit(trackdirs));
 	}
 
@@ -987,7 +1113,17 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 
 	switch (_settings_game.pf.pathfinder_for_roadvehs) {
 		case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
-		case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+		case VPF_YAPF: {
+			/* Use the choice found by an earlier search, if any */
+			Trackdir cached = v->path.Lookup(tile, desttile);
+			if (cached != INVALID_TRACKDIR && HasBit(trackdirs, cached)) {
+				if (v->path.size() <= ROADVEH_PATH_CACHE_REFILL) RequestRoadVehPathLookahead(v);
+				return_track(cached);
+			}
+			v->path.clear();
+			best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found, v->path);
+			break;
+		}
 
 		default: NOT_REACHED();
 	}
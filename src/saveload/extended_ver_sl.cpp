@@ -79,6 +79,10 @@ const SlxiSubChunkInfo _sl_xv_sub_chunk_infos[] = {
 	{ XSLFI_SCHEDULED_DISPATCH,     XSCF_NULL,                1,   1, "scheduled_dispatch",        NULL, NULL, NULL        },
 	{ XSLFI_MORE_TOWN_GROWTH_RATES, XSCF_NULL,                1,   1, "more_town_growth_rates",    NULL, NULL, NULL        },
 	{ XSLFI_MULTIPLE_DOCKS,         XSCF_NULL,                1,   1, "multiple_docks",            NULL, NULL, "DOCK"      },
+	{ XSLFI_LINKGRAPH_PARALLEL_MCF, XSCF_NULL,                1,   1, "linkgraph_parallel_mcf",    NULL, NULL, NULL        },
+	{ XSLFI_LINKGRAPH_CHANGE_TRACKING, XSCF_NULL,             1,   1, "linkgraph_change_tracking", NULL, NULL, NULL        },
+	{ XSLFI_LAZY_CARGO_AGING,       XSCF_NULL,                1,   1, "lazy_cargo_aging",          NULL, NULL, NULL        },
+	{ XSLFI_ROADVEH_PATH_CACHE,     XSCF_NULL,                3,   3, "roadveh_path_cache",        NULL, NULL, NULL        },
 	{ XSLFI_NULL, XSCF_NULL, 0, 0, NULL, NULL, NULL, NULL },// This is the end marker
 };
 
@@ -53,6 +53,10 @@ enum SlXvFeatureIndex {
 	XSLFI_SCHEDULED_DISPATCH,                     ///< Scheduled vehicle dispatching
 	XSLFI_MORE_TOWN_GROWTH_RATES,                 ///< More town growth rates
 	XSLFI_MULTIPLE_DOCKS,                         ///< Multiple docks
+	XSLFI_LINKGRAPH_PARALLEL_MCF,                 ///< Link graph setting to calculate paths for several sources concurrently
+	XSLFI_LINKGRAPH_CHANGE_TRACKING,              ///< Link graph supplies and capacities at the time of the last job, and setting to skip unchanged link graphs
+	XSLFI_LAZY_CARGO_AGING,                       ///< Cargo aging of vehicles not yet applied to their cargo packets
+	XSLFI_ROADVEH_PATH_CACHE,                     ///< Cached choices of road vehicles at their next junctions
 
 	XSLFI_RIFF_HEADER_60_BIT,                     ///< Size field in RIFF chunk header is 60 bit
 	XSLFI_HEIGHT_8_BIT,                           ///< Map tile height is 8 bit instead of 4 bit, but savegame version may be before this became true in trunk
@@ -24,6 +24,7 @@ typedef LinkGraph::BaseEdge Edge;
 const SettingDesc *GetSettingDescription(uint index);
 
 static uint16 _num_nodes;
+static NodeID _next_edge;
 
 /**
  * Get a SaveLoad array for a link graph.
@@ -35,6 +36,7 @@ const SaveLoad *GetLinkGraphDesc()
 		 SLE_VAR(LinkGraph, last_compression, SLE_INT32),
 		SLEG_VAR(_num_nodes,                  SLE_UINT16),
 		 SLE_VAR(LinkGraph, cargo,            SLE_UINT8),
+		 SLE_CONDVAR_X(LinkGraph, last_job_total, SLE_UINT64, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_LINKGRAPH_CHANGE_TRACKING)),
 		 SLE_END()
 	};
 	return link_graph_desc;
@@ -122,11 +124,15 @@ static const SaveLoad _node_desc[] = {
 	    SLE_VAR(Node, demand,      SLE_UINT32),
 	    SLE_VAR(Node, station,     SLE_UINT16),
 	    SLE_VAR(Node, last_update, SLE_INT32),
+	SLE_CONDVAR_X(Node, last_job_supply, SLE_UINT32, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_LINKGRAPH_CHANGE_TRACKING)),
+	SLE_CONDVAR_X(Node, last_job_demand, SLE_UINT32, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_LINKGRAPH_CHANGE_TRACKING)),
 	    SLE_END()
 };
 
 /**
- * SaveLoad desc for a link graph edge.
+ * SaveLoad desc for a link graph edge. Edges are saved as a linked list per
+ * node, starting at a dummy edge from the node to itself, so _next_edge holds
+ * the destination of the next edge in the list.
  */
 static const SaveLoad _edge_desc[] = {
 	SLE_CONDNULL(4, 0, 190), // distance
@@ -134,31 +140,67 @@ static const SaveLoad _edge_desc[] = {
 	     SLE_VAR(Edge, usage,                    SLE_UINT32),
 	     SLE_VAR(Edge, last_unrestricted_update, SLE_INT32),
 	 SLE_CONDVAR(Edge, last_restricted_update,   SLE_INT32, 187, SL_MAX_VERSION),
-	     SLE_VAR(Edge, next_edge,                SLE_UINT16),
+	SLE_CONDVAR_X(Edge, last_job_capacity,       SLE_UINT32, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_LINKGRAPH_CHANGE_TRACKING)),
+	    SLEG_VAR(_next_edge,                     SLE_UINT16),
 	     SLE_END()
 };
 
 /**
- * Save/load a link graph.
- * @param comp Link graph to be saved or loaded.
+ * Save a link graph. The edges are saved in the same format as the sparse
+ * matrix link graphs used to have.
+ * @param lg Link graph to be saved.
  */
-void SaveLoad_LinkGraph(LinkGraph &lg)
+void Save_LinkGraph(LinkGraph &lg)
 {
 	uint size = lg.Size();
 	for (NodeID from = 0; from < size; ++from) {
-		Node *node = &lg.nodes[from];
-		SlObject(node, _node_desc);
+		SlObject(&lg.nodes[from], _node_desc);
+		LinkGraph::EdgeVector &edges = lg.edges[from];
+		Edge start = LinkGraph::empty_edge;
+		_next_edge = edges.empty() ? INVALID_NODE : edges[0].dest_node;
+		SlObject(&start, _edge_desc);
+		for (size_t i = 0; i < edges.size(); ++i) {
+			_next_edge = (i + 1 < edges.size()) ? edges[i + 1].dest_node : INVALID_NODE;
+			SlObject(&edges[i], _edge_desc);
+		}
+	}
+}
+
+/**
+ * Load a link graph.
+ * @param lg Link graph to be loaded.
+ */
+void Load_LinkGraph(LinkGraph &lg)
+{
+	uint size = lg.Size();
+	for (NodeID from = 0; from < size; ++from) {
+		SlObject(&lg.nodes[from], _node_desc);
+		LinkGraph::EdgeVector &edges = lg.edges[from];
 		if (IsSavegameVersionBefore(191)) {
 			/* We used to save the full matrix ... */
+			std::vector<Edge> row(size);
+			std::vector<NodeID> next_edges(size);
 			for (NodeID to = 0; to < size; ++to) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+				SlObject(&row[to], _edge_desc);
+				row[to].dest_node = to;
+				next_edges[to] = _next_edge;
+			}
+			for (NodeID to = next_edges[from]; to != INVALID_NODE; to = next_edges[to]) {
+				edges.push_back(row[to]);
 			}
 		} else {
 			/* ... but as that wasted a lot of space we save a sparse matrix now. */
-			for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+			Edge start;
+			SlObject(&start, _edge_desc);
+			for (NodeID to = _next_edge; to != INVALID_NODE; to = _next_edge) {
+				edges.emplace_back();
+				SlObject(&edges.back(), _edge_desc);
+				edges.back().dest_node = to;
 			}
 		}
+		std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) {
+			return a.dest_node < b.dest_node;
+		});
 	}
 }
 
@@ -171,7 +213,7 @@ static void DoSave_LGRJ(LinkGraphJob *lgj)
 	SlObject(lgj, GetLinkGraphJobDesc());
 	_num_nodes = lgj->Size();
 	SlObject(const_cast<LinkGraph *>(&lgj->Graph()), GetLinkGraphDesc());
-	SaveLoad_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
+	Save_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
 }
 
 /**
@@ -182,7 +224,7 @@ static void DoSave_LGRP(LinkGraph *lg)
 {
 	_num_nodes = lg->Size();
 	SlObject(lg, GetLinkGraphDesc());
-	SaveLoad_LinkGraph(*lg);
+	Save_LinkGraph(*lg);
 }
 
 /**
@@ -199,7 +241,7 @@ static void Load_LGRP()
 		LinkGraph *lg = new (index) LinkGraph();
 		SlObject(lg, GetLinkGraphDesc());
 		lg->Init(_num_nodes);
-		SaveLoad_LinkGraph(*lg);
+		Load_LinkGraph(*lg);
 	}
 }
 
@@ -222,7 +264,7 @@ static void Load_LGRJ()
 		LinkGraph &lg = const_cast<LinkGraph &>(lgj->Graph());
 		SlObject(&lg, GetLinkGraphDesc());
 		lg.Init(_num_nodes);
-		SaveLoad_LinkGraph(lg);
+		Load_LinkGraph(lg);
 	}
 }
 
@@ -93,6 +93,7 @@ static const SaveLoadGlobVarList _date_desc[] = {
 	    SLEG_VAR(_trees_tick_ctr,         SLE_UINT8),
 	SLEG_CONDVAR(_pause_mode,             SLE_UINT8,                   4, SL_MAX_VERSION),
 	SLE_CONDNULL(4, 11, 119),
+	SLE_CONDNULL_X(4, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE, 2, 2)), // _road_layout_generation
 	    SLEG_END()
 };
 
@@ -119,6 +120,7 @@ static const SaveLoadGlobVarList _date_check_desc[] = {
 	    SLE_NULL(1),                       // _trees_tick_ctr
 	SLE_CONDNULL(1, 4, SL_MAX_VERSION),    // _pause_mode
 	SLE_CONDNULL(4, 11, 119),
+	SLE_CONDNULL_X(4, 0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE, 2, 2)), // _road_layout_generation
 	    SLEG_END()
 };
 
@@ -26,6 +26,7 @@
 #include "../station_base.h"
 #include "../dock_base.h"
 #include "../thread/thread.h"
+#include "../thread/thread_pool.h"
 #include "../town.h"
 #include "../network/network.h"
 #include "../window_func.h"
@@ -45,6 +46,7 @@
 #include "../string_func_extra.h"
 #include "../fios.h"
 #include "../error.h"
+#include "../console_func.h"
 
 #include "../tbtr_template_vehicle.h"
 
@@ -58,6 +60,7 @@
 
 #include <deque>
 #include <vector>
+#include <chrono>
 
 /*
  * Previous savegame versions, the trunk revision where they were
@@ -282,7 +285,8 @@ FileToSaveLoad _file_to_saveload; ///< File to save or load in the openttd loop.
 uint32 _ttdp_version;     ///< version of TTDP savegame (if applicable)
 uint16 _sl_version;       ///< the major savegame version identifier
 byte   _sl_minor_version; ///< the minor savegame version, DO NOT USE!
-char _savegame_format[8]; ///< how to compress savegames
+char _savegame_format[16]; ///< how to compress savegames
+char _network_savegame_format[16]; ///< how to compress savegames sent to joining clients, empty for #_savegame_format
 bool _do_autosave;        ///< are we doing an autosave at the moment?
 
 extern bool _sl_is_ext_version;
@@ -414,6 +418,7 @@ struct SaveLoadParams {
 
 	MemoryDumper *dumper;                ///< Memory dumper to write the savegame to.
 	SaveFilter *sf;                      ///< Filter to write the savegame to.
+	char *save_format;                   ///< Name and level of the format to write the savegame in, see GetSavegameFormat.
 
 	ReadBuffer *reader;                  ///< Savegame reading buffer.
 	LoadFilter *lf;                      ///< Filter to read the savegame from.
@@ -2571,6 +2576,482 @@ struct LZMASaveFilter : SaveFilter {
 
 #endif /* WITH_LZMA */
 
+/********************************************
+ ********** START OF ZSTD CODE **************
+ ********************************************/
+
+#if defined(WITH_ZSTD)
+#include <zstd.h>
+
+/** Window size (log2) for long distance matching; the largest window decompressors accept by default. */
+static const int SAVEGAME_ZSTD_LONG_WINDOW_LOG = 27;
+
+/** Filter using zstd compression. */
+struct ZSTDLoadFilter : LoadFilter {
+	ZSTD_DCtx *zstd;                   ///< Stream state we are reading from.
+	ZSTD_inBuffer input;               ///< Part of the read buffer not yet decompressed.
+	byte fread_buf[MEMORY_CHUNK_SIZE]; ///< Buffer for reading from the file.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	ZSTDLoadFilter(LoadFilter *chain) : LoadFilter(chain)
+	{
+		this->zstd = ZSTD_createDCtx();
+		if (this->zstd == NULL) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize decompressor");
+		if (ZSTD_isError(ZSTD_DCtx_setParameter(this->zstd, ZSTD_d_windowLogMax, SAVEGAME_ZSTD_LONG_WINDOW_LOG))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize decompressor");
+		this->input.src = this->fread_buf;
+		this->input.size = 0;
+		this->input.pos = 0;
+	}
+
+	/** Clean everything up. */
+	~ZSTDLoadFilter()
+	{
+		ZSTD_freeDCtx(this->zstd);
+	}
+
+	/* virtual */ size_t Read(byte *buf, size_t size)
+	{
+		ZSTD_outBuffer output = { buf, size, 0 };
+
+		while (output.pos < output.size) {
+			/* read more bytes from the file? */
+			if (this->input.pos == this->input.size) {
+				this->input.size = this->chain->Read(this->fread_buf, sizeof(this->fread_buf));
+				this->input.pos = 0;
+			}
+
+			size_t before = output.pos;
+			size_t r = ZSTD_decompressStream(this->zstd, &output, &this->input);
+			if (ZSTD_isError(r)) SlErrorCorruptFmt("ZSTD_decompressStream() failed: %s", ZSTD_getErrorName(r));
+
+			/* End of the file and nothing buffered in the decompressor any more. */
+			if (this->input.size == 0 && output.pos == before) break;
+		}
+
+		return output.pos;
+	}
+};
+
+/**
+ * Filter using zstd compression.
+ * @tparam Tlong_distance Whether to use long distance matching with a large window,
+ *                        which finds repetitions far apart in big maps at the cost of memory.
+ */
+template <bool Tlong_distance>
+struct ZSTDSaveFilter : SaveFilter {
+	ZSTD_CCtx *zstd; ///< Stream state we are writing to.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	ZSTDSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain)
+	{
+		this->zstd = ZSTD_createCCtx();
+		if (this->zstd == NULL) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+
+		bool ok = !ZSTD_isError(ZSTD_CCtx_setParameter(this->zstd, ZSTD_c_compressionLevel, compression_level));
+		if (Tlong_distance) {
+			ok = ok && !ZSTD_isError(ZSTD_CCtx_setParameter(this->zstd, ZSTD_c_enableLongDistanceMatching, 1));
+			ok = ok && !ZSTD_isError(ZSTD_CCtx_setParameter(this->zstd, ZSTD_c_windowLog, SAVEGAME_ZSTD_LONG_WINDOW_LOG));
+		}
+		if (!ok) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+	}
+
+	/** Clean up what we allocated. */
+	~ZSTDSaveFilter()
+	{
+		ZSTD_freeCCtx(this->zstd);
+	}
+
+	/**
+	 * Helper loop for writing the data.
+	 * @param p    The bytes to write.
+	 * @param len  Amount of bytes to write.
+	 * @param mode Mode for ZSTD_compressStream2.
+	 */
+	void WriteLoop(byte *p, size_t len, ZSTD_EndDirective mode)
+	{
+		byte buf[MEMORY_CHUNK_SIZE]; // output buffer
+		ZSTD_inBuffer input = { p, len, 0 };
+		for (;;) {
+			ZSTD_outBuffer output = { buf, sizeof(buf), 0 };
+			size_t r = ZSTD_compressStream2(this->zstd, &output, &input, mode);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "zstd returned error code");
+
+			/* bytes were emitted? */
+			if (output.pos != 0) this->chain->Write(buf, output.pos);
+
+			/* When finishing, r is the amount of data still buffered in the compressor. */
+			if (mode == ZSTD_e_end ? r == 0 : input.pos == input.size) break;
+		}
+	}
+
+	/* virtual */ void Write(byte *buf, size_t size)
+	{
+		this->WriteLoop(buf, size, ZSTD_e_continue);
+	}
+
+	/* virtual */ void Finish()
+	{
+		this->WriteLoop(NULL, 0, ZSTD_e_end);
+		this->chain->Finish();
+	}
+};
+
+#endif /* WITH_ZSTD */
+
+/********************************************
+ ****** START OF BLOCK-PARALLEL CODE ********
+ ********************************************/
+
+/*
+ * The block-parallel format splits the savegame into blocks which are
+ * compressed independently of each other, so that they can be compressed
+ * and decompressed by several threads at once. Each block is preceded by a
+ * header of one byte for the codec, followed by the size of the compressed
+ * and the uncompressed data as big endian 32 bit values. A header with an
+ * uncompressed size of 0 ends the savegame.
+ */
+
+/** Codecs for the blocks of a block-parallel savegame. */
+enum SaveBlockCodec {
+	SBC_STORED = 0, ///< Block stored without compression.
+	SBC_ZLIB   = 1, ///< Block compressed with zlib.
+	SBC_LZMA   = 2, ///< Block compressed with LZMA.
+	SBC_ZSTD   = 3, ///< Block compressed with zstd.
+};
+
+static const size_t SAVE_BLOCK_SIZE = 16 * MEMORY_CHUNK_SIZE; ///< Uncompressed size of a block.
+static const size_t SAVE_BLOCK_HEADER_SIZE = 9;                ///< Size of the header of a block.
+
+/**
+ * Get the number of savegame blocks to keep in flight, enough to keep all
+ * worker threads busy with (de)compressing them.
+ * @return Maximum number of blocks to keep in flight.
+ */
+static uint GetMaxSaveBlocksInFlight()
+{
+	return 2 * (GetWorkerThreadPool().NumWorkers() + 1);
+}
+
+/** A block of a block-parallel savegame being (de)compressed. */
+struct SaveBlock {
+	WorkerTaskGroup task_group; ///< Task group for waiting for the block.
+	byte codec;                 ///< SaveBlockCodec the block is (to be) compressed with.
+	byte level;                 ///< Compression level.
+	bool failed;                ///< Whether decompression failed.
+	size_t raw_size;            ///< Uncompressed size when loading.
+	std::vector<byte> in;       ///< Data to be (de)compressed.
+	std::vector<byte> out;      ///< (De)compressed data.
+
+	SaveBlock(byte codec, byte level) : codec(codec), level(level), failed(false), raw_size(0) {}
+
+	/**
+	 * Compress a block. If compression fails or doesn't make the block
+	 * smaller, the block is stored instead. This method is tailored to
+	 * WorkerThreadPool::Submit.
+	 * @param data The SaveBlock.
+	 */
+	static void Compress(void *data)
+	{
+		SaveBlock *block = (SaveBlock *)data;
+		bool ok = false;
+		switch (block->codec) {
+#if defined(WITH_ZLIB)
+			case SBC_ZLIB: {
+				uLongf len = compressBound((uLong)block->in.size());
+				block->out.resize(len);
+				ok = compress2(block->out.data(), &len, block->in.data(), (uLong)block->in.size(), block->level) == Z_OK;
+				block->out.resize(len);
+				break;
+			}
+#endif /* WITH_ZLIB */
+#if defined(WITH_LZMA)
+			case SBC_LZMA: {
+				/* Limit the dictionary to the block size; more would only cost memory. */
+				lzma_options_lzma options;
+				if (lzma_lzma_preset(&options, block->level)) break;
+				options.dict_size = Clamp<uint32>(options.dict_size, LZMA_DICT_SIZE_MIN, SAVE_BLOCK_SIZE);
+				lzma_filter filters[] = { { LZMA_FILTER_LZMA2, &options }, { LZMA_VLI_UNKNOWN, NULL } };
+				size_t len = 0;
+				block->out.resize(lzma_stream_buffer_bound(block->in.size()));
+				ok = lzma_stream_buffer_encode(filters, LZMA_CHECK_CRC32, NULL, block->in.data(), block->in.size(), block->out.data(), &len, block->out.size()) == LZMA_OK;
+				block->out.resize(len);
+				break;
+			}
+#endif /* WITH_LZMA */
+#if defined(WITH_ZSTD)
+			case SBC_ZSTD: {
+				block->out.resize(ZSTD_compressBound(block->in.size()));
+				size_t len = ZSTD_compress(block->out.data(), block->out.size(), block->in.data(), block->in.size(), block->level);
+				ok = !ZSTD_isError(len);
+				if (ok) block->out.resize(len);
+				break;
+			}
+#endif /* WITH_ZSTD */
+			default:
+				break;
+		}
+		if (!ok || block->out.size() >= block->in.size()) {
+			block->codec = SBC_STORED;
+			block->out.swap(block->in);
+		}
+	}
+
+	/**
+	 * Decompress a block. This method is tailored to WorkerThreadPool::Submit.
+	 * @param data The SaveBlock.
+	 */
+	static void Decompress(void *data)
+	{
+		SaveBlock *block = (SaveBlock *)data;
+		bool ok = false;
+		switch (block->codec) {
+			case SBC_STORED:
+				ok = block->in.size() == block->raw_size;
+				block->out.swap(block->in);
+				break;
+#if defined(WITH_ZLIB)
+			case SBC_ZLIB: {
+				uLongf len = (uLongf)block->raw_size;
+				block->out.resize(block->raw_size);
+				ok = uncompress(block->out.data(), &len, block->in.data(), (uLong)block->in.size()) == Z_OK && len == block->raw_size;
+				break;
+			}
+#endif /* WITH_ZLIB */
+#if defined(WITH_LZMA)
+			case SBC_LZMA: {
+				uint64_t memlimit = UINT64_MAX;
+				size_t in_pos = 0;
+				size_t out_pos = 0;
+				block->out.resize(block->raw_size);
+				ok = lzma_stream_buffer_decode(&memlimit, 0, NULL, block->in.data(), &in_pos, block->in.size(), block->out.data(), &out_pos, block->raw_size) == LZMA_OK && out_pos == block->raw_size;
+				break;
+			}
+#endif /* WITH_LZMA */
+#if defined(WITH_ZSTD)
+			case SBC_ZSTD: {
+				block->out.resize(block->raw_size);
+				size_t len = ZSTD_decompress(block->out.data(), block->raw_size, block->in.data(), block->in.size());
+				ok = !ZSTD_isError(len) && len == block->raw_size;
+				break;
+			}
+#endif /* WITH_ZSTD */
+			default:
+				break;
+		}
+		block->failed = !ok;
+	}
+};
+
+/** Filter decompressing blocks of a block-parallel savegame on several threads. */
+struct BlockLoadFilter : LoadFilter {
+	std::deque<SaveBlock *> blocks; ///< Blocks read ahead, in the order of the savegame.
+	size_t read_pos;                ///< Read position in the first block's decompressed data.
+	bool finished;                  ///< Whether the end of the savegame has been read.
+	uint max_blocks;                ///< Maximum number of blocks to read ahead.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	BlockLoadFilter(LoadFilter *chain) : LoadFilter(chain), read_pos(0), finished(false)
+	{
+		this->max_blocks = GetMaxSaveBlocksInFlight();
+	}
+
+	/** Clean everything up. */
+	~BlockLoadFilter()
+	{
+		this->Clear();
+	}
+
+	/** Wait for and drop all blocks read ahead. */
+	void Clear()
+	{
+		for (SaveBlock *block : this->blocks) {
+			GetWorkerThreadPool().Wait(&block->task_group);
+			delete block;
+		}
+		this->blocks.clear();
+		this->read_pos = 0;
+	}
+
+	/**
+	 * Read exactly the given amount of bytes from the chain.
+	 * @param buf Buffer to read into.
+	 * @param size Number of bytes to read.
+	 */
+	void ReadChain(byte *buf, size_t size)
+	{
+		while (size > 0) {
+			size_t read = this->chain->Read(buf, size);
+			if (read == 0) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "savegame block truncated");
+			buf += read;
+			size -= read;
+		}
+	}
+
+	/** Read blocks from the chain and queue them for decompression until enough are in flight. */
+	void ReadAhead()
+	{
+		while (!this->finished && this->blocks.size() < this->max_blocks) {
+			byte header[SAVE_BLOCK_HEADER_SIZE];
+			this->ReadChain(header, sizeof(header));
+			uint32 comp_size = ReadBE32(header + 1);
+			uint32 raw_size = ReadBE32(header + 5);
+			if (raw_size == 0) {
+				this->finished = true;
+				break;
+			}
+			if (raw_size > SAVE_BLOCK_SIZE || comp_size > 2 * SAVE_BLOCK_SIZE) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "invalid savegame block size");
+
+			SaveBlock *block = new SaveBlock(header[0], 0);
+			this->blocks.push_back(block);
+			block->raw_size = raw_size;
+			block->in.resize(comp_size);
+			this->ReadChain(block->in.data(), comp_size);
+			GetWorkerThreadPool().Submit(&SaveBlock::Decompress, block, &block->task_group);
+		}
+	}
+
+	/* virtual */ size_t Read(byte *buf, size_t size)
+	{
+		size_t done = 0;
+		while (done < size) {
+			this->ReadAhead();
+			if (this->blocks.empty()) break;
+
+			SaveBlock *block = this->blocks.front();
+			GetWorkerThreadPool().Wait(&block->task_group);
+			if (block->failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "savegame block decompression failed");
+
+			size_t n = min(size - done, block->out.size() - this->read_pos);
+			MemCpyT(buf + done, block->out.data() + this->read_pos, n);
+			done += n;
+			this->read_pos += n;
+			if (this->read_pos == block->out.size()) {
+				delete block;
+				this->blocks.pop_front();
+				this->read_pos = 0;
+			}
+		}
+		return done;
+	}
+
+	/* virtual */ void Reset()
+	{
+		this->Clear();
+		this->finished = false;
+		this->chain->Reset();
+	}
+
+	/** Read a big endian 32 bit value. */
+	static inline uint32 ReadBE32(const byte *p)
+	{
+		return ((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | (uint32)p[3];
+	}
+};
+
+/**
+ * Filter compressing the savegame in blocks on several threads.
+ * @tparam Tcodec SaveBlockCodec to compress with.
+ */
+template <SaveBlockCodec Tcodec>
+struct BlockSaveFilter : SaveFilter {
+	std::deque<SaveBlock *> blocks; ///< Blocks being compressed, in the order of the savegame.
+	SaveBlock *current;             ///< Block being filled.
+	byte compression_level;         ///< Compression level for the blocks.
+	uint max_blocks;                ///< Maximum number of blocks to compress at once.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	BlockSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain), current(NULL), compression_level(compression_level)
+	{
+		this->max_blocks = GetMaxSaveBlocksInFlight();
+	}
+
+	/** Clean up what we allocated. */
+	~BlockSaveFilter()
+	{
+		for (SaveBlock *block : this->blocks) {
+			GetWorkerThreadPool().Wait(&block->task_group);
+			delete block;
+		}
+		delete this->current;
+	}
+
+	/**
+	 * Write a block header to the chain.
+	 * @param codec Codec of the block.
+	 * @param comp_size Compressed size.
+	 * @param raw_size Uncompressed size.
+	 */
+	void WriteHeader(byte codec, uint32 comp_size, uint32 raw_size)
+	{
+		byte header[SAVE_BLOCK_HEADER_SIZE];
+		header[0] = codec;
+		for (uint i = 0; i < 4; i++) {
+			header[1 + i] = GB(comp_size, 24 - 8 * i, 8);
+			header[5 + i] = GB(raw_size, 24 - 8 * i, 8);
+		}
+		this->chain->Write(header, sizeof(header));
+	}
+
+	/** Wait for the first block in flight and write it to the chain. */
+	void WriteFront()
+	{
+		SaveBlock *block = this->blocks.front();
+		this->blocks.pop_front();
+		GetWorkerThreadPool().Wait(&block->task_group);
+		this->WriteHeader(block->codec, (uint32)block->out.size(), (uint32)block->raw_size);
+		this->chain->Write(block->out.data(), block->out.size());
+		delete block;
+	}
+
+	/** Queue the current block for compression. */
+	void SubmitCurrent()
+	{
+		SaveBlock *block = this->current;
+		this->current = NULL;
+		block->raw_size = block->in.size();
+		this->blocks.push_back(block);
+		GetWorkerThreadPool().Submit(&SaveBlock::Compress, block, &block->task_group);
+		while (this->blocks.size() > this->max_blocks) this->WriteFront();
+	}
+
+	/* virtual */ void Write(byte *buf, size_t size)
+	{
+		while (size > 0) {
+			if (this->current == NULL) {
+				this->current = new SaveBlock(Tcodec, this->compression_level);
+				this->current->in.reserve(SAVE_BLOCK_SIZE);
+			}
+			size_t n = min(size, SAVE_BLOCK_SIZE - this->current->in.size());
+			this->current->in.insert(this->current->in.end(), buf, buf + n);
+			buf += n;
+			size -= n;
+			if (this->current->in.size() == SAVE_BLOCK_SIZE) this->SubmitCurrent();
+		}
+	}
+
+	/* virtual */ void Finish()
+	{
+		if (this->current != NULL && !this->current->in.empty()) this->SubmitCurrent();
+		while (!this->blocks.empty()) this->WriteFront();
+		this->WriteHeader(SBC_STORED, 0, 0);
+		this->chain->Finish();
+	}
+};
+
 /*******************************************
  ************* END OF CODE *****************
  *******************************************/
@@ -2602,18 +3083,36 @@ static const SaveLoadFormat _saveload_formats[] = {
 	/* After level 6 the speed reduction is significant (1.5x to 2.5x slower per level), but the reduction in filesize is
 	 * fairly insignificant (~1% for each step). Lower levels become ~5-10% bigger by each level than level 6 while level
 	 * 1 is "only" 3 times as fast. Level 0 results in uncompressed savegames at about 8 times the cost of "none". */
+	/* Blocks compressed independently with zlib on several threads, only marginally larger than zlib. */
+	{"zlib_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, CreateSaveFilter<BlockSaveFilter<SBC_ZLIB> >, 0, 6, 9},
 	{"zlib",   TO_BE32X('OTTZ'), CreateLoadFilter<ZlibLoadFilter>,   CreateSaveFilter<ZlibSaveFilter>,   0, 6, 9},
 #else
+	{"zlib_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, NULL,                               0, 0, 0},
 	{"zlib",   TO_BE32X('OTTZ'), NULL,                               NULL,                               0, 0, 0},
 #endif
+#if defined(WITH_ZSTD)
+	/* Level 6 compresses to about the size of LZMA level 2 at several times the speed; decompression is faster than zlib at any level.
+	 * Levels above 15 get a lot slower for a few percent in filesize. "zstd_ldm" additionally uses long distance matching with a
+	 * 128 MiB window, which helps big maps with lots of repetition, but needs more memory when saving and loading. */
+	{"zstd_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, CreateSaveFilter<BlockSaveFilter<SBC_ZSTD> >, 1, 6, 19},
+	{"zstd",   TO_BE32X('OTTS'), CreateLoadFilter<ZSTDLoadFilter>,   CreateSaveFilter<ZSTDSaveFilter<false> >, 1, 6, 19},
+	{"zstd_ldm", TO_BE32X('OTTS'), CreateLoadFilter<ZSTDLoadFilter>, CreateSaveFilter<ZSTDSaveFilter<true> >, 1, 6, 19},
+#else
+	{"zstd_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, NULL,                               0, 0, 0},
+	{"zstd",   TO_BE32X('OTTS'), NULL,                               NULL,                               0, 0, 0},
+	{"zstd_ldm", TO_BE32X('OTTS'), NULL,                             NULL,                               0, 0, 0},
+#endif
 #if defined(WITH_LZMA)
 	/* Level 2 compression is speed wise as fast as zlib level 6 compression (old default), but results in ~10% smaller saves.
 	 * Higher compression levels are possible, and might improve savegame size by up to 25%, but are also up to 10 times slower.
 	 * The next significant reduction in file size is at level 4, but that is already 4 times slower. Level 3 is primarily 50%
 	 * slower while not improving the filesize, while level 0 and 1 are faster, but don't reduce savegame size much.
 	 * It's OTTX and not e.g. OTTL because liblzma is part of xz-utils and .tar.xz is preferred over .tar.lzma. */
+	/* Blocks compressed independently with LZMA on several threads, each with its dictionary limited to the block size. */
+	{"lzma_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, CreateSaveFilter<BlockSaveFilter<SBC_LZMA> >, 0, 2, 9},
 	{"lzma",   TO_BE32X('OTTX'), CreateLoadFilter<LZMALoadFilter>,   CreateSaveFilter<LZMASaveFilter>,   0, 2, 9},
 #else
+	{"lzma_mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>, NULL,                               0, 0, 0},
 	{"lzma",   TO_BE32X('OTTX'), NULL,                               NULL,                               0, 0, 0},
 #endif
 };
@@ -2753,7 +3252,7 @@ static SaveOrLoadResult SaveFileToDisk(bool threaded)
 {
 	try {
 		byte compression;
-		const SaveLoadFormat *fmt = GetSavegameFormat(_savegame_format, &compression);
+		const SaveLoadFormat *fmt = GetSavegameFormat(_sl.save_format, &compression);
 
 		/* We have written our stuff to memory, now write it to file! */
 		uint32 hdr[2] = { fmt->tag, TO_BE32((SAVEGAME_VERSION | SAVEGAME_VERSION_EXT) << 16) };
@@ -2813,14 +3312,16 @@ void WaitTillSaved()
  * using the writer, either in threaded mode if possible, or single-threaded.
  * @param writer   The filter to write the savegame to.
  * @param threaded Whether to try to perform the saving asynchronously.
+ * @param format   Name and level of the savegame format to use.
  * @return Return the result of the action. #SL_OK or #SL_ERROR
  */
-static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
+static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded, char *format)
 {
 	assert(!_sl.saveinprogress);
 
 	_sl.dumper = new MemoryDumper();
 	_sl.sf = writer;
+	_sl.save_format = format;
 
 	_sl_version = SAVEGAME_VERSION;
 	SlXvSetCurrentState();
@@ -2845,19 +3346,116 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
  * Save the game using a (writer) filter.
  * @param writer   The filter to write the savegame to.
  * @param threaded Whether to try to perform the saving asynchronously.
+ * @param format   Name and level of the savegame format to use, or NULL for #_savegame_format.
  * @return Return the result of the action. #SL_OK or #SL_ERROR
  */
-SaveOrLoadResult SaveWithFilter(SaveFilter *writer, bool threaded)
+SaveOrLoadResult SaveWithFilter(SaveFilter *writer, bool threaded, char *format)
 {
 	try {
 		_sl.action = SLA_SAVE;
-		return DoSave(writer, threaded);
+		return DoSave(writer, threaded, StrEmpty(format) ? _savegame_format : format);
 	} catch (...) {
 		ClearSaveLoadState();
 		return SL_ERROR;
 	}
 }
 
+/** Filter collecting the written savegame in memory, for benchmarking the savegame formats. */
+struct BufferSaveFilter : SaveFilter {
+	std::vector<byte> &data; ///< Buffer to write to.
+
+	/**
+	 * Initialise this filter.
+	 * @param data Buffer to write to.
+	 */
+	BufferSaveFilter(std::vector<byte> &data) : SaveFilter(NULL), data(data) {}
+
+	/* virtual */ void Write(byte *buf, size_t len)
+	{
+		this->data.insert(this->data.end(), buf, buf + len);
+	}
+
+	/* virtual */ void Finish() {}
+};
+
+/** Filter reading a savegame from memory, for benchmarking the savegame formats. */
+struct BufferLoadFilter : LoadFilter {
+	const std::vector<byte> &data; ///< Buffer to read from.
+	size_t pos;                    ///< Read position in the buffer.
+
+	/**
+	 * Initialise this filter.
+	 * @param data Buffer to read from.
+	 */
+	BufferLoadFilter(const std::vector<byte> &data) : LoadFilter(NULL), data(data), pos(0) {}
+
+	/* virtual */ size_t Read(byte *buf, size_t len)
+	{
+		len = min(len, this->data.size() - this->pos);
+		MemCpyT(buf, this->data.data() + this->pos, len);
+		this->pos += len;
+		return len;
+	}
+
+	/* virtual */ void Reset()
+	{
+		this->pos = 0;
+	}
+};
+
+/**
+ * Save the current game to memory with every savegame format which can be
+ * written and load it again, printing the size and the time taken to the console.
+ * @param level Compression level to use, or -1 for the default level of each format.
+ */
+void BenchmarkSavegameFormats(int level)
+{
+	if (_sl.saveinprogress) {
+		IConsolePrint(CC_ERROR, "A savegame is currently being written.");
+		return;
+	}
+
+	try {
+		_sl.action = SLA_SAVE;
+		_sl.dumper = new MemoryDumper();
+		_sl_version = SAVEGAME_VERSION;
+		SlXvSetCurrentState();
+		SaveViewportBeforeSaveGame();
+		SlSaveChunks();
+
+		size_t raw_size = _sl.dumper->GetSize();
+		IConsolePrintF(CC_DEFAULT, "Uncompressed savegame: " PRINTF_SIZE " bytes", raw_size);
+
+		std::vector<byte> data;
+		byte buf[MEMORY_CHUNK_SIZE];
+		for (const SaveLoadFormat *slf = &_saveload_formats[0]; slf != endof(_saveload_formats); slf++) {
+			if (slf->init_write == NULL || slf->init_load == NULL) continue;
+			byte compression = (level < 0) ? slf->default_compression : (byte)Clamp(level, slf->min_compression, slf->max_compression);
+
+			data.clear();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			SaveFilter *sf = slf->init_write(new BufferSaveFilter(data), compression);
+			_sl.dumper->Flush(sf);
+			delete sf;
+			uint64 save_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			LoadFilter *lf = slf->init_load(new BufferLoadFilter(data));
+			size_t loaded = 0;
+			for (size_t len; (len = lf->Read(buf, sizeof(buf))) != 0;) loaded += len;
+			delete lf;
+			uint64 load_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+			IConsolePrintF(loaded == raw_size ? CC_DEFAULT : CC_ERROR, "%s:%u: " PRINTF_SIZE " bytes (%u%%), save " OTTD_PRINTF64U " us, load " OTTD_PRINTF64U " us%s",
+					slf->name, compression, data.size(), (uint)(raw_size == 0 ? 100 : data.size() * 100 / raw_size), save_time, load_time,
+					loaded == raw_size ? "" : "; loaded size differs");
+		}
+	} catch (...) {
+		IConsolePrintF(CC_ERROR, "Benchmark failed: %s", GetSaveLoadErrorString() + 3);
+	}
+	ClearSaveLoadState();
+}
+
 /**
  * Actually perform the loading of a "non-old" savegame.
  * @param reader     The filter to read the savegame from.
@@ -3101,7 +3699,7 @@ SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, Detaile
 			DEBUG(desync, 1, "save: date{%08x; %02x; %02x}; %s", _date, _date_fract, _tick_skip_counter, filename);
 			if (_network_server || !_settings_client.gui.threaded_saves) threaded = false;
 
-			return DoSave(new FileWriter(fh), threaded);
+			return DoSave(new FileWriter(fh), threaded, _savegame_format);
 		}
 
 		/* LOAD game */
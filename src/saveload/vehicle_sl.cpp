@@ -624,6 +624,7 @@ const SaveLoad *GetVehicleDescription(VehicleType vt)
 		 SLE_CONDDEQ(Vehicle, cargo.packets,         REF_CARGO_PACKET,            68, SL_MAX_VERSION),
 		 SLE_CONDARR(Vehicle, cargo.action_counts,   SLE_UINT, VehicleCargoList::NUM_MOVE_TO_ACTION, 181, SL_MAX_VERSION),
 		 SLE_CONDVAR(Vehicle, cargo_age_counter,     SLE_UINT16,                 162, SL_MAX_VERSION),
+		SLE_CONDVAR_X(Vehicle, cargo.pending_aging,  SLE_UINT8,                    0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_LAZY_CARGO_AGING)),
 
 		     SLE_VAR(Vehicle, day_counter,           SLE_UINT8),
 		     SLE_VAR(Vehicle, tick_counter,          SLE_UINT8),
@@ -766,6 +767,10 @@ const SaveLoad *GetVehicleDescription(VehicleType vt)
 		SLE_CONDNULL(4,                                                              69, 130),
 		SLE_CONDNULL(2,                                                               6, 130),
 		SLE_CONDNULL(16,                                                              2, 143), // old reserved space
+		SLE_CONDVARVEC_X(RoadVehicle, path.tile,        SLE_UINT32,                   0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE)),
+		SLE_CONDVARVEC_X(RoadVehicle, path.td,          SLE_UINT8,                    0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE)),
+		SLE_CONDVAR_X(RoadVehicle, path.dest_tile,      SLE_UINT32,                   0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE)),
+		SLE_CONDNULL_X(4,                                                             0, SL_MAX_VERSION, SlXvFeatureTest(XSLFTO_AND, XSLFI_ROADVEH_PATH_CACHE, 2, 2)), // path.layout_generation
 
 		     SLE_END()
 	};
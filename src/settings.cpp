@@ -72,6 +72,8 @@
 #include "void_map.h"
 #include "station_base.h"
 #include "infrastructure_func.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 #include "table/settings.h"
@@ -1330,6 +1332,9 @@ static bool CheckFreeformEdges(int32 p1)
 			MakeSea(TileXY(0, i));
 		}
 	}
+	/* The northern edges turned from water into void or vice versa. */
+	for (uint i = 0; i < MapSizeX(); i++) InvalidateWaterRegion(TileXY(i, 0));
+	for (uint i = 0; i < MapSizeY(); i++) InvalidateWaterRegion(TileXY(0, i));
 	MarkWholeScreenDirty();
 	return true;
 }
@@ -1371,6 +1376,20 @@ static bool ChangeMaxHeightLevel(int32 p1)
 	return true;
 }
 
+/** Cached rail segment costs include the penalties, so drop them all. */
+static bool RailPathfinderPenaltyChanged(int32 p1)
+{
+	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	return true;
+}
+
+/** Cached road segment costs include the penalties, so drop them all. */
+static bool RoadPathfinderPenaltyChanged(int32 p1)
+{
+	YapfNotifyRoadLayoutChange(INVALID_TILE);
+	return true;
+}
+
 static bool StationCatchmentChanged(int32 p1)
 {
 	Station::RecomputeIndustriesNearForAll();
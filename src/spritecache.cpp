@@ -38,7 +38,9 @@ struct SpriteCache {
 	size_t file_pos;
 	uint32 id;
 	uint16 file_slot;
-	int16 lru;
+	uint32 lru_prev;     ///< The sprite used just after this one, or #LRU_NONE. Only valid while the sprite is in the LRU list.
+	uint32 lru_next;     ///< The sprite used just before this one, or #LRU_NONE. Only valid while the sprite is in the LRU list.
+	ZoomLevelByte zoom;  ///< Most detailed zoom level the sprite was read with, for the statistics.
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
@@ -78,18 +80,48 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
+/** Header of a block of memory in the sprite cache. */
 struct MemBlock {
-	size_t size;
+	size_t size;      ///< Size of the block including this header. The bits of #S_FREE_MASK are set when the block is free.
+	uint32 prev_size; ///< Size of the block just before this one in memory, 0 for the first block.
+	SpriteID sprite;  ///< The sprite stored in the block, while it is in use.
 	byte data[];
 };
 
-static uint _sprite_lru_counter;
+/** Links of a free block to the other free blocks of its size class, stored in the data of the block. */
+struct FreeBlockLinks {
+	MemBlock *prev; ///< Previous free block of the size class, or NULL.
+	MemBlock *next; ///< Next free block of the size class, or NULL.
+};
+
+/** Number of size classes of free blocks; class \c n has the blocks of 2^n up to 2^(n+1) bytes. */
+static const uint SPRITE_CACHE_SIZE_CLASSES = 32;
+
+/** End of the LRU list. */
+static const uint32 LRU_NONE = UINT32_MAX;
+
+static uint32 _sprite_lru_head = LRU_NONE; ///< The most recently used sprite.
+static uint32 _sprite_lru_tail = LRU_NONE; ///< The least recently used sprite, which is evicted first.
+static uint _sprite_cache_evictions; ///< Number of times a sprite was removed from or moved in the cache.
+static bool _sprite_cache_read_only; ///< Whether the cache may be read by several threads, so must not change.
 static MemBlock *_spritecache_ptr;
 static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+static MemBlock *_free_blocks[SPRITE_CACHE_SIZE_CLASSES]; ///< First free block of each size class.
+static uint32 _free_block_classes;   ///< Bit mask of the size classes which have free blocks.
+static uint _free_block_count;       ///< Number of free blocks.
+static size_t _free_block_bytes;     ///< Total size of the free blocks.
+static bool _sprite_cache_fragmented; ///< Whether a sprite had to be evicted though there was enough free memory in total.
+
+static uint64 _sprite_cache_hits;       ///< Number of requests of sprites that were in the cache.
+static uint64 _sprite_cache_misses;     ///< Number of requests of sprites that had to be read.
+static uint64 _sprite_cache_lru_evictions; ///< Number of sprites evicted to make room for others.
+static uint32 _sprite_cache_rate_tick;   ///< Real time tick at which the eviction rate was last measured.
+static uint64 _sprite_cache_rate_evictions; ///< Number of evictions when the eviction rate was last measured.
+static uint _sprite_cache_eviction_rate; ///< Number of evictions in the last measured second.
 
 static void CompactSpriteCache();
 static void *AllocSprite(size_t mem_req);
+static void DeleteEntryFromSpriteCache(uint item);
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -399,9 +431,10 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
  * @param id          Sprite number.
  * @param sprite_type Type of sprite.
  * @param allocator   Allocator function to use.
+ * @param[out] zoom   If not NULL, the most detailed zoom level the sprite was read with.
  * @return Read sprite data.
  */
-static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator, ZoomLevel *zoom = NULL)
 {
 	uint8 file_slot = sc->file_slot;
 	size_t file_pos = sc->file_pos;
@@ -435,6 +468,8 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
 	}
 
+	if (zoom != NULL) *zoom = (ZoomLevel)FIND_FIRST_BIT(sprite_avail);
+
 	if (sprite_type == ST_MAPGEN) {
 		/* Ugly hack to work around the problem that the old landscape
 		 *  generator assumes that those sprites are stored uncompressed in
@@ -582,10 +617,11 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	if (sc->ptr != NULL) DeleteEntryFromSpriteCache(load_index);
+	if (data != NULL) ((MemBlock *)data - 1)->sprite = load_index;
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
@@ -599,6 +635,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 {
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
+	if (scnew->ptr != NULL) DeleteEntryFromSpriteCache(new_spr);
 
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
@@ -617,8 +654,12 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
  */
 static const size_t S_FREE_MASK = sizeof(size_t) - 1;
 
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
+/** Size of the smallest block, which must be able to hold the links of a free block. */
+static const size_t S_MIN_BLOCK_SIZE = sizeof(MemBlock) + sizeof(FreeBlockLinks);
+
+/* to make sure MemBlock keeps the data correctly aligned */
+assert_compile(sizeof(MemBlock) % sizeof(size_t) == 0);
+assert_compile(S_MIN_BLOCK_SIZE % sizeof(size_t) == 0);
 /* make sure it's a power of two */
 assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
 
@@ -627,89 +668,225 @@ static inline MemBlock *NextBlock(MemBlock *block)
 	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
 }
 
-static size_t GetSpriteCacheUsage()
+static inline MemBlock *PrevBlock(MemBlock *block)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
+	return (MemBlock*)((byte*)block - block->prev_size);
+}
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
-	}
+/** The sentinel block at the end of the sprite cache, identified by size == 0. */
+static inline MemBlock *GetSentinelBlock()
+{
+	return (MemBlock*)((byte*)_spritecache_ptr + _allocated_sprite_cache_size - sizeof(MemBlock));
+}
 
-	return tot_size;
+static inline FreeBlockLinks *GetFreeBlockLinks(MemBlock *block)
+{
+	return (FreeBlockLinks*)block->data;
 }
 
+/**
+ * Get the size class of a block.
+ * @param size The size of the block.
+ * @return The size class.
+ */
+static inline uint GetSizeClass(size_t size)
+{
+	return FindLastBit(size);
+}
 
-void IncreaseSpriteLRU()
+/**
+ * Add a free block to the list of its size class.
+ * @param block The free block.
+ */
+static void LinkFreeBlock(MemBlock *block)
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	size_t size = block->size & ~S_FREE_MASK;
+	uint size_class = GetSizeClass(size);
+	FreeBlockLinks *links = GetFreeBlockLinks(block);
+	links->prev = NULL;
+	links->next = _free_blocks[size_class];
+	if (links->next != NULL) GetFreeBlockLinks(links->next)->prev = block;
+	_free_blocks[size_class] = block;
+	SetBit(_free_block_classes, size_class);
+	_free_block_count++;
+	_free_block_bytes += size;
+}
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+/**
+ * Remove a free block from the list of its size class.
+ * @param block The free block.
+ */
+static void UnlinkFreeBlock(MemBlock *block)
+{
+	size_t size = block->size & ~S_FREE_MASK;
+	uint size_class = GetSizeClass(size);
+	FreeBlockLinks *links = GetFreeBlockLinks(block);
+	if (links->prev != NULL) {
+		GetFreeBlockLinks(links->prev)->next = links->next;
+	} else {
+		_free_blocks[size_class] = links->next;
+		if (links->next == NULL) ClrBit(_free_block_classes, size_class);
+	}
+	if (links->next != NULL) GetFreeBlockLinks(links->next)->prev = links->prev;
+	_free_block_count--;
+	_free_block_bytes -= size;
+}
 
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != NULL) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
-			}
+/**
+ * Free a block, and merge it with the free blocks before and after it.
+ * @param block The block, which must be in use.
+ */
+static void FreeBlock(MemBlock *block)
+{
+	assert(!(block->size & S_FREE_MASK));
+	size_t size = block->size;
+
+	MemBlock *next = NextBlock(block);
+	if (next->size & S_FREE_MASK) {
+		UnlinkFreeBlock(next);
+		size += next->size & ~S_FREE_MASK;
+	}
+	if (block->prev_size != 0) {
+		MemBlock *prev = PrevBlock(block);
+		if (prev->size & S_FREE_MASK) {
+			UnlinkFreeBlock(prev);
+			size += prev->size & ~S_FREE_MASK;
+			block = prev;
 		}
-		_sprite_lru_counter = 0;
 	}
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
+	block->size = size | S_FREE_MASK;
+	NextBlock(block)->prev_size = (uint32)size;
+	LinkFreeBlock(block);
+}
+
+/**
+ * Find a free block that is large enough.
+ * @param mem_req The size the block must have at least.
+ * @return The block, or NULL if there is none.
+ */
+static MemBlock *FindFreeBlock(size_t mem_req)
+{
+	uint size_class = GetSizeClass(mem_req);
+
+	/* Blocks of the same size class may be too small; only look at a few of them. */
+	uint tries = 16;
+	for (MemBlock *s = _free_blocks[size_class]; s != NULL && tries != 0; s = GetFreeBlockLinks(s)->next, tries--) {
+		if ((s->size & ~S_FREE_MASK) >= mem_req) return s;
 	}
+
+	/* Any block of a larger size class is large enough. */
+	uint32 larger = _free_block_classes & ~((2U << size_class) - 1);
+	return larger != 0 ? _free_blocks[FindFirstBit(larger)] : NULL;
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Put a sprite in front of the LRU list.
+ * @param item The sprite, which must not be in the list.
  */
-static void CompactSpriteCache()
+static void LinkSpriteLRU(uint32 item)
 {
-	MemBlock *s;
+	SpriteCache *sc = GetSpriteCache(item);
+	sc->lru_prev = LRU_NONE;
+	sc->lru_next = _sprite_lru_head;
+	if (_sprite_lru_head != LRU_NONE) {
+		GetSpriteCache(_sprite_lru_head)->lru_prev = item;
+	} else {
+		_sprite_lru_tail = item;
+	}
+	_sprite_lru_head = item;
+}
 
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+/**
+ * Remove a sprite from the LRU list.
+ * @param item The sprite, which must be in the list.
+ */
+static void UnlinkSpriteLRU(uint32 item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	if (sc->lru_prev != LRU_NONE) {
+		GetSpriteCache(sc->lru_prev)->lru_next = sc->lru_next;
+	} else {
+		_sprite_lru_head = sc->lru_next;
+	}
+	if (sc->lru_next != LRU_NONE) {
+		GetSpriteCache(sc->lru_next)->lru_prev = sc->lru_prev;
+	} else {
+		_sprite_lru_tail = sc->lru_prev;
+	}
+}
 
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
+/**
+ * Get the memory used by the sprite cache.
+ * @return Number of bytes in use.
+ */
+static size_t GetSpriteCacheUsage()
+{
+	return _allocated_sprite_cache_size - sizeof(MemBlock) - _free_block_bytes;
+}
 
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
+/** Measure the eviction rate and compact the sprite cache when needed; called every tick. */
+void MaintainSpriteCache()
+{
+	uint32 elapsed = _realtime_tick - _sprite_cache_rate_tick;
+	if (elapsed >= 1000) {
+		_sprite_cache_eviction_rate = (uint)((_sprite_cache_lru_evictions - _sprite_cache_rate_evictions) * 1000 / elapsed);
+		_sprite_cache_rate_evictions = _sprite_cache_lru_evictions;
+		_sprite_cache_rate_tick = _realtime_tick;
+	}
 
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+	/* Remove the holes in the sprite cache once they made sprites be evicted unnecessarily. */
+	if (_sprite_cache_fragmented) {
+		CompactSpriteCache();
+		_sprite_cache_fragmented = false;
+	}
+}
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+/**
+ * Called when holes in the sprite cache should be removed.
+ * That is accomplished by moving the cached data, after which
+ * all free memory is a single block at the end.
+ */
+static void CompactSpriteCache()
+{
+	if (_free_block_count <= 1) return;
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
+	MemBlock *dest = _spritecache_ptr;
+	uint32 prev_size = 0;
+	for (MemBlock *s = _spritecache_ptr; s->size != 0;) {
+		MemBlock *next = NextBlock(s);
+		if (!(s->size & S_FREE_MASK)) {
+			size_t size = s->size;
+			if (dest != s) {
+				memmove(dest, s, size);
+				SpriteCache *sc = GetSpriteCache(dest->sprite);
+				assert(sc->ptr == s->data);
+				sc->ptr = dest->data; // Adjust sprite array entry
+				_sprite_cache_evictions++;
 			}
-		} else {
-			s = NextBlock(s);
+			dest->prev_size = prev_size;
+			prev_size = (uint32)size;
+			dest = NextBlock(dest);
 		}
+		s = next;
 	}
+
+	MemSetT(_free_blocks, 0, lengthof(_free_blocks));
+	_free_block_classes = 0;
+	_free_block_count = 0;
+	_free_block_bytes = 0;
+
+	MemBlock *sentinel = GetSentinelBlock();
+	if (dest != sentinel) {
+		size_t size = (byte*)sentinel - (byte*)dest;
+		dest->size = size | S_FREE_MASK;
+		dest->prev_size = prev_size;
+		prev_size = (uint32)size;
+		LinkFreeBlock(dest);
+	}
+	sentinel->prev_size = prev_size;
 }
 
 /**
@@ -718,43 +895,28 @@ static void CompactSpriteCache()
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = NULL;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		}
-	}
+	SpriteCache *sc = GetSpriteCache(item);
+	MemBlock *s = (MemBlock*)sc->ptr - 1;
+	assert(s->sprite == item);
+
+	/* Recolour sprites are never evicted, so they are not in the LRU list. */
+	if (sc->type != ST_RECOLOUR) UnlinkSpriteLRU(item);
+	FreeBlock(s);
+	sc->ptr = NULL;
+	_sprite_cache_evictions++;
 }
 
+/** Delete the least recently used sprite from the sprite cache. */
 static void DeleteEntryFromSpriteCache()
 {
-	uint best = UINT_MAX;
-	int cur_lru;
-
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
-		}
-	}
+	DEBUG(sprite, 5, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
 
 	/* Display an error message and die, in case we found no sprite at all.
 	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+	if (_sprite_lru_tail == LRU_NONE) error("Out of sprite memory");
 
-	DeleteEntryFromSpriteCache(best);
+	DeleteEntryFromSpriteCache(_sprite_lru_tail);
+	_sprite_cache_lru_evictions++;
 }
 
 static void *AllocSprite(size_t mem_req)
@@ -763,33 +925,32 @@ static void *AllocSprite(size_t mem_req)
 
 	/* Align this to correct boundary. This also makes sure at least one
 	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
+	mem_req = max(Align(mem_req, S_FREE_MASK + 1), S_MIN_BLOCK_SIZE);
 
 	for (;;) {
-		MemBlock *s;
-
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
-
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
-
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
-
-					return s->data;
-				}
+		MemBlock *s = FindFreeBlock(mem_req);
+		if (s != NULL) {
+			UnlinkFreeBlock(s);
+			size_t cur_size = s->size & ~S_FREE_MASK;
+
+			/* Split off the rest, if it is big enough for a free block. */
+			if (cur_size >= mem_req + S_MIN_BLOCK_SIZE) {
+				s->size = mem_req;
+				MemBlock *rest = NextBlock(s);
+				rest->size = (cur_size - mem_req) | S_FREE_MASK;
+				rest->prev_size = (uint32)mem_req;
+				NextBlock(rest)->prev_size = (uint32)(cur_size - mem_req);
+				LinkFreeBlock(rest);
+			} else {
+				s->size = cur_size;
 			}
+
+			s->sprite = 0;
+			return s->data;
 		}
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
+		/* No free block is big enough. Delete some old entry. */
+		if (_free_block_bytes >= mem_req) _sprite_cache_fragmented = true;
 		DeleteEntryFromSpriteCache();
 	}
 }
@@ -864,13 +1025,38 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	if (sc->type != type) return HandleInvalidSpriteRequest(sprite, type, sc, allocator);
 
 	if (allocator == NULL) {
+		if (_sprite_cache_read_only) {
+			/* All sprites used in this phase have been loaded before. */
+			assert(sc->ptr != NULL);
+			return sc->ptr;
+		}
+
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		/* Recolour sprites stay in the cache once they are loaded. */
+		if (type == ST_RECOLOUR && sc->ptr != NULL) return sc->ptr;
+
+		if (sc->ptr != NULL) {
+			/* Update LRU */
+			if (_sprite_lru_head != sprite) {
+				UnlinkSpriteLRU(sprite);
+				LinkSpriteLRU(sprite);
+			}
+			_sprite_cache_hits++;
+			return sc->ptr;
+		}
 
 		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == NULL) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		_sprite_cache_misses++;
+		ZoomLevel zoom = ZOOM_LVL_NORMAL;
+		void *ptr = ReadSprite(sc, sprite, type, AllocSprite, &zoom);
+		if (ptr != NULL) {
+			((MemBlock *)ptr - 1)->sprite = sprite;
+			sc->zoom = zoom;
+			/* Recolour sprites are never evicted, so they are not in the LRU list. */
+			if (type != ST_RECOLOUR) LinkSpriteLRU(sprite);
+		}
+		sc->ptr = ptr;
 
 		return sc->ptr;
 	} else {
@@ -879,6 +1065,83 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	}
 }
 
+/**
+ * Get the number of times a sprite was removed from the cache or moved within
+ * it. As long as this doesn't change, pointers to cached sprites stay valid.
+ * @return The number of evictions so far.
+ */
+uint GetSpriteCacheEvictions()
+{
+	return _sprite_cache_evictions;
+}
+
+/**
+ * Allow or disallow reading the sprite cache from several threads at once.
+ * While the cache is read only, only sprites that are already cached may be
+ * requested and their LRU values are not updated.
+ * @param read_only Whether the cache is read only.
+ */
+void SetSpriteCacheReadOnly(bool read_only)
+{
+	_sprite_cache_read_only = read_only;
+}
+
+/** Reset the counters of the hit rate and the evictions of the sprite cache. */
+void ResetSpriteCacheStats()
+{
+	_sprite_cache_hits = 0;
+	_sprite_cache_misses = 0;
+	_sprite_cache_lru_evictions = 0;
+	_sprite_cache_rate_evictions = 0;
+	_sprite_cache_eviction_rate = 0;
+	_sprite_cache_rate_tick = _realtime_tick;
+}
+
+/**
+ * Write the statistics of the sprite cache to a buffer.
+ * The sprites are counted at the most detailed zoom level they were read with,
+ * as a cached sprite holds all zoom levels in a single block.
+ * @param buffer The buffer to write to.
+ * @param last The last byte of the buffer.
+ * @return The end of the written text.
+ */
+char *DumpSpriteCacheStats(char *buffer, const char *last)
+{
+	if (_spritecache_ptr == NULL) return buffer + seprintf(buffer, last, "Sprite cache: not allocated\n");
+
+	size_t zoom_bytes[ZOOM_LVL_COUNT] = {};
+	uint zoom_sprites[ZOOM_LVL_COUNT] = {};
+	size_t recolour_bytes = 0;
+	uint recolour_sprites = 0;
+	size_t largest_free = 0;
+	for (MemBlock *s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
+		if (s->size & S_FREE_MASK) {
+			largest_free = max(largest_free, s->size & ~S_FREE_MASK);
+		} else if (GetSpriteCache(s->sprite)->type == ST_RECOLOUR) {
+			recolour_bytes += s->size;
+			recolour_sprites++;
+		} else {
+			ZoomLevel zoom = GetSpriteCache(s->sprite)->zoom;
+			zoom_bytes[zoom] += s->size;
+			zoom_sprites[zoom]++;
+		}
+	}
+
+	const uint64 requests = _sprite_cache_hits + _sprite_cache_misses;
+	const uint hit_rate = requests == 0 ? 0 : (uint)(_sprite_cache_hits * 1000 / requests);
+
+	buffer += seprintf(buffer, last, "Sprite cache: " PRINTF_SIZE " of %u KiB in use, %u free blocks, largest free block " PRINTF_SIZE " KiB\n",
+			GetSpriteCacheUsage() / 1024, _allocated_sprite_cache_size / 1024, _free_block_count, largest_free / 1024);
+	buffer += seprintf(buffer, last, "Hit rate: %u.%u%% of " OTTD_PRINTF64 " requests\n", hit_rate / 10, hit_rate % 10, (int64)requests);
+	buffer += seprintf(buffer, last, "Evictions: " OTTD_PRINTF64 ", %u per second\n", (int64)_sprite_cache_lru_evictions, _sprite_cache_eviction_rate);
+	for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) {
+		if (zoom_sprites[zoom] == 0) continue;
+		buffer += seprintf(buffer, last, "  Zoom level %d: %u sprites, " PRINTF_SIZE " KiB\n", (int)zoom, zoom_sprites[zoom], zoom_bytes[zoom] / 1024);
+	}
+	buffer += seprintf(buffer, last, "  Recolour: %u sprites, " PRINTF_SIZE " KiB\n", recolour_sprites, recolour_bytes / 1024);
+	return buffer;
+}
+
 /**
  * Reads a sprite and finds its most representative colour.
  * @param sprite Sprite to read.
@@ -1021,10 +1284,19 @@ static void GfxInitSpriteCache()
 		}
 	}
 
+	MemSetT(_free_blocks, 0, lengthof(_free_blocks));
+	_free_block_classes = 0;
+	_free_block_count = 0;
+	_free_block_bytes = 0;
+	_sprite_cache_fragmented = false;
+
 	/* A big free block */
 	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
+	_spritecache_ptr->prev_size = 0;
 	/* Sentinel block (identified by size == 0) */
 	NextBlock(_spritecache_ptr)->size = 0;
+	NextBlock(_spritecache_ptr)->prev_size = (uint32)(_allocated_sprite_cache_size - sizeof(MemBlock));
+	LinkFreeBlock(_spritecache_ptr);
 }
 
 void GfxInitSpriteMem()
@@ -1036,7 +1308,8 @@ void GfxInitSpriteMem()
 	_spritecache_items = 0;
 	_spritecache = NULL;
 
-	_compact_cache_counter = 0;
+	_sprite_lru_head = LRU_NONE;
+	_sprite_lru_tail = LRU_NONE;
 }
 
 /**
@@ -1045,11 +1318,8 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
-	/* Clear sprite ptr for all cached items */
-	for (uint i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL) DeleteEntryFromSpriteCache(i);
-	}
+	/* Clear sprite ptr for all cached non-recolour items; recolour sprites stay cached and are not in the LRU list */
+	while (_sprite_lru_tail != LRU_NONE) DeleteEntryFromSpriteCache(_sprite_lru_tail);
 }
 
 /* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
@@ -50,7 +50,11 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+void MaintainSpriteCache();
+uint GetSpriteCacheEvictions();
+void SetSpriteCacheReadOnly(bool read_only);
+void ResetSpriteCacheStats();
+char *DumpSpriteCacheStats(char *buffer, const char *last);
 
 void ReadGRFSpriteOffsets(byte container_version);
 size_t GetGRFSpriteOffset(uint32 id);
@@ -19,7 +19,7 @@
 #include "industry_type.h"
 #include "linkgraph/linkgraph_type.h"
 #include "newgrf_storage.h"
-#include "3rdparty/cpp-btree/btree_map.h"
+#include "core/flatmap_type.hpp"
 #include <map>
 #include <vector>
 
@@ -30,21 +30,22 @@ static const byte INITIAL_STATION_RATING = 175;
 
 /**
  * Flow statistics telling how much flow should be sent along a link. This is
- * done by creating "flow shares" and using std::map's upper_bound() method to
- * look them up with a random number. A flow share is the difference between a
- * key in a map and the previous key. So one key in the map doesn't actually
- * mean anything by itself.
+ * done by creating "flow shares" and using upper_bound() to look them up with
+ * a random number. A flow share is the difference between a key in a map and
+ * the previous key. So one key in the map doesn't actually mean anything by
+ * itself. The keys are the cumulative shares, stored contiguously in a
+ * FlatMap so that the lookup is a binary search over a single array.
  */
 class FlowStat {
 public:
-	typedef btree::btree_map<uint32, StationID> SharesMap;
+	typedef FlatMap<uint32, StationID> SharesMap;
 
 	static const SharesMap empty_sharesmap;
 
 	/**
 	 * Invalid constructor. This can't be called as a FlowStat must not be
 	 * empty. However, the constructor must be defined and reachable for
-	 * FlwoStat to be used in a std::map.
+	 * FlowStat to be used in a map.
 	 */
 	inline FlowStat() {NOT_REACHED();}
 
@@ -150,8 +151,11 @@ private:
 	uint unrestricted; ///< Limit for unrestricted shares.
 };
 
-/** Flow descriptions by origin stations. */
-class FlowStatMap : public std::map<StationID, FlowStat> {
+/**
+ * Flow descriptions by origin stations. This is a FlatMap, so unlike with a
+ * std::map any insertion or erasure invalidates iterators into it.
+ */
+class FlowStatMap : public FlatMap<StationID, FlowStat> {
 public:
 	uint GetFlow() const;
 	uint GetFlowVia(StationID via) const;
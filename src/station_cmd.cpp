@@ -26,6 +26,7 @@
 #include "newgrf_station.h"
 #include "newgrf_canal.h" /* For the buoy */
 #include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/water_regions.h"
 #include "road_internal.h" /* For drawing catenary/checking road removal */
 #include "autoslope.h"
 #include "water.h"
@@ -55,6 +56,7 @@
 #include "linkgraph/refresh.h"
 #include "widgets/station_widget.h"
 #include "zoning.h"
+#include "network/network_sync_hash.h"
 
 #include "table/strings.h"
 
@@ -1915,6 +1917,7 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			DirtyCompanyInfrastructureWindows(st->owner);
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
 		ZoningMarkDirtyStationCoverageArea(st);
 	}
@@ -2020,6 +2023,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 		} else {
 			DoClearSquare(tile);
 		}
+		YapfNotifyRoadLayoutChange(tile);
 
 		SetWindowWidgetDirty(WC_STATION_VIEW, st->index, WID_SV_ROADVEHS);
 		delete cur_stop;
@@ -2673,6 +2677,8 @@ CommandCost CmdBuildDock(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		DirtyCompanyInfrastructureWindows(st->owner);
 
 		MakeDock(slope_tile, st->owner, st->index, direction, wc);
+		InvalidateWaterRegion(slope_tile);
+		InvalidateWaterRegion(flat_tile);
 
 		st->UpdateVirtCoord();
 		UpdateStationAcceptance(st, false);
@@ -3620,12 +3626,22 @@ void DeleteStaleLinks(Station *from)
 		GoodsEntry &ge = from->goods[c];
 		LinkGraph *lg = LinkGraph::GetIfValid(ge.link_graph);
 		if (lg == NULL) continue;
-		Node node = (*lg)[ge.node];
-		for (EdgeIterator it(node.Begin()); it != node.End();) {
-			Edge edge = it->second;
-			Station *to = Station::Get((*lg)[it->first].Station());
-			assert(to->goods[c].node == it->first);
-			++it; // Do that before removing the edge. Anything else may crash.
+		/* Refreshing links below may add edges to the node, which invalidates
+		 * edge iterators and references. So collect the destinations first and
+		 * look up the edges again whenever they may have moved. */
+		SmallVector<NodeID, 16> dest_nodes;
+		{
+			Node node = (*lg)[ge.node];
+			for (EdgeIterator it(node.Begin()); it != node.End(); ++it) {
+				*(dest_nodes.Append()) = it->first;
+			}
+		}
+		for (const NodeID *dest = dest_nodes.Begin(); dest != dest_nodes.End(); ++dest) {
+			Node node = (*lg)[ge.node];
+			if (!node.HasEdgeTo(*dest)) continue;
+			Edge edge = node[*dest];
+			Station *to = Station::Get((*lg)[*dest].Station());
+			assert(to->goods[c].node == *dest);
 			assert(_date >= edge.LastUpdate());
 			uint timeout = max<uint>((LinkGraph::MIN_TIMEOUT_DISTANCE + (DistanceManhattan(from->xy, to->xy) >> 3)) / _settings_game.economy.day_length_factor, 1);
 			if ((uint)(_date - edge.LastUpdate()) > timeout) {
@@ -3658,7 +3674,8 @@ void DeleteStaleLinks(Station *from)
 						Vehicle *v = *iter;
 
 						LinkRefresher::Run(v, false); // Don't allow merging. Otherwise lg might get deleted.
-						if (edge.LastUpdate() == _date) {
+						const LinkGraph *clg = lg; // The refresh may have changed the edges; look up through the const node.
+						if ((*clg)[ge.node][*dest].LastUpdate() == _date) {
 							updated = true;
 							break;
 						}
@@ -3677,7 +3694,7 @@ void DeleteStaleLinks(Station *from)
 
 				if (!updated) {
 					/* If it's still considered dead remove it. */
-					node.RemoveEdge(to->goods[c].node);
+					(*lg)[ge.node].RemoveEdge(to->goods[c].node);
 					ge.flows.DeleteFlows(to->index);
 					RerouteCargo(from, c, to->index, from->index);
 				}
@@ -3760,7 +3777,10 @@ static void StationHandleSmallTick(BaseStation *st)
 	if (b >= STATION_RATING_TICKS) b = 0;
 	st->delete_ctr = b;
 
-	if (b == 0) UpdateStationRating(Station::From(st));
+	if (b == 0) {
+		UpdateStationRating(Station::From(st));
+		if (_sync_hash_active) SyncHashStation(Station::From(st));
+	}
 }
 
 void OnTick_Station()
@@ -4057,6 +4077,7 @@ void BuildOilRig(TileIndex tile)
 	assert(IsTileType(tile, MP_INDUSTRY));
 	DeleteAnimatedTile(tile);
 	MakeOilrig(tile, st->index, GetWaterClass(tile));
+	InvalidateWaterRegion(tile);
 
 	st->owner = OWNER_NONE;
 	st->airport.type = AT_OILRIG;
@@ -4377,6 +4398,7 @@ void FlowStat::Invalidate()
 {
 	assert(!this->shares.empty());
 	SharesMap new_shares;
+	new_shares.reserve(this->shares.size());
 	uint i = 0;
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		new_shares[++i] = it->second;
@@ -4402,6 +4424,7 @@ void FlowStat::ChangeShare(StationID st, int flow)
 	uint added_shares = 0;
 	uint last_share = 0;
 	SharesMap new_shares;
+	new_shares.reserve(this->shares.size() + 1);
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		if (it->second == st) {
 			if (flow < 0) {
@@ -4448,6 +4471,7 @@ void FlowStat::RestrictShare(StationID st)
 	uint flow = 0;
 	uint last_share = 0;
 	SharesMap new_shares;
+	new_shares.reserve(this->shares.size());
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		if (flow == 0) {
 			if (it->first > this->unrestricted) return; // Not present or already restricted.
@@ -4493,6 +4517,7 @@ void FlowStat::ReleaseShare(StationID st)
 	}
 	if (flow == 0) return;
 	SharesMap new_shares;
+	new_shares.reserve(this->shares.size());
 	new_shares[flow] = st;
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		if (it->second != st) {
@@ -4514,6 +4539,7 @@ void FlowStat::ScaleToMonthly(uint runtime)
 {
 	assert(runtime > 0);
 	SharesMap new_shares;
+	new_shares.reserve(this->shares.size());
 	uint share = 0;
 	for (SharesMap::iterator i = this->shares.begin(); i != this->shares.end(); ++i) {
 		share = max(share + 1, i->first * 30 / runtime);
@@ -4599,7 +4625,7 @@ StationIDStack FlowStatMap::DeleteFlows(StationID via)
 		s_flows.ChangeShare(via, INT_MIN);
 		if (s_flows.GetShares()->empty()) {
 			ret.Push(f_it->first);
-			this->erase(f_it++);
+			f_it = this->erase(f_it);
 		} else {
 			++f_it;
 		}
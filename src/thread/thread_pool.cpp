@@ -0,0 +1,244 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file thread_pool.cpp Pool of persistent worker threads running queued tasks. */
+
+#include "../stdafx.h"
+#include "thread_pool.h"
+#include "../debug.h"
+
+#include "../safeguards.h"
+
+WorkerTaskGroup::WorkerTaskGroup() : mutex(ThreadMutex::New()), pending(0) {}
+
+WorkerTaskGroup::~WorkerTaskGroup()
+{
+	assert(this->pending == 0);
+	delete this->mutex;
+}
+
+/**
+ * Create a worker thread pool. No threads are started until Start is called.
+ * @param name Name given to the worker threads.
+ */
+WorkerThreadPool::WorkerThreadPool(const char *name) : name(name), mutex(ThreadMutex::New()), exit(false) {}
+
+WorkerThreadPool::~WorkerThreadPool()
+{
+	this->Stop();
+	delete this->mutex;
+}
+
+/**
+ * Start worker threads until the pool has the given number of workers.
+ * If a thread can't be started the pool keeps the workers it has.
+ * @param num_workers Requested number of worker threads.
+ */
+void WorkerThreadPool::Start(uint num_workers)
+{
+	while (this->workers.size() < num_workers) {
+		ThreadObject *t = NULL;
+		if (!ThreadObject::New(&WorkerThreadPool::WorkerThreadProc, this, &t, this->name)) break;
+		this->workers.push_back(t);
+	}
+}
+
+/**
+ * Stop and join all worker threads. Tasks still in the queue are left there
+ * and will run once the pool is started again or their group is waited for.
+ */
+void WorkerThreadPool::Stop()
+{
+	if (this->workers.empty()) return;
+
+	this->mutex->BeginCritical();
+	this->exit = true;
+	this->mutex->SendSignal();
+	this->mutex->EndCritical();
+
+	for (ThreadObject *t : this->workers) {
+		t->Join();
+		delete t;
+	}
+	this->workers.clear();
+	this->exit = false;
+}
+
+/**
+ * Queue a task. If there are no workers it is run immediately.
+ * @param proc Function to run.
+ * @param param Parameter for proc.
+ * @param group Group the task belongs to.
+ * @param urgent Queue the task in front of all others, e.g. for subtasks of a running task.
+ */
+void WorkerThreadPool::Submit(OTTDThreadFunc proc, void *param, WorkerTaskGroup *group, bool urgent)
+{
+	Task task = { proc, param, group };
+
+	group->mutex->BeginCritical();
+	group->pending++;
+	group->mutex->EndCritical();
+
+	if (this->workers.empty()) {
+		RunTask(task);
+		return;
+	}
+
+	this->mutex->BeginCritical();
+	if (urgent) {
+		this->queue.push_front(task);
+	} else {
+		this->queue.push_back(task);
+	}
+	this->mutex->SendSignal();
+	this->mutex->EndCritical();
+}
+
+/**
+ * Wait until all tasks of a group have finished. Queued tasks of the group
+ * are run by the calling thread in the meantime.
+ * @param group Group to wait for.
+ */
+void WorkerThreadPool::Wait(WorkerTaskGroup *group)
+{
+	group->mutex->BeginCritical();
+	while (group->pending > 0) {
+		Task task;
+		this->mutex->BeginCritical();
+		bool found = this->PopTask(task, group);
+		this->mutex->EndCritical();
+
+		if (found) {
+			group->mutex->EndCritical();
+			RunTask(task);
+			group->mutex->BeginCritical();
+		} else {
+			group->mutex->WaitForSignal();
+		}
+	}
+	group->mutex->EndCritical();
+}
+
+/**
+ * Remove all tasks of a group which haven't been picked up yet from the queue.
+ * Tasks already running are not affected and still need to be waited for.
+ * @param group Group to cancel.
+ * @return Number of tasks removed.
+ */
+uint WorkerThreadPool::Cancel(WorkerTaskGroup *group)
+{
+	uint removed = 0;
+	this->mutex->BeginCritical();
+	for (auto it = this->queue.begin(); it != this->queue.end();) {
+		if (it->group == group) {
+			it = this->queue.erase(it);
+			removed++;
+		} else {
+			++it;
+		}
+	}
+	this->mutex->EndCritical();
+
+	if (removed > 0) {
+		group->mutex->BeginCritical();
+		group->pending -= removed;
+		if (group->pending == 0) group->mutex->SendSignal();
+		group->mutex->EndCritical();
+	}
+	return removed;
+}
+
+/**
+ * Get the number of tasks waiting for a free worker.
+ * @return Queue length.
+ */
+uint WorkerThreadPool::QueueDepth()
+{
+	ThreadMutexLocker lock(this->mutex);
+	return (uint)this->queue.size();
+}
+
+/**
+ * Take the first queued task, optionally only of the given group.
+ * @pre The pool mutex is held.
+ * @param[out] task The removed task.
+ * @param group Group the task has to belong to, or NULL for any task.
+ * @return True if a task was removed from the queue.
+ */
+bool WorkerThreadPool::PopTask(Task &task, const WorkerTaskGroup *group)
+{
+	for (auto it = this->queue.begin(); it != this->queue.end(); ++it) {
+		if (group != NULL && it->group != group) continue;
+		task = *it;
+		this->queue.erase(it);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Run a task and mark it as finished in its group.
+ * @param task Task to run.
+ */
+/* static */ void WorkerThreadPool::RunTask(const Task &task)
+{
+	task.proc(task.param);
+
+	WorkerTaskGroup *group = task.group;
+	group->mutex->BeginCritical();
+	if (--group->pending == 0) group->mutex->SendSignal();
+	group->mutex->EndCritical();
+}
+
+/**
+ * Main loop of a worker thread. This method is tailored to ThreadObject::New.
+ * @param pool The WorkerThreadPool the worker belongs to.
+ */
+/* static */ void WorkerThreadPool::WorkerThreadProc(void *pool)
+{
+	WorkerThreadPool *self = (WorkerThreadPool *)pool;
+	for (;;) {
+		Task task;
+		self->mutex->BeginCritical();
+		while (!self->exit && !self->PopTask(task, NULL)) self->mutex->WaitForSignal();
+		/* Each signal wakes a single worker; pass it on if there is more to do. */
+		if (self->exit || !self->queue.empty()) self->mutex->SendSignal();
+		bool exit = self->exit;
+		self->mutex->EndCritical();
+
+		if (exit) return;
+		RunTask(task);
+	}
+}
+
+/**
+ * Create the shared worker thread pool, leaving one core for the game loop.
+ * @return The new pool.
+ */
+static WorkerThreadPool *CreateWorkerThreadPool()
+{
+	WorkerThreadPool *pool = new WorkerThreadPool("ottd:worker");
+	uint cores = GetCPUCoreCount();
+	pool->Start(cores > 1 ? cores - 1 : 1);
+	DEBUG(misc, 1, "Started %u worker threads", pool->NumWorkers());
+	return pool;
+}
+
+/**
+ * Get the worker thread pool shared by everything that runs work in the
+ * background, so the number of worker threads doesn't grow with the number of
+ * users. The workers are started on first use. The pool is never destroyed,
+ * so tasks can still be waited for while static objects are destroyed.
+ * @return The shared pool.
+ */
+WorkerThreadPool &GetWorkerThreadPool()
+{
+	static WorkerThreadPool *pool = CreateWorkerThreadPool();
+	return *pool;
+}
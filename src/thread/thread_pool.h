@@ -0,0 +1,82 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file thread_pool.h Pool of persistent worker threads running queued tasks. */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "thread.h"
+#include <deque>
+#include <vector>
+
+/**
+ * A set of tasks submitted to a WorkerThreadPool which are waited for together.
+ * The group must outlive all of its tasks, i.e. it must be waited for before it
+ * is destroyed.
+ */
+class WorkerTaskGroup {
+	friend class WorkerThreadPool;
+
+	ThreadMutex *mutex; ///< Protects #pending. Signalled when the last task of the group has finished.
+	uint pending;       ///< Number of submitted tasks which haven't finished yet.
+
+public:
+	WorkerTaskGroup();
+	~WorkerTaskGroup();
+};
+
+/**
+ * Pool of persistent worker threads. Tasks are run in the order they were
+ * submitted by whichever worker becomes free first. A thread waiting for a
+ * task group runs the still queued tasks of that group itself instead of
+ * sleeping, so that tasks may submit and wait for subtasks without tying up
+ * the pool. If no worker threads can be started, tasks are run right away in
+ * the submitting thread.
+ */
+class WorkerThreadPool {
+	/** A queued task. */
+	struct Task {
+		OTTDThreadFunc proc;    ///< Function to run.
+		void *param;            ///< Parameter for #proc.
+		WorkerTaskGroup *group; ///< Group the task belongs to.
+	};
+
+	const char *name;                    ///< Name given to the worker threads.
+	ThreadMutex *mutex;                  ///< Protects #queue and #exit. Signalled when tasks are queued.
+	std::deque<Task> queue;              ///< Tasks not picked up yet.
+	std::vector<ThreadObject *> workers; ///< The worker threads.
+	bool exit;                           ///< Whether the workers should exit.
+
+	static void WorkerThreadProc(void *pool);
+	bool PopTask(Task &task, const WorkerTaskGroup *group);
+	static void RunTask(const Task &task);
+
+public:
+	WorkerThreadPool(const char *name);
+	~WorkerThreadPool();
+
+	void Start(uint num_workers);
+	void Stop();
+
+	void Submit(OTTDThreadFunc proc, void *param, WorkerTaskGroup *group, bool urgent = false);
+	void Wait(WorkerTaskGroup *group);
+	uint Cancel(WorkerTaskGroup *group);
+	uint QueueDepth();
+
+	/**
+	 * Get the number of running worker threads.
+	 * @return Number of workers, 0 if tasks are run synchronously.
+	 */
+	uint NumWorkers() const { return (uint)this->workers.size(); }
+};
+
+WorkerThreadPool &GetWorkerThreadPool();
+
+#endif /* THREAD_POOL_H */
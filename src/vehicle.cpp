@@ -58,6 +58,7 @@
 #include "tbtr_template_vehicle_func.h"
 #include "string_func.h"
 #include "scope_info.h"
+#include "network/network_sync_hash.h"
 #include "3rdparty/cpp-btree/btree_set.h"
 
 #include "table/strings.h"
@@ -1079,6 +1080,8 @@ void CallVehicleTicks()
 
 		assert(Vehicle::Get(vehicle_index) == v);
 
+		if (_sync_hash_active) SyncHashVehicle(v);
+
 		switch (v->type) {
 			default: break;
 
@@ -1149,6 +1152,9 @@ void CallVehicleTicks()
 	}
 	v = NULL;
 
+	/* extend the path caches of road vehicles which are running out of cached choices */
+	RunRoadVehPathLookahead();
+
 	/* do Auto Replacement */
 	Backup<CompanyByte> cur_company(_current_company, FILE_LINE);
 	for (AutoreplaceMap::iterator it = _vehicles_to_autoreplace.Begin(); it != _vehicles_to_autoreplace.End(); it++) {
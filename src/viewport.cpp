@@ -101,7 +101,12 @@
 #include "tunnelbridge_map.h"
 #include "gui.h"
 #include "core/container_func.hpp"
+#include "newgrf_debug.h"
+#include "spritecache.h"
+#include "thread/thread.h"
+#include "thread/thread_pool.h"
 
+#include <array>
 #include <map>
 #include <vector>
 #include <math.h>
@@ -214,6 +219,7 @@ struct ViewportDrawer {
 	TunnelBridgeToMapVector bridge_to_map;
 
 	int *last_child;
+	int last_parent;                                 ///< ParentSprite the active ChildSprite list belongs to (index into parent_sprites_to_draw).
 
 	SpriteCombineMode combine_sprites;               ///< Current mode of "sprite combining". @see StartSpriteCombine
 
@@ -661,12 +667,15 @@ static void AddChildSpriteToFoundation(SpriteID image, PaletteID pal, const SubS
 
 	/* Change the active ChildSprite list to the one of the foundation */
 	int *old_child = _vd.last_child;
+	int old_parent = _vd.last_parent;
 	_vd.last_child = _vd.last_foundation_child[foundation_part];
+	_vd.last_parent = _vd.foundation[foundation_part];
 
 	AddChildSpriteScreen(image, pal, offs.x + extra_offs_x, offs.y + extra_offs_y, false, sub, false);
 
 	/* Switch back to last ChildSprite list */
 	_vd.last_child = old_child;
+	_vd.last_parent = old_parent;
 }
 
 /**
@@ -848,6 +857,11 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 	ps->left = tmp_left;
 	ps->top  = tmp_top;
 
+	ps->bounds_left   = left;
+	ps->bounds_top    = top;
+	ps->bounds_right  = right;
+	ps->bounds_bottom = bottom;
+
 	ps->image = image;
 	ps->pal = pal;
 	ps->sub = sub;
@@ -864,6 +878,7 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 	ps->first_child = -1;
 
 	_vd.last_child = &ps->first_child;
+	_vd.last_parent = _vd.parent_sprites_to_draw.Length() - 1;
 
 	if (_vd.combine_sprites == SPRITE_COMBINE_PENDING) _vd.combine_sprites = SPRITE_COMBINE_ACTIVE;
 }
@@ -971,6 +986,16 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 	cs->y = scale ? y * ZOOM_LVL_BASE : y;
 	cs->next = -1;
 
+	/* Grow the screen extents of the ParentSprite, which the sprite sorter uses to find out which sprites overlap. */
+	ParentSpriteToDraw *ps = _vd.parent_sprites_to_draw.Get(_vd.last_parent);
+	const Sprite *spr = GetSprite(image & SPRITE_MASK, ST_NORMAL);
+	int child_left = ps->left + cs->x + spr->x_offs;
+	int child_top  = ps->top  + cs->y + spr->y_offs;
+	ps->bounds_left   = min(ps->bounds_left,   child_left);
+	ps->bounds_top    = min(ps->bounds_top,    child_top);
+	ps->bounds_right  = max(ps->bounds_right,  child_left + spr->width);
+	ps->bounds_bottom = max(ps->bounds_bottom, child_top  + spr->height);
+
 	/* Append the sprite to the active ChildSprite list.
 	 * If the active ParentSprite is a foundation, update last_foundation_child as well.
 	 * Note: ChildSprites of foundations are NOT sequential in the vector, as selection sprites are added at last. */
@@ -2230,15 +2255,31 @@ static inline void ViewportMapStoreBridgeAboveTile(const ViewPort * const vp, co
 	ViewportMapStoreBridgeTunnel(vp, GetSouthernBridgeEnd(tile));
 }
 
-static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * const vp, const TileIndex from_tile, TileType * const tile_type)
+/**
+ * Get the size of the area of which the most significant tile is shown for a single tile in map mode.
+ * @param vp The viewport.
+ * @return Number of tiles along each axis, or 0 if every tile is shown by itself.
+ */
+static inline uint ViewportMapScanLength(const ViewPort * const vp)
+{
+	if (vp->zoom <= ZOOM_LVL_OUT_128X || !_settings_client.gui.viewport_map_scan_surroundings) return 0;
+	return (vp->zoom - ZOOM_LVL_OUT_128X) * 2;
+}
+
+static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * const vp, const TileIndex from_tile, TileType * const tile_type, bool * const bridge_or_tunnel)
 {
-	if (vp->zoom <= ZOOM_LVL_OUT_128X || !_settings_client.gui.viewport_map_scan_surroundings) {
+	const uint8 length = ViewportMapScanLength(vp);
+	if (length == 0) {
 		const TileType ttype = GetTileType(from_tile);
 		/* Store bridges and tunnels. */
 		if (ttype != MP_TUNNELBRIDGE) {
 			*tile_type = ttype;
-			if (IsBridgeAbove(from_tile)) ViewportMapStoreBridgeAboveTile(vp, from_tile);
+			if (IsBridgeAbove(from_tile)) {
+				*bridge_or_tunnel = true;
+				ViewportMapStoreBridgeAboveTile(vp, from_tile);
+			}
 		} else {
+			*bridge_or_tunnel = true;
 			ViewportMapStoreBridgeTunnel(vp, from_tile);
 			switch (GetTunnelBridgeTransportType(from_tile)) {
 				case TRANSPORT_RAIL:  *tile_type = MP_RAILWAY; break;
@@ -2250,7 +2291,6 @@ static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * c
 		return from_tile;
 	}
 
-	const uint8 length = (vp->zoom - ZOOM_LVL_OUT_128X) * 2;
 	TileArea tile_area = TileArea(from_tile, length, length);
 	tile_area.ClampToMap();
 
@@ -2265,6 +2305,7 @@ static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * c
 			result = tile;
 		}
 		if (ttype != MP_TUNNELBRIDGE && IsBridgeAbove(tile)) {
+			*bridge_or_tunnel = true;
 			ViewportMapStoreBridgeAboveTile(vp, tile);
 		}
 	}
@@ -2272,6 +2313,7 @@ static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * c
 	/* Store bridges and tunnels. */
 	*tile_type = GetTileType(result);
 	if (*tile_type == MP_TUNNELBRIDGE) {
+		*bridge_or_tunnel = true;
 		ViewportMapStoreBridgeTunnel(vp, result);
 		switch (GetTunnelBridgeTransportType(result)) {
 			case TRANSPORT_RAIL: *tile_type = MP_RAILWAY; break;
@@ -2283,19 +2325,23 @@ static inline TileIndex ViewportMapGetMostSignificantTileType(const ViewPort * c
 	return result;
 }
 
-/** Get the colour of a tile, can be 32bpp RGB or 8bpp palette index. */
-template <bool is_32bpp, bool show_slope>
-uint32 ViewportMapGetColour(const ViewPort * const vp, uint x, uint y, const uint colour_index)
+/**
+ * Get the tile shown at a point of a viewport in map mode.
+ * @param x Virtual X coordinate of the point.
+ * @param y Virtual Y coordinate of the point.
+ * @return The tile, or INVALID_TILE if nothing is shown there.
+ */
+static inline TileIndex ViewportMapGetTile(uint x, uint y)
 {
 	if (!(IsInsideMM(x, TILE_SIZE, MapMaxX() * TILE_SIZE - 1) &&
 		  IsInsideMM(y, TILE_SIZE, MapMaxY() * TILE_SIZE - 1)))
-		return 0;
+		return INVALID_TILE;
 
 	/* Very approximative but fast way to get the tile when taking Z into account. */
 	const TileIndex tile_tmp = TileVirtXY(x, y);
 	const uint z = TileHeight(tile_tmp) * 4;
 	TileIndex tile = TileVirtXY(x + z, y + z);
-	if (tile >= MapSize()) return 0;
+	if (tile >= MapSize()) return INVALID_TILE;
 	if (_settings_game.construction.freeform_edges) {
 		/* tile_tmp and tile must be from the same side,
 		 * otherwise it's an approximation erroneous case
@@ -2303,13 +2349,17 @@ uint32 ViewportMapGetColour(const ViewPort * const vp, uint x, uint y, const uin
 		 */
 		if (TileX(tile_tmp) > (MapSizeX() - (MapSizeX() / 8)))
 			if ((TileX(tile_tmp) < (MapSizeX() / 2)) != (TileX(tile) < (MapSizeX() / 2)))
-				return 0;
+				return INVALID_TILE;
 	}
-	TileType tile_type = MP_VOID;
-	tile = ViewportMapGetMostSignificantTileType(vp, tile, &tile_type);
+	return tile;
+}
+
+/** Get the colour of the most significant tile of an area, can be 32bpp RGB or 8bpp palette index. */
+template <bool is_32bpp, bool show_slope>
+static inline uint32 ViewportMapGetTileColour(const ViewPort * const vp, const TileIndex tile, const TileType tile_type, const uint colour_index)
+{
 	if (tile_type == MP_VOID) return 0;
 
-	/* Return the colours. */
 	switch (vp->map_type) {
 		default:              return ViewportMapGetColourOwner<is_32bpp, show_slope>(tile, tile_type, colour_index);
 		case VPMT_INDUSTRY:   return ViewportMapGetColourIndustries<is_32bpp, show_slope>(tile, tile_type, colour_index);
@@ -2317,6 +2367,177 @@ uint32 ViewportMapGetColour(const ViewPort * const vp, uint x, uint y, const uin
 	}
 }
 
+/**
+ * Colours of the tiles shown in map mode, so redrawing doesn't have to look
+ * at the contents of the tiles for every pixel again. Each tile refers to its
+ * colours for all colour indices; tiles with the same colours share them.
+ * The entry of a tile is dropped when the tile is marked dirty or visited by
+ * the tile loop, and all entries when anything else they depend on changes.
+ */
+struct ViewportMapColourCache {
+	typedef std::array<uint32, 4> Colours; ///< Colour of a tile for each colour index.
+
+	/** Special values of #tile_entry. */
+	enum EntryValue {
+		EMPTY = 0,         ///< The colours of the tile aren't known.
+		UNCACHED = 0xFFFF, ///< The tile is (near) a bridge or tunnel, which are collected while looking up its colours.
+	};
+
+	std::vector<uint16> tile_entry;        ///< For each tile #EMPTY, #UNCACHED or the index in #colours plus one.
+	std::vector<Colours> colours;          ///< The distinct colours of the tiles.
+	std::map<Colours, uint16> lookup;      ///< Entry of the colours in #colours.
+	uint32 key;                            ///< Hash of all other state the colours depend on.
+	uint scan_length;                      ///< Size of the areas of which the most significant tile is shown, see #ViewportMapScanLength.
+	uint32 last_used;                      ///< When the cache was used last, for replacing it.
+
+	/** Forget all colours. */
+	void Clear()
+	{
+		std::fill(this->tile_entry.begin(), this->tile_entry.end(), EMPTY);
+		this->colours.clear();
+		this->lookup.clear();
+	}
+
+	/**
+	 * Get the entry for some colours.
+	 * @param c The colours of a tile.
+	 * @return The entry.
+	 */
+	uint16 GetEntry(const Colours &c)
+	{
+		auto it = this->lookup.find(c);
+		if (it != this->lookup.end()) return it->second;
+
+		if (this->colours.size() == UNCACHED - 1) this->Clear();
+		this->colours.push_back(c);
+		uint16 entry = (uint16)this->colours.size();
+		this->lookup[c] = entry;
+		return entry;
+	}
+
+	/**
+	 * Forget the colours of the tiles whose colour may depend on a tile.
+	 * @param tile The tile.
+	 */
+	void Invalidate(TileIndex tile)
+	{
+		if (this->tile_entry.empty()) return;
+
+		/* An area is shown by its north most tile. */
+		uint length = max(this->scan_length, 1U);
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		for (uint dy = 0; dy < length && dy <= y; dy++) {
+			for (uint dx = 0; dx < length && dx <= x; dx++) {
+				this->tile_entry[TileXY(x - dx, y - dy)] = EMPTY;
+			}
+		}
+	}
+};
+
+/** Colour caches of viewports in map mode; there are two, in case viewports show different kinds of maps. */
+static ViewportMapColourCache _vp_map_colour_caches[2];
+static ViewportMapColourCache *_vp_map_colour_cache = NULL; ///< Colour cache of the viewport being drawn.
+static uint32 _vp_map_colour_cache_counter = 0;             ///< Counter for ViewportMapColourCache::last_used.
+
+/**
+ * Hash everything other than the tiles that the colours of a viewport in map mode depend on.
+ * @param vp The viewport.
+ * @return The hash.
+ */
+template <bool is_32bpp, bool show_slope>
+static uint32 ViewportMapColourCacheKey(const ViewPort * const vp)
+{
+	extern LegendAndColour _legend_land_owners[NUM_NO_COMPANY_ENTRIES + MAX_COMPANIES + 1];
+	extern LegendAndColour _legend_from_industries[NUM_INDUSTRYTYPES + 1];
+	extern bool _smallmap_show_heightmap;
+
+	uint32 key = 0x811C9DC5;
+	auto fold = [&key](uint32 value) { key = (key ^ value) * 0x01000193; };
+	fold(vp->map_type | is_32bpp << 8 | show_slope << 9 | _smallmap_show_heightmap << 10 | _settings_client.gui.smallmap_land_colour << 16);
+	fold(ViewportMapScanLength(vp));
+	fold(_transparency_opt);
+	fold(_invisibility_opt);
+	fold(_settings_game.game_creation.landscape | _settings_game.construction.max_heightlevel << 8);
+	for (const LegendAndColour &l : _legend_land_owners) fold(l.colour | l.show_on_map << 8 | l.company << 16);
+	for (const LegendAndColour &l : _legend_from_industries) fold(l.show_on_map | l.type << 8);
+	return key;
+}
+
+/**
+ * Select the colour cache for drawing a viewport in map mode.
+ * @param vp The viewport.
+ */
+template <bool is_32bpp, bool show_slope>
+static void ViewportMapSelectColourCache(const ViewPort * const vp)
+{
+	const uint32 key = ViewportMapColourCacheKey<is_32bpp, show_slope>(vp);
+
+	ViewportMapColourCache *cache = NULL;
+	for (ViewportMapColourCache &c : _vp_map_colour_caches) {
+		if (c.key == key && c.tile_entry.size() == MapSize()) {
+			cache = &c;
+			break;
+		}
+		if (cache == NULL || c.last_used < cache->last_used) cache = &c;
+	}
+
+	if (cache->key != key || cache->tile_entry.size() != MapSize()) {
+		cache->tile_entry.assign(MapSize(), ViewportMapColourCache::EMPTY);
+		cache->Clear();
+		cache->key = key;
+		cache->scan_length = ViewportMapScanLength(vp);
+	}
+	cache->last_used = ++_vp_map_colour_cache_counter;
+	_vp_map_colour_cache = cache;
+}
+
+/** Get the colour of a point, can be 32bpp RGB or 8bpp palette index. */
+template <bool is_32bpp, bool show_slope>
+uint32 ViewportMapGetColour(const ViewPort * const vp, uint x, uint y, const uint colour_index)
+{
+	const TileIndex from_tile = ViewportMapGetTile(x, y);
+	if (from_tile == INVALID_TILE) return 0;
+
+	uint16 &entry = _vp_map_colour_cache->tile_entry[from_tile];
+	if (entry != ViewportMapColourCache::EMPTY && entry != ViewportMapColourCache::UNCACHED) {
+		return _vp_map_colour_cache->colours[entry - 1][colour_index];
+	}
+
+	TileType tile_type = MP_VOID;
+	bool bridge_or_tunnel = false;
+	const TileIndex tile = ViewportMapGetMostSignificantTileType(vp, from_tile, &tile_type, &bridge_or_tunnel);
+	if (bridge_or_tunnel) {
+		/* Bridges and tunnels have to be collected on every redraw. */
+		entry = ViewportMapColourCache::UNCACHED;
+		return ViewportMapGetTileColour<is_32bpp, show_slope>(vp, tile, tile_type, colour_index);
+	}
+
+	ViewportMapColourCache::Colours colours;
+	for (uint i = 0; i < colours.size(); i++) colours[i] = ViewportMapGetTileColour<is_32bpp, show_slope>(vp, tile, tile_type, i);
+	entry = _vp_map_colour_cache->GetEntry(colours);
+	return colours[colour_index];
+}
+
+/** Forget the colours of all tiles, e.g. because another map is loaded. */
+void ViewportMapClearColourCache()
+{
+	for (ViewportMapColourCache &c : _vp_map_colour_caches) {
+		c.tile_entry.clear();
+		c.tile_entry.shrink_to_fit();
+		c.Clear();
+	}
+}
+
+/**
+ * Forget the colours shown in map mode for a tile that has changed.
+ * @param tile The tile.
+ */
+void ViewportMapInvalidateColourCacheByTile(const TileIndex tile)
+{
+	for (ViewportMapColourCache &c : _vp_map_colour_caches) c.Invalidate(tile);
+}
+
 /* Taken from http://stereopsis.com/doubleblend.html, PixelBlend() is faster than ComposeColourRGBANoCheck() */
 static inline void PixelBlend(uint32 * const d, const uint32 s)
 {
@@ -2427,6 +2648,7 @@ void ViewportMapDraw(const ViewPort * const vp)
 	Blitter * const blitter = BlitterFactory::GetCurrentBlitter();
 
 	SmallMapWindow::RebuildColourIndexIfNecessary();
+	ViewportMapSelectColourCache<is_32bpp, show_slope>(vp);
 
 	/* Index of colour: _green_map_heights[] contains blocks of 4 colours, say ABCD
 	 * For a XXXY colour block to render nicely, follow the model:
@@ -2506,7 +2728,66 @@ void ViewportMapDraw(const ViewPort * const vp)
 	}
 }
 
-void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Sprites of a part of a viewport. They are collected and sorted on the main
+ * thread, but may be blitted by a worker thread, as the parts don't overlap.
+ */
+struct ViewportDrawPiece {
+	const ViewPort *vp;                                         ///< Viewport the part belongs to.
+	DrawPixelInfo dpi;                                          ///< Area of the part, see ViewportDrawer::dpi.
+	int x;                                                      ///< Left edge of the part in screen coordinates.
+	int y;                                                      ///< Top edge of the part in screen coordinates.
+	StringSpriteToDrawVector string_sprites_to_draw;
+	TileSpriteToDrawVector tile_sprites_to_draw;
+	ParentSpriteToDrawVector parent_sprites_to_draw;
+	ParentSpriteToSortVector parent_sprites_to_sort;
+	ChildScreenSpriteToDrawVector child_screen_sprites_to_draw;
+
+	/**
+	 * Blit the tile and parent sprites of the part.
+	 * This method is tailored to WorkerThreadPool::Submit.
+	 * @param data The piece.
+	 */
+	static void Blit(void *data)
+	{
+		ViewportDrawPiece *piece = (ViewportDrawPiece *)data;
+		DrawPixelInfo *old_dpi = _cur_dpi;
+		_cur_dpi = &piece->dpi;
+
+		if (piece->tile_sprites_to_draw.Length() != 0) ViewportDrawTileSprites(&piece->tile_sprites_to_draw);
+		ViewportDrawParentSprites(&piece->parent_sprites_to_sort, &piece->child_screen_sprites_to_draw);
+
+		_cur_dpi = old_dpi;
+	}
+};
+
+static std::vector<ViewportDrawPiece> _vd_pieces; ///< Parts of viewports collected, but not drawn yet.
+static uint _vd_piece_count = 0;                  ///< Number of used entries of #_vd_pieces.
+
+/**
+ * Whether parts of viewports are blitted on the worker threads. With a single
+ * core the workers would only compete with the game loop.
+ * @return True if the viewports are blitted concurrently.
+ */
+static bool IsViewportDrawConcurrent()
+{
+	static const bool concurrent = GetCPUCoreCount() > 1;
+	return concurrent;
+}
+
+/** Minimum number of pixels of a part of a viewport that is blitted by its own thread. */
+static const int VIEWPORT_DRAW_MIN_PIECE_PIXELS = 128 * 128;
+
+/**
+ * Collect and sort the sprites of a part of a viewport, to be drawn by #ViewportDrawPieces.
+ * The viewport map doesn't use sprites, so it is drawn right away.
+ * @param vp The viewport.
+ * @param left Left edge of the part in virtual coordinates.
+ * @param top Top edge of the part in virtual coordinates.
+ * @param right Right edge of the part in virtual coordinates.
+ * @param bottom Bottom edge of the part in virtual coordinates.
+ */
+static void ViewportCollectPiece(const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	DrawPixelInfo *old_dpi = _cur_dpi;
 	_cur_dpi = &_vd.dpi;
@@ -2528,13 +2809,6 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	_vd.dpi.dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(old_dpi->dst_ptr, x - old_dpi->left, y - old_dpi->top);
 
-	_dpi_for_text        = _vd.dpi;
-	_dpi_for_text.left   = UnScaleByZoom(_dpi_for_text.left,   _dpi_for_text.zoom);
-	_dpi_for_text.top    = UnScaleByZoom(_dpi_for_text.top,    _dpi_for_text.zoom);
-	_dpi_for_text.width  = UnScaleByZoom(_dpi_for_text.width,  _dpi_for_text.zoom);
-	_dpi_for_text.height = UnScaleByZoom(_dpi_for_text.height, _dpi_for_text.zoom);
-	_dpi_for_text.zoom   = ZOOM_LVL_NORMAL;
-
 	if (vp->zoom >= ZOOM_LVL_DRAW_MAP) {
 		/* Here the rendering is like smallmap. */
 		if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
@@ -2559,18 +2833,86 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 		DrawTextEffects(&_vd.dpi);
 
-		if (_vd.tile_sprites_to_draw.Length() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
-
 		ParentSpriteToDraw *psd_end = _vd.parent_sprites_to_draw.End();
 		for (ParentSpriteToDraw *it = _vd.parent_sprites_to_draw.Begin(); it != psd_end; it++) {
 			*_vd.parent_sprites_to_sort.Append() = it;
 		}
 
 		_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
-		ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+	}
+
+	_cur_dpi = old_dpi;
+	_vd.bridge_to_map.Clear();
+
+	if (_vd_piece_count == _vd_pieces.size()) _vd_pieces.emplace_back();
+	ViewportDrawPiece &piece = _vd_pieces[_vd_piece_count++];
+	piece.vp = vp;
+	piece.dpi = _vd.dpi;
+	piece.x = x;
+	piece.y = y;
+	/* The vectors of the piece are empty, so _vd gets empty ones back. */
+	piece.string_sprites_to_draw.Swap(_vd.string_sprites_to_draw);
+	piece.tile_sprites_to_draw.Swap(_vd.tile_sprites_to_draw);
+	piece.parent_sprites_to_draw.Swap(_vd.parent_sprites_to_draw);
+	piece.parent_sprites_to_sort.Swap(_vd.parent_sprites_to_sort);
+	piece.child_screen_sprites_to_draw.Swap(_vd.child_screen_sprites_to_draw);
+}
+
+/**
+ * Load a sprite and its recolour sprite into the sprite cache, like #DrawSpriteViewport would.
+ * @param image The sprite.
+ * @param pal The palette.
+ */
+static void ViewportPrewarmSprite(SpriteID image, PaletteID pal)
+{
+	GetSprite(GB(image, 0, SPRITE_WIDTH), ST_NORMAL);
+	if (HasBit(image, PALETTE_MODIFIER_TRANSPARENT) || (pal != PAL_NONE && !HasBit(pal, PALETTE_TEXT_RECOLOUR))) {
+		GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR);
+	}
+}
+
+/**
+ * Load all sprites of a part of a viewport into the sprite cache.
+ * @param piece The part.
+ */
+static void ViewportPrewarmPiece(const ViewportDrawPiece *piece)
+{
+	const TileSpriteToDraw *tsend = piece->tile_sprites_to_draw.End();
+	for (const TileSpriteToDraw *ts = piece->tile_sprites_to_draw.Begin(); ts != tsend; ++ts) {
+		ViewportPrewarmSprite(ts->image, ts->pal);
+	}
 
-		if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
+	const ParentSpriteToDraw *psd_end = piece->parent_sprites_to_draw.End();
+	for (const ParentSpriteToDraw *ps = piece->parent_sprites_to_draw.Begin(); ps != psd_end; ++ps) {
+		if (ps->image != SPR_EMPTY_BOUNDING_BOX) ViewportPrewarmSprite(ps->image, ps->pal);
 	}
+
+	const ChildScreenSpriteToDraw *csend = piece->child_screen_sprites_to_draw.End();
+	for (const ChildScreenSpriteToDraw *cs = piece->child_screen_sprites_to_draw.Begin(); cs != csend; ++cs) {
+		ViewportPrewarmSprite(cs->image, cs->pal);
+	}
+}
+
+/**
+ * Draw everything of a part of a viewport that comes after the sprites.
+ * @param piece The part.
+ */
+static void ViewportFinishPiece(ViewportDrawPiece *piece)
+{
+	const ViewPort *vp = piece->vp;
+	DrawPixelInfo *old_dpi = _cur_dpi;
+
+	_vd.dpi = piece->dpi;
+	_cur_dpi = &_vd.dpi;
+
+	_dpi_for_text        = _vd.dpi;
+	_dpi_for_text.left   = UnScaleByZoom(_dpi_for_text.left,   _dpi_for_text.zoom);
+	_dpi_for_text.top    = UnScaleByZoom(_dpi_for_text.top,    _dpi_for_text.zoom);
+	_dpi_for_text.width  = UnScaleByZoom(_dpi_for_text.width,  _dpi_for_text.zoom);
+	_dpi_for_text.height = UnScaleByZoom(_dpi_for_text.height, _dpi_for_text.zoom);
+	_dpi_for_text.zoom   = ZOOM_LVL_NORMAL;
+
+	if (_draw_bounding_boxes && vp->zoom < ZOOM_LVL_DRAW_MAP) ViewportDrawBoundingBoxes(&piece->parent_sprites_to_sort);
 	if (_draw_dirty_blocks) ViewportDrawDirtyBlocks();
 
 	DrawPixelInfo dp = _vd.dpi;
@@ -2582,49 +2924,87 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	if (vp->overlay != NULL && vp->overlay->GetCargoMask() != 0 && vp->overlay->GetCompanyMask() != 0) {
 		/* translate to window coordinates */
-		dp.left = x;
-		dp.top = y;
+		dp.left = piece->x;
+		dp.top = piece->y;
 		vp->overlay->Draw(&dp);
 	}
 
 	if (_settings_client.gui.show_vehicle_route) ViewportMapDrawVehicleRoute(vp);
-	if (_vd.string_sprites_to_draw.Length() != 0) {
+	if (piece->string_sprites_to_draw.Length() != 0) {
 		/* translate to world coordinates */
 		dp.left = UnScaleByZoom(_vd.dpi.left, zoom);
 		dp.top = UnScaleByZoom(_vd.dpi.top, zoom);
-		ViewportDrawStrings(zoom, &_vd.string_sprites_to_draw);
+		ViewportDrawStrings(zoom, &piece->string_sprites_to_draw);
 	}
 	if (_settings_client.gui.show_vehicle_route_steps) ViewportDrawVehicleRouteSteps(vp);
 	ViewportDrawPlans(vp);
 
 	_cur_dpi = old_dpi;
 
-	_vd.bridge_to_map.Clear();
-	_vd.string_sprites_to_draw.Clear();
-	_vd.tile_sprites_to_draw.Clear();
-	_vd.parent_sprites_to_draw.Clear();
-	_vd.parent_sprites_to_sort.Clear();
-	_vd.child_screen_sprites_to_draw.Clear();
+	piece->string_sprites_to_draw.Clear();
+	piece->tile_sprites_to_draw.Clear();
+	piece->parent_sprites_to_draw.Clear();
+	piece->parent_sprites_to_sort.Clear();
+	piece->child_screen_sprites_to_draw.Clear();
+}
+
+/**
+ * Draw the parts of viewports collected by #ViewportCollectPiece.
+ * The sprites of the parts are blitted concurrently if all of them fit in
+ * the sprite cache at once, which is then read only while blitting.
+ */
+static void ViewportDrawPieces()
+{
+	bool concurrent = _vd_piece_count > 1 && IsViewportDrawConcurrent() && _newgrf_debug_sprite_picker.mode != SPM_REDRAW;
+	if (concurrent) {
+		uint evictions = GetSpriteCacheEvictions();
+		for (uint i = 0; i < _vd_piece_count; i++) ViewportPrewarmPiece(&_vd_pieces[i]);
+		/* If loading a sprite pushed out another one, blit them one by one, loading sprites as needed. */
+		concurrent = GetSpriteCacheEvictions() == evictions;
+	}
+
+	if (concurrent) {
+		SetSpriteCacheReadOnly(true);
+		WorkerTaskGroup group;
+		for (uint i = 1; i < _vd_piece_count; i++) GetWorkerThreadPool().Submit(&ViewportDrawPiece::Blit, &_vd_pieces[i], &group, true);
+		/* do the first piece on this thread */
+		ViewportDrawPiece::Blit(&_vd_pieces[0]);
+		GetWorkerThreadPool().Wait(&group);
+		SetSpriteCacheReadOnly(false);
+	} else {
+		for (uint i = 0; i < _vd_piece_count; i++) ViewportDrawPiece::Blit(&_vd_pieces[i]);
+	}
+
+	for (uint i = 0; i < _vd_piece_count; i++) ViewportFinishPiece(&_vd_pieces[i]);
+	_vd_piece_count = 0;
+}
+
+void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	ViewportCollectPiece(vp, left, top, right, bottom);
+	ViewportDrawPieces();
 }
 
 /**
  * Make sure we don't draw a too big area at a time.
  * If we do, the sprite memory will overflow.
+ * @param max_pixels Maximum number of screen pixels of a part, so the parts can be blitted concurrently.
  */
-static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom)
+static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom, int max_pixels)
 {
-	if ((vp->zoom < ZOOM_LVL_DRAW_MAP) && (ScaleByZoom(bottom - top, vp->zoom) * ScaleByZoom(right - left, vp->zoom) > 180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE)) {
+	if ((vp->zoom < ZOOM_LVL_DRAW_MAP) && (ScaleByZoom(bottom - top, vp->zoom) * ScaleByZoom(right - left, vp->zoom) > 180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE ||
+			(bottom - top) * (right - left) > max_pixels)) {
 		if ((bottom - top) > (right - left)) {
 			int t = (top + bottom) >> 1;
-			ViewportDrawChk(vp, left, top, right, t);
-			ViewportDrawChk(vp, left, t, right, bottom);
+			ViewportDrawChk(vp, left, top, right, t, max_pixels);
+			ViewportDrawChk(vp, left, t, right, bottom, max_pixels);
 		} else {
 			int t = (left + right) >> 1;
-			ViewportDrawChk(vp, left, top, t, bottom);
-			ViewportDrawChk(vp, t, top, right, bottom);
+			ViewportDrawChk(vp, left, top, t, bottom, max_pixels);
+			ViewportDrawChk(vp, t, top, right, bottom, max_pixels);
 		}
 	} else {
-		ViewportDoDraw(vp,
+		ViewportCollectPiece(vp,
 			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
 			ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top,
 			ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left,
@@ -2647,7 +3027,14 @@ static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right
 	if (top < vp->top) top = vp->top;
 	if (bottom > vp->top + vp->height) bottom = vp->top + vp->height;
 
-	ViewportDrawChk(vp, left, top, right, bottom);
+	/* Split the area into a few parts per thread, so the threads are kept busy. */
+	int max_pixels = INT_MAX;
+	if (vp->zoom < ZOOM_LVL_DRAW_MAP && IsViewportDrawConcurrent()) {
+		max_pixels = max(VIEWPORT_DRAW_MIN_PIECE_PIXELS, (right - left) * (bottom - top) / (int)(2 * (GetWorkerThreadPool().NumWorkers() + 1)));
+	}
+
+	ViewportDrawChk(vp, left, top, right, bottom, max_pixels);
+	ViewportDrawPieces();
 }
 
 /**
@@ -2969,6 +3356,8 @@ void ConstrainAllViewportsZoom()
  */
 void MarkTileDirtyByTile(TileIndex tile, const ZoomLevel mark_dirty_if_zoomlevel_is_below, int bridge_level_offset)
 {
+	ViewportMapInvalidateColourCacheByTile(tile);
+
 	Point pt = RemapCoords(TileX(tile) * TILE_SIZE, TileY(tile) * TILE_SIZE, TilePixelHeight(tile));
 	MarkAllViewportsDirty(
 			pt.x - 31  * ZOOM_LVL_BASE,
@@ -4812,6 +5201,7 @@ struct ViewportSSCSS {
 
 /** List of sorters ordered from best to worst. */
 static ViewportSSCSS _vp_sprite_sorters[] = {
+	{ &ViewportSortParentSpritesGridChecker, &ViewportSortParentSpritesGrid },
 #ifdef WITH_SSE
 	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41 },
 #endif
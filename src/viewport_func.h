@@ -98,6 +98,8 @@ void ShowTooltipForTile(Window *w, const TileIndex tile);
 
 void ViewportMapClearTunnelCache();
 void ViewportMapInvalidateTunnelCacheByTile(const TileIndex tile);
+void ViewportMapClearColourCache();
+void ViewportMapInvalidateColourCacheByTile(const TileIndex tile);
 
 void ToolbarSelectLastTool();
 
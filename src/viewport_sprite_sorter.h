@@ -37,6 +37,11 @@ struct ParentSpriteToDraw {
 	int32 left;                     ///< minimal screen X coordinate of sprite (= x + sprite->x_offs), reference point for child sprites
 	int32 top;                      ///< minimal screen Y coordinate of sprite (= y + sprite->y_offs), reference point for child sprites
 
+	int32 bounds_left;              ///< minimal screen X coordinate of sprite and its child sprites
+	int32 bounds_top;               ///< minimal screen Y coordinate of sprite and its child sprites
+	int32 bounds_right;             ///< maximal screen X coordinate of sprite and its child sprites, exclusive
+	int32 bounds_bottom;            ///< maximal screen Y coordinate of sprite and its child sprites, exclusive
+
 	int32 first_child;              ///< the first child to draw.
 	bool comparison_done;           ///< Used during sprite sorting: true if sprite has been compared with all other sprites
 };
@@ -53,6 +58,9 @@ bool ViewportSortParentSpritesSSE41Checker();
 void ViewportSortParentSpritesSSE41(ParentSpriteToSortVector *psdv);
 #endif
 
+bool ViewportSortParentSpritesGridChecker();
+void ViewportSortParentSpritesGrid(ParentSpriteToSortVector *psdv);
+
 void InitializeSpriteSorter();
 
 #endif /* VIEWPORT_SPRITE_SORTER_H */
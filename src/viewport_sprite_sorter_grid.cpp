@@ -0,0 +1,184 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file viewport_sprite_sorter_grid.cpp Sprite sorter that only orders sprites which overlap on the screen. */
+
+#include "stdafx.h"
+#include "core/math_func.hpp"
+#include "viewport_sprite_sorter.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "safeguards.h"
+
+/*
+ * The drawing order of two sprites only matters when they overlap on the
+ * screen. The sprites are put in a grid of screen cells to find the pairs
+ * which do overlap, and only those get an ordering constraint, using the same
+ * comparison as the other sorters. The constraints are then sorted
+ * topologically, always picking the sprite that came first in the input, so
+ * sprites without any constraint keep their original order. Cycles, which
+ * the comparison allows, are broken by drawing the first remaining sprite.
+ */
+
+/**
+ * Check whether two sprites overlap on the screen.
+ * @param a The first sprite.
+ * @param b The second sprite.
+ * @return True if some pixel may be drawn by both.
+ */
+static inline bool ScreenOverlaps(const ParentSpriteToDraw *a, const ParentSpriteToDraw *b)
+{
+	return a->bounds_left < b->bounds_right && b->bounds_left < a->bounds_right &&
+			a->bounds_top < b->bounds_bottom && b->bounds_top < a->bounds_bottom;
+}
+
+/**
+ * Decide whether a sprite has to be drawn before a sprite that precedes it in the input.
+ * @param ps The preceding sprite.
+ * @param ps2 The following sprite.
+ * @return True if \a ps2 has to be drawn first.
+ */
+static inline bool DrawBefore(const ParentSpriteToDraw *ps, const ParentSpriteToDraw *ps2)
+{
+	if (ps->xmax >= ps2->xmin && ps->xmin <= ps2->xmax && // overlap in X?
+			ps->ymax >= ps2->ymin && ps->ymin <= ps2->ymax && // overlap in Y?
+			ps->zmax >= ps2->zmin && ps->zmin <= ps2->zmax) { // overlap in Z?
+		/* The bounding boxes intersect, so order by the centre of mass. */
+		return ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax >
+				ps2->xmin + ps2->xmax + ps2->ymin + ps2->ymax + ps2->zmin + ps2->zmax;
+	}
+	/* Only change the order if it is definite. */
+	return !(ps->xmax < ps2->xmin || ps->ymax < ps2->ymin || ps->zmax < ps2->zmin);
+}
+
+/** Sort parent sprites pointer array, only comparing sprites which overlap on the screen. */
+void ViewportSortParentSpritesGrid(ParentSpriteToSortVector *psdv)
+{
+	const uint n = psdv->Length();
+	if (n < 2) return;
+	ParentSpriteToDraw **psd = psdv->Begin();
+
+	/* Screen area covered by all sprites. */
+	int32 left = INT32_MAX, top = INT32_MAX, right = INT32_MIN, bottom = INT32_MIN;
+	for (uint i = 0; i < n; i++) {
+		left   = min(left,   psd[i]->bounds_left);
+		top    = min(top,    psd[i]->bounds_top);
+		right  = max(right,  psd[i]->bounds_right);
+		bottom = max(bottom, psd[i]->bounds_bottom);
+	}
+
+	/* Roughly as many cells as sprites. */
+	const int grid_size = Clamp((int)sqrt((double)n), 1, 256);
+	const int cell_w = max<int>(1, (right - left + grid_size - 1) / grid_size);
+	const int cell_h = max<int>(1, (bottom - top + grid_size - 1) / grid_size);
+	auto cell_x = [&](int32 x) { return Clamp((x - left) / cell_w, 0, grid_size - 1); };
+	auto cell_y = [&](int32 y) { return Clamp((y - top) / cell_h, 0, grid_size - 1); };
+
+	/* Put the sprites in all cells they cover; the cells are stored as contiguous ranges of cell_items. */
+	std::vector<uint> cell_start(grid_size * grid_size + 1, 0);
+	for (uint i = 0; i < n; i++) {
+		const ParentSpriteToDraw *ps = psd[i];
+		for (int cy = cell_y(ps->bounds_top); cy <= cell_y(ps->bounds_bottom - 1); cy++) {
+			for (int cx = cell_x(ps->bounds_left); cx <= cell_x(ps->bounds_right - 1); cx++) {
+				cell_start[cy * grid_size + cx + 1]++;
+			}
+		}
+	}
+	for (size_t c = 1; c < cell_start.size(); c++) cell_start[c] += cell_start[c - 1];
+	std::vector<uint> cell_fill(cell_start.begin(), cell_start.end() - 1);
+	std::vector<uint> cell_items(cell_start.back());
+	for (uint i = 0; i < n; i++) {
+		const ParentSpriteToDraw *ps = psd[i];
+		for (int cy = cell_y(ps->bounds_top); cy <= cell_y(ps->bounds_bottom - 1); cy++) {
+			for (int cx = cell_x(ps->bounds_left); cx <= cell_x(ps->bounds_right - 1); cx++) {
+				cell_items[cell_fill[cy * grid_size + cx]++] = i;
+			}
+		}
+	}
+
+	/* Find the overlapping pairs. Each pair is handled in the cell with the top left corner of its overlap only. */
+	std::vector<std::pair<uint, uint> > edges; // (first to draw, second to draw)
+	for (int cy = 0; cy < grid_size; cy++) {
+		for (int cx = 0; cx < grid_size; cx++) {
+			const uint cell = cy * grid_size + cx;
+			for (uint a = cell_start[cell]; a < cell_start[cell + 1]; a++) {
+				const uint i = cell_items[a];
+				for (uint b = a + 1; b < cell_start[cell + 1]; b++) {
+					const uint j = cell_items[b];
+					const ParentSpriteToDraw *ps = psd[i];
+					const ParentSpriteToDraw *ps2 = psd[j];
+					if (!ScreenOverlaps(ps, ps2)) continue;
+					if (cell_x(max(ps->bounds_left, ps2->bounds_left)) != cx || cell_y(max(ps->bounds_top, ps2->bounds_top)) != cy) continue;
+
+					/* Items of a cell are in input order, so i < j. */
+					if (DrawBefore(ps, ps2)) {
+						edges.emplace_back(j, i);
+					} else {
+						edges.emplace_back(i, j);
+					}
+				}
+			}
+		}
+	}
+
+	/* Adjacency lists of the constraints. */
+	std::vector<uint> succ_start(n + 1, 0);
+	std::vector<uint> in_degree(n, 0);
+	for (const auto &e : edges) {
+		succ_start[e.first + 1]++;
+		in_degree[e.second]++;
+	}
+	for (uint i = 1; i <= n; i++) succ_start[i] += succ_start[i - 1];
+	std::vector<uint> succ_fill(succ_start.begin(), succ_start.end() - 1);
+	std::vector<uint> succ(edges.size());
+	for (const auto &e : edges) succ[succ_fill[e.first]++] = e.second;
+
+	/* Topological sort, preferring the sprite that came first in the input. */
+	std::vector<ParentSpriteToDraw *> input(psd, psd + n);
+	std::vector<bool> done(n, false);
+	std::priority_queue<uint, std::vector<uint>, std::greater<uint> > ready;
+	for (uint i = 0; i < n; i++) {
+		if (in_degree[i] == 0) ready.push(i);
+	}
+
+	uint out = 0;
+	uint first_remaining = 0;
+	while (out < n) {
+		uint i;
+		if (!ready.empty()) {
+			i = ready.top();
+			ready.pop();
+			if (done[i]) continue;
+		} else {
+			/* Only cycles are left; break one. */
+			while (done[first_remaining]) first_remaining++;
+			i = first_remaining;
+		}
+
+		done[i] = true;
+		psd[out++] = input[i];
+		for (uint s = succ_start[i]; s < succ_start[i + 1]; s++) {
+			const uint j = succ[s];
+			if (--in_degree[j] == 0 && !done[j]) ready.push(j);
+		}
+	}
+}
+
+/**
+ * The grid sorter works on every CPU.
+ * @return Always true.
+ */
+bool ViewportSortParentSpritesGridChecker()
+{
+	return true;
+}